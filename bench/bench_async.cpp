@@ -0,0 +1,126 @@
+// Measures coroutine reads with thousands of operations in flight on a handful
+// of threads, compared against the same reads issued with blocking vfs::open.
+//
+// Usage: bench_async [operations] [files]
+
+#include <datapak/async.hpp>
+#include <datapak/archive_builder.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <latch>
+#include <random>
+#include <string>
+
+namespace {
+
+struct counters {
+    std::atomic<int> in_flight{0};
+    std::atomic<int> peak_in_flight{0};
+    std::atomic<int> failures{0};
+    std::atomic<std::size_t> bytes{0};
+};
+
+dp::detail::detached_task read_one(const dp::vfs& fs, std::string path, dp::async_engine& engine,
+                                   dp::thread_pool& executor, counters& stats, std::latch& done) {
+    const int now = stats.in_flight.fetch_add(1) + 1;
+    int peak = stats.peak_in_flight.load();
+    while (now > peak && !stats.peak_in_flight.compare_exchange_weak(peak, now)) {
+    }
+
+    auto data = co_await dp::co_read(fs, std::move(path), engine, executor);
+    if (data) {
+        stats.bytes.fetch_add(data->size());
+    } else {
+        stats.failures.fetch_add(1);
+    }
+
+    stats.in_flight.fetch_sub(1);
+    done.count_down();
+}
+
+std::filesystem::path build_archive(int files) {
+    const auto source_dir = std::filesystem::temp_directory_path() / "datapak_bench_async";
+    const auto archive_path = std::filesystem::temp_directory_path() / "datapak_bench_async.pak";
+
+    std::filesystem::remove_all(source_dir);
+    std::filesystem::create_directories(source_dir);
+
+    std::mt19937 rng(42);
+    for (int i = 0; i < files; ++i) {
+        std::ofstream file(source_dir / ("asset" + std::to_string(i) + ".bin"), std::ios::binary);
+        for (int j = 0; j < 16 * 1024; ++j) {
+            // Half-random bytes so deflate has real work to do
+            file.put(static_cast<char>((j & 1) ? rng() & 0xff : j & 0x0f));
+        }
+    }
+
+    dp::archive_builder builder(dp::compression_method::deflate);
+    builder.add_directory(source_dir);
+    if (!builder.build(archive_path)) {
+        std::cerr << "failed to build benchmark archive\n";
+        std::exit(1);
+    }
+
+    std::filesystem::remove_all(source_dir);
+    return archive_path;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int operations = argc > 1 ? std::stoi(argv[1]) : 8192;
+    const int files = argc > 2 ? std::stoi(argv[2]) : 256;
+
+    const auto archive_path = build_archive(files);
+
+    dp::vfs filesystem;
+    filesystem.enable_cache(false);
+    if (!filesystem.mount(archive_path)) {
+        std::cerr << "failed to mount benchmark archive\n";
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    // Blocking baseline on the calling thread
+    std::size_t blocking_bytes = 0;
+    const auto blocking_start = clock::now();
+    for (int i = 0; i < operations; ++i) {
+        auto stream = filesystem.open("asset" + std::to_string(i % files) + ".bin");
+        if (stream) {
+            (*stream)->seekg(0, std::ios::end);
+            blocking_bytes += static_cast<std::size_t>((*stream)->tellg());
+        }
+    }
+    const std::chrono::duration<double, std::milli> blocking_ms = clock::now() - blocking_start;
+
+    // Coroutines: every operation is started before any completes
+    counters stats;
+    {
+        dp::async_engine engine(2, 2);
+        dp::thread_pool executor(1);
+        std::latch done(operations);
+
+        const auto async_start = clock::now();
+        for (int i = 0; i < operations; ++i) {
+            read_one(filesystem, "asset" + std::to_string(i % files) + ".bin", engine, executor, stats, done);
+        }
+        done.wait();
+        const std::chrono::duration<double, std::milli> async_ms = clock::now() - async_start;
+
+        std::cout << "operations:        " << operations << " over " << files << " entries\n";
+        std::cout << "blocking open:     " << blocking_ms.count() << " ms ("
+                  << blocking_bytes / (1024.0 * 1024.0) / (blocking_ms.count() / 1000.0) << " MiB/s)\n";
+        std::cout << "co_read:           " << async_ms.count() << " ms ("
+                  << stats.bytes.load() / (1024.0 * 1024.0) / (async_ms.count() / 1000.0) << " MiB/s)\n";
+        std::cout << "threads:           1 executor + 2 io + 2 decode\n";
+        std::cout << "peak in flight:    " << stats.peak_in_flight.load() << "\n";
+        std::cout << "failures:          " << stats.failures.load() << "\n";
+    }
+
+    std::filesystem::remove(archive_path);
+    return stats.failures.load() == 0 ? 0 : 1;
+}
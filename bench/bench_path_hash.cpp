@@ -0,0 +1,145 @@
+// Measures dp::path_hash against std::hash<std::string_view> and the previous
+// FNV-1a path hash, on generated asset paths with a realistic length mix
+// (1-6 directory levels, short and long names, common extensions), both as
+// raw hashing throughput and as the hash of an unordered_map directory.
+//
+// Usage: bench_path_hash [paths] [rounds]
+
+#include <datapak/hash.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::uint64_t fnv1a(std::string_view path) noexcept {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const char c : path) {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::vector<std::string> generate_paths(int count) {
+    static constexpr std::array<std::string_view, 12> roots = {
+        "textures", "models", "audio", "shaders", "levels", "ui",
+        "characters", "environments", "animations", "materials", "fonts", "config"};
+    static constexpr std::array<std::string_view, 10> extensions = {
+        ".png", ".ktx2", ".dds", ".mesh", ".anim", ".ogg", ".wav", ".json", ".glsl", ".mat"};
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> depth(1, 6);
+    std::geometric_distribution<int> segment_length(0.12);
+    std::uniform_int_distribution<int> letter(0, 35);
+
+    const auto segment = [&] {
+        std::string text;
+        const int length = 2 + segment_length(rng);
+        for (int i = 0; i < length; ++i) {
+            const int c = letter(rng);
+            text += c < 26 ? static_cast<char>('a' + c) : (c < 34 ? static_cast<char>('0' + c - 26) : '_');
+        }
+        return text;
+    };
+
+    std::vector<std::string> paths;
+    paths.reserve(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        std::string path(roots[rng() % roots.size()]);
+        for (int level = depth(rng) - 1; level > 0; --level) {
+            path += '/';
+            path += segment();
+        }
+        path += '/';
+        path += segment();
+        path += extensions[rng() % extensions.size()];
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+template <typename Hash>
+void measure_hash(const char* name, const std::vector<std::string>& paths, int rounds,
+                  std::size_t total_bytes, Hash hash) {
+    using clock = std::chrono::steady_clock;
+    std::uint64_t sink = 0;
+    const auto start = clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto& path : paths) {
+            sink += hash(std::string_view{path});
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+    const double hashes = static_cast<double>(paths.size()) * rounds;
+
+    std::cout << name << elapsed.count() / hashes << " ns/hash, "
+              << static_cast<double>(total_bytes) * rounds / elapsed.count() << " GB/s"
+              << "  (checksum " << (sink & 0xff) << ")\n";
+}
+
+template <typename Hash>
+void measure_lookup(const char* name, const std::vector<std::string>& paths, int rounds, Hash hash) {
+    struct hasher {
+        Hash hash;
+        std::size_t operator()(std::string_view path) const noexcept {
+            return static_cast<std::size_t>(hash(path));
+        }
+    };
+    std::unordered_map<std::string_view, std::size_t, hasher> directory(paths.size(), hasher{hash});
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        directory.emplace(paths[i], i);
+    }
+
+    using clock = std::chrono::steady_clock;
+    std::size_t found = 0;
+    const auto start = clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (const auto& path : paths) {
+            found += directory.count(path);
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+    const double lookups = static_cast<double>(paths.size()) * rounds;
+
+    std::cout << name << elapsed.count() / lookups << " ns/lookup  (found " << found << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int count = argc > 1 ? std::stoi(argv[1]) : 100000;
+    const int rounds = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    const auto paths = generate_paths(count);
+    std::size_t total_bytes = 0;
+    std::size_t longest = 0;
+    for (const auto& path : paths) {
+        total_bytes += path.size();
+        longest = std::max(longest, path.size());
+    }
+
+    std::cout << "paths:             " << paths.size() << ", mean length "
+              << static_cast<double>(total_bytes) / static_cast<double>(paths.size())
+              << ", longest " << longest << "\n";
+
+    const auto std_hash = [](std::string_view path) { return std::hash<std::string_view>{}(path); };
+    const auto dp_hash = [](std::string_view path) { return dp::path_hash(path); };
+
+    measure_hash("std::hash:         ", paths, rounds, total_bytes, std_hash);
+    measure_hash("FNV-1a:            ", paths, rounds, total_bytes, fnv1a);
+    measure_hash("dp::path_hash:     ", paths, rounds, total_bytes, dp_hash);
+
+    measure_lookup("map std::hash:     ", paths, rounds, std_hash);
+    measure_lookup("map FNV-1a:        ", paths, rounds, fnv1a);
+    measure_lookup("map dp::path_hash: ", paths, rounds, dp_hash);
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Measures streaming one large deflate entry with a consumer that does work
+// per block: vfs::open (inflate everything, then consume) against
+// vfs::open_sequential (inflate the next window while the current one is
+// consumed).
+//
+// Usage: bench_readahead [megabytes] [window_kib]
+
+#include <datapak/vfs.hpp>
+#include <datapak/archive_builder.hpp>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::filesystem::path build_archive(std::size_t bytes) {
+    const auto archive_path = std::filesystem::temp_directory_path() / "datapak_bench_readahead.pak";
+
+    std::mt19937 rng(42);
+    std::vector<std::byte> data(bytes);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        // Half-random bytes so deflate has real work to do
+        data[i] = static_cast<std::byte>((i & 1) ? rng() & 0xff : i & 0x0f);
+    }
+
+    dp::archive_builder builder(dp::compression_method::deflate);
+    builder.add_buffer("stream.bin", std::move(data));
+    if (!builder.build(archive_path)) {
+        std::cerr << "failed to build benchmark archive\n";
+        std::exit(1);
+    }
+    return archive_path;
+}
+
+// Stand-in for a decoder or uploader: a few multiply-adds per byte
+std::uint64_t consume(std::istream& stream) {
+    std::vector<char> block(64 * 1024);
+    std::uint64_t checksum = 0;
+    while (stream.read(block.data(), static_cast<std::streamsize>(block.size())) || stream.gcount() > 0) {
+        for (std::streamsize i = 0; i < stream.gcount(); ++i) {
+            checksum = (checksum ^ static_cast<unsigned char>(block[i])) * 0x100000001b3ULL;
+        }
+    }
+    return checksum;
+}
+
+template <typename Open>
+void run(const char* label, std::size_t bytes, Open&& open) {
+    const auto start = std::chrono::steady_clock::now();
+    auto stream = open();
+    if (!stream) {
+        std::cerr << label << ": open failed\n";
+        std::exit(1);
+    }
+    const auto checksum = consume(**stream);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << label << ": " << elapsed.count() * 1000 << " ms, "
+              << bytes / elapsed.count() / (1024 * 1024) << " MiB/s (checksum " << std::hex << checksum
+              << std::dec << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 128;
+    const std::size_t window = (argc > 2 ? std::stoul(argv[2]) : 1024) * 1024;
+    const std::size_t bytes = megabytes * 1024 * 1024;
+
+    const auto archive_path = build_archive(bytes);
+
+    dp::vfs filesystem;
+    filesystem.enable_cache(false);
+    if (!filesystem.mount(archive_path)) {
+        std::cerr << "failed to mount benchmark archive\n";
+        return 1;
+    }
+
+    run("open           ", bytes, [&] { return filesystem.open("stream.bin"); });
+    run("open_sequential", bytes, [&] { return filesystem.open_sequential("stream.bin", window); });
+
+    std::filesystem::remove(archive_path);
+    return 0;
+}
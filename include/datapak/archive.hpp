@@ -9,12 +9,19 @@
 #include "format.hpp"
 #include "compression.hpp"
 #include "vfstream.hpp"
+#include "bloom_filter.hpp"
+#include "hash.hpp"
+#include "file_handle.hpp"
+#include "chunk.hpp"
+#include "directory_table.hpp"
 #include <filesystem>
-#include <fstream>
-#include <unordered_map>
 #include <memory>
+#include <memory_resource>
 #include <expected>
+#include <optional>
 #include <string_view>
+#include <span>
+#include <utility>
 
 namespace dp {
 
@@ -26,7 +33,17 @@ enum class archive_error {
     invalid_format,    /**< File is not a valid DataPak archive */
     read_error,        /**< I/O error occurred while reading */
     compression_error, /**< Error during decompression */
-    entry_not_found    /**< Requested file not found in archive */
+    entry_not_found,   /**< Requested file not found in archive */
+    checksum_mismatch, /**< Entry contents do not match the stored checksum */
+    buffer_too_small   /**< Destination buffer cannot hold the entry */
+};
+
+/**
+ * @brief An entry that failed archive::verify()
+ */
+struct verify_failure {
+    std::uint32_t entry;  /**< Index of the failing entry */
+    archive_error error;  /**< Why the entry failed */
 };
 
 /**
@@ -37,21 +54,71 @@ enum class access_mode {
     memory  /**< Load entire archive into memory for faster access */
 };
 
+/**
+ * @brief How entry data is read from disk
+ */
+enum class io_mode {
+    automatic, /**< Direct I/O for entries at or above the archive's threshold, buffered otherwise */
+    buffered,  /**< Read through the page cache */
+    direct     /**< Bypass the page cache (O_DIRECT where supported) */
+};
+
+/**
+ * @brief Path matching rules used when looking up files
+ */
+enum class lookup_mode {
+    exact,           /**< Paths must match the stored path byte for byte */
+    normalized,      /**< Paths are normalized (separators, ".", "..") before matching */
+    case_insensitive /**< Paths are normalized and compared ignoring ASCII case */
+};
+
+/**
+ * @brief Metadata describing a file stored in an archive
+ */
+struct file_stat {
+    std::uint64_t size;              /**< Uncompressed size in bytes */
+    std::uint64_t compressed_size;   /**< Stored size in bytes */
+    compression_method compression;  /**< Compression method used */
+    std::optional<entry_metadata> metadata; /**< Checksum and source mtime, if the archive stores them */
+};
+
+/**
+ * @brief Get the path of a volume file of a multi-volume archive
+ * @param archive_path Path of the archive file holding the directory
+ * @param volume Volume index
+ * @return archive_path with a three-digit volume suffix, e.g. assets.pak.001
+ */
+std::filesystem::path volume_path(const std::filesystem::path& archive_path, std::uint32_t volume);
+
 /**
  * @brief DataPak archive reader
  *
  * This class provides read-only access to DataPak archive files.
  * It can open files from the archive as virtual streams and provides
- * methods to query archive contents.
+ * methods to query archive contents. Const member functions may be called
+ * concurrently from multiple threads, provided the memory resource passed
+ * to the constructor is thread-safe.
  */
 class archive {
 public:
     /**
      * @brief Construct archive reader for the specified file
+     *
+     * The directory, the memory-mode archive contents and the buffers behind
+     * streams returned by open() are allocated from resource, which must
+     * outlive the archive and those streams. The archive does not lock
+     * around the resource: to call const member functions from several
+     * threads, or to destroy streams on other threads, pass a thread-safe
+     * resource such as the default one or a std::pmr::synchronized_pool_resource.
+     * An unsynchronized resource like std::pmr::monotonic_buffer_resource
+     * confines the archive and its streams to one thread at a time.
+     *
      * @param path Path to the DataPak archive file
      * @param mode Access mode (disk or memory)
+     * @param resource Memory resource for directory and file buffers
      */
-    explicit archive(const std::filesystem::path& path, access_mode mode = access_mode::disk);
+    explicit archive(const std::filesystem::path& path, access_mode mode = access_mode::disk,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     /**
      * @brief Default destructor
@@ -69,10 +136,220 @@ public:
     /**
      * @brief Open a file from the archive as a virtual stream
      * @param filename The virtual path of the file within the archive
+     * @param io How to read the data in disk mode
+     * @return Expected containing vfstream on success, or archive_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, archive_error>
+    open(std::string_view filename, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Open a file using a pre-hashed path key
+     *
+     * In lookup_mode::exact the stored hash is used directly for the Bloom
+     * filter and directory probe, so no hashing happens at runtime.
+     *
+     * @param key Path and its precomputed hash, e.g. "config/app.json"_dp
+     * @param io How to read the data in disk mode
+     * @return Expected containing vfstream on success, or archive_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, archive_error>
+    open(const path_key& key, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Open a file by its directory entry index
+     *
+     * Skips path hashing and directory probing; see find(). In disk mode,
+     * uncompressed entries are streamed on demand through a range_streambuf,
+     * so opening is O(1) and memory use does not grow with the file size.
+     *
+     * @param index Entry index previously returned by find()
+     * @param io How to read the data in disk mode
+     * @return Expected containing vfstream on success, or archive_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, archive_error>
+    open_entry(std::uint32_t index, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Open a file for sequential reading with background readahead
+     *
+     * In disk mode, stored and deflate entries are returned as a
+     * readahead_streambuf: a background thread reads the next window while
+     * the caller consumes the current one. For deflate entries, reading and
+     * inflating run on separate threads, each a window ahead of the next
+     * stage, so streaming a large entry costs roughly the slowest of disk,
+     * decoder and consumer instead of their sum. The stream is forward-only
+     * and keeps its own reference to the archive file; read errors and
+     * corrupt data set badbit on the stream (see readahead_streambuf).
+     * Memory-mode archives, deltas and chunked entries are opened as by open().
+     *
+     * @param filename The virtual path of the file within the archive
+     * @param window_size Size of each of the two readahead windows in bytes
+     * @param io How to read the data in disk mode
+     * @return Expected containing vfstream on success, or archive_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, archive_error>
+    open_sequential(std::string_view filename, std::size_t window_size = readahead_streambuf::default_window_size,
+                    io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Open a file for sequential reading by its directory entry index
+     * @param index Entry index previously returned by find()
+     * @param window_size Size of each of the two readahead windows in bytes
+     * @param io How to read the data in disk mode
      * @return Expected containing vfstream on success, or archive_error on failure
+     * @see open_sequential(std::string_view, std::size_t, io_mode) const
      */
     std::expected<std::unique_ptr<vfstream>, archive_error>
-    open(std::string_view filename) const;
+    open_sequential_entry(std::uint32_t index, std::size_t window_size = readahead_streambuf::default_window_size,
+                          io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Read a file's contents into caller-owned memory
+     *
+     * Stored entries are read and deflate entries inflated directly into
+     * out, without an intermediate buffer holding the uncompressed data.
+     * Size out with stat() first.
+     *
+     * @param filename The virtual path of the file within the archive
+     * @param out Destination of at least the file's uncompressed size
+     * @param io How to read the data in disk mode
+     * @return Expected containing the number of bytes written, or archive_error
+     *         (buffer_too_small if out is shorter than the file)
+     */
+    std::expected<std::size_t, archive_error>
+    read(std::string_view filename, std::span<std::byte> out, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Read a file's contents into caller-owned memory using a pre-hashed path key
+     * @param key Path and its precomputed hash
+     * @param out Destination of at least the file's uncompressed size
+     * @param io How to read the data in disk mode
+     * @return Expected containing the number of bytes written, or archive_error on failure
+     */
+    std::expected<std::size_t, archive_error>
+    read(const path_key& key, std::span<std::byte> out, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Read an entry's contents into caller-owned memory by directory index
+     * @param index Entry index previously returned by find()
+     * @param out Destination of at least the entry's uncompressed size
+     * @param io How to read the data in disk mode
+     * @return Expected containing the number of bytes written, or archive_error on failure
+     */
+    std::expected<std::size_t, archive_error>
+    read_entry(std::uint32_t index, std::span<std::byte> out, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Read the stored (possibly compressed) bytes of an entry
+     *
+     * Together with decode_entry() this splits open_entry() into its I/O and
+     * CPU halves so they can run on different threads.
+     *
+     * @param index Entry index previously returned by find()
+     * @param io How to read the data in disk mode
+     * @return Expected containing the stored bytes on success, or archive_error on failure
+     */
+    std::expected<std::vector<std::byte>, archive_error>
+    read_raw_entry(std::uint32_t index, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Read part of the stored bytes of an entry
+     *
+     * Lets callers look at a blob header, such as a delta's base reference,
+     * without reading the whole blob.
+     *
+     * @param index Entry index previously returned by find()
+     * @param offset Byte offset within the stored bytes
+     * @param out Destination; the range must lie within the stored bytes
+     * @return Expected void on success, or archive_error on failure
+     */
+    std::expected<void, archive_error>
+    read_raw_range(std::uint32_t index, std::uint64_t offset, std::span<std::byte> out) const;
+
+    /**
+     * @brief Copy the stored bytes of an entry into another file
+     *
+     * In disk mode the bytes go file to file with file_writer::copy_from()
+     * and never pass through a heap buffer of the blob's size.
+     *
+     * @param index Entry index previously returned by find()
+     * @param out File to write to
+     * @param offset Byte offset in out to write the bytes at
+     * @return Expected void on success, or archive_error on failure
+     */
+    std::expected<void, archive_error>
+    copy_raw_entry(std::uint32_t index, const file_writer& out, std::uint64_t offset) const;
+
+    /**
+     * @brief Decode stored bytes previously returned by read_raw_entry()
+     *
+     * Delta entries are decoded against the archive set with
+     * set_delta_base() and fail with compression_error without one.
+     *
+     * @param index Entry index the bytes were read from
+     * @param raw Stored bytes of the entry
+     * @return Expected containing the file contents on success, or archive_error on failure
+     */
+    std::expected<std::vector<std::byte>, archive_error>
+    decode_entry(std::uint32_t index, std::vector<std::byte> raw) const;
+
+    /**
+     * @brief Read the stored bytes of several entries, one thread per volume
+     *
+     * Entries are grouped by volume and each volume is read in offset order
+     * on its own thread, so archives striped over several drives are read
+     * with their combined bandwidth. Single-volume archives are read on the
+     * calling thread.
+     *
+     * @param indices Entry indices previously returned by find()
+     * @param io How to read the data in disk mode
+     * @return One result per index, in the order of indices
+     */
+    std::vector<std::expected<std::vector<std::byte>, archive_error>>
+    read_raw_entries(std::span<const std::uint32_t> indices, io_mode io = io_mode::automatic) const;
+
+    /**
+     * @brief Check that an entry is intact
+     *
+     * The stored bytes must lie inside the data area, decode to exactly
+     * uncompressed_size bytes and, if the archive stores entry metadata,
+     * hash to the stored checksum. Delta entries need set_delta_base().
+     *
+     * @param index Entry index to check
+     * @return Expected void if the entry is intact, or archive_error describing the fault
+     */
+    std::expected<void, archive_error> verify_entry(std::uint32_t index) const;
+
+    /**
+     * @brief Check every entry, spreading the work over several threads
+     *
+     * Threads take entries in ascending (volume, offset) order, so the
+     * archive is read front to back rather than in directory order. The
+     * thread count is capped at four per hardware thread and at the number
+     * of entries.
+     *
+     * @param threads Number of worker threads (0 uses all hardware threads)
+     * @return Failing entries, sorted by entry index (empty if the archive is intact)
+     */
+    std::vector<verify_failure> verify(unsigned threads = 0) const;
+
+    /**
+     * @brief Get the number of directory entries
+     * @return Entry count; valid indices are 0 to entry_count() - 1
+     */
+    std::size_t entry_count() const { return entries_.size(); }
+
+    /**
+     * @brief Get the memory resource directory and file buffers come from
+     * @return The resource passed to the constructor
+     */
+    std::pmr::memory_resource* memory_resource() const noexcept { return resource_; }
+
+    /**
+     * @brief Get the number of volume files holding the entry data
+     * @return Volume count (1 for single-file archives)
+     */
+    std::uint32_t volume_count() const { return volume_count_; }
 
     /**
      * @brief Check if the archive contains a specific file
@@ -81,12 +358,146 @@ public:
      */
     bool contains(std::string_view filename) const;
 
+    /**
+     * @brief Check if the archive contains a file using a pre-hashed path key
+     * @param key Path and its precomputed hash, e.g. "config/app.json"_dp
+     * @return True if the file exists in the archive, false otherwise
+     */
+    bool contains(const path_key& key) const;
+
+    /**
+     * @brief Check whether the archive marks a path as deleted
+     *
+     * Patch archives record deletions relative to their base as tombstones;
+     * a vfs stops searching lower-precedence archives at a tombstone.
+     *
+     * @param filename The virtual path to check
+     * @return True if the path has a tombstone under the current lookup mode
+     */
+    bool has_tombstone(std::string_view filename) const;
+
+    /**
+     * @brief Get the paths this archive marks as deleted
+     * @return Tombstoned paths, sorted
+     */
+    const std::vector<std::string>& tombstones() const { return tombstones_; }
+
+    /**
+     * @brief Find the directory entry matching a path under the current lookup mode
+     *
+     * Entry indices are stable for the lifetime of the archive object.
+     *
+     * @param filename The virtual path to look up
+     * @return Entry index on success, or std::nullopt if not found
+     */
+    std::optional<std::uint32_t> find(std::string_view filename) const;
+
+    /**
+     * @brief Find the directory entry matching a pre-hashed path key
+     * @param key Path and its precomputed hash
+     * @return Entry index on success, or std::nullopt if not found
+     */
+    std::optional<std::uint32_t> find(const path_key& key) const;
+
+    /**
+     * @brief Get metadata for a file in the archive
+     * @param filename The virtual path of the file
+     * @return Expected containing file_stat on success, or archive_error on failure
+     */
+    std::expected<file_stat, archive_error> stat(std::string_view filename) const;
+
+    /**
+     * @brief Get metadata for a file by its directory entry index
+     * @param index Entry index previously returned by find()
+     * @return Expected containing file_stat on success, or archive_error on failure
+     */
+    std::expected<file_stat, archive_error> stat_entry(std::uint32_t index) const;
+
+    /**
+     * @brief Use direct I/O for io_mode::automatic reads of large entries
+     *
+     * Entries whose stored size is at least the threshold bypass the page
+     * cache, so streaming huge files once does not evict hot small files.
+     * Pair with archive_builder::set_alignment() to avoid partial blocks.
+     *
+     * @param bytes Minimum stored size for direct I/O (0 disables it)
+     */
+    void set_direct_io_threshold(std::uint64_t bytes) { direct_io_threshold_ = bytes; }
+
+    /**
+     * @brief Get the direct I/O size threshold
+     * @return Threshold in bytes, or 0 if disabled
+     */
+    std::uint64_t get_direct_io_threshold() const { return direct_io_threshold_; }
+
+    /**
+     * @brief Set the archive that compression_method::delta entries are decoded against
+     *
+     * Only needed when using the archive on its own; a vfs resolves delta
+     * bases through the archives mounted below this one.
+     *
+     * @param base Archive containing the base entries, or nullptr to clear
+     */
+    void set_delta_base(std::shared_ptr<const archive> base) { delta_base_ = std::move(base); }
+
+    /**
+     * @brief Limit the memory used to cache chunks of compression_method::chunked entries
+     *
+     * Entries built with archive_builder::set_chunk_dedup() are reassembled
+     * from chunks; cached chunks are reused by every entry that shares them.
+     * The default capacity is DEFAULT_CHUNK_CACHE_CAPACITY.
+     *
+     * @param bytes Maximum total size of cached chunks (0 disables the cache)
+     */
+    void set_chunk_cache_capacity(std::size_t bytes) { chunk_cache_->set_capacity(bytes); }
+
+    /**
+     * @brief Get the number of unique chunks stored in the archive
+     * @return Chunk table size, or 0 if the archive has no chunked entries
+     */
+    std::size_t chunk_count() const { return chunks_.size(); }
+
+    /** @brief Default chunk cache capacity in bytes */
+    static constexpr std::size_t DEFAULT_CHUNK_CACHE_CAPACITY = 8 * 1024 * 1024;
+
+    /** @brief Most verify() worker threads per hardware thread */
+    static constexpr unsigned MAX_VERIFY_THREADS_PER_CORE = 4;
+
+    /**
+     * @brief Get the path of the archive file
+     * @return Path the archive was opened from
+     */
+    const std::filesystem::path& path() const { return path_; }
+
+    /**
+     * @brief Get the hash function identifier recorded in the archive
+     *
+     * Compare against PATH_HASH_ID to detect archives whose persisted hashes
+     * were written by a different hash function. Such sections are ignored at
+     * load time and rebuilt in memory, so path_key lookups stay correct.
+     *
+     * @return Recorded identifier, or 0 if the archive stores no path hashes
+     */
+    std::uint32_t path_hash_id() const { return path_hash_id_; }
+
     /**
      * @brief Get a list of all files in the archive
-     * @return Vector of virtual file paths within the archive
+     * @return Vector of virtual file paths within the archive, in directory order
      */
     std::vector<std::string> list_files() const;
 
+    /**
+     * @brief Set how lookup paths are matched against stored paths
+     * @param mode The lookup mode to use
+     */
+    void set_lookup_mode(lookup_mode mode) { lookup_mode_ = mode; }
+
+    /**
+     * @brief Get the current lookup mode
+     * @return The current lookup mode setting
+     */
+    lookup_mode get_lookup_mode() const { return lookup_mode_; }
+
     /**
      * @brief Create an archive reader from file path
      * @param path Path to the DataPak archive file
@@ -105,16 +516,74 @@ private:
     /**
      * @brief Read and decompress file data for a directory entry
      * @param entry The directory entry describing the file
+     * @param io How to read the data in disk mode
      * @return Expected containing decompressed file data on success, or archive_error on failure
      */
     std::expected<std::vector<std::byte>, archive_error>
-    read_file_data(const directory_entry& entry) const;
+    read_file_data(const directory_record& entry, io_mode io) const;
+
+    /**
+     * @brief Read the stored bytes of a directory entry into caller memory
+     * @param entry The directory entry describing the file
+     * @param io How to read the data in disk mode
+     * @param out Destination of exactly entry.compressed_size bytes
+     * @return Expected void on success, or archive_error on failure
+     */
+    std::expected<void, archive_error>
+    read_file_data(const directory_record& entry, io_mode io, std::span<std::byte> out) const;
+
+    /**
+     * @brief Open and check the volume files of a multi-volume archive
+     * @param count Number of volumes recorded in the volume section
+     * @param build_id Build identifier recorded in the volume section
+     * @return Expected void on success, or archive_error on failure
+     */
+    std::expected<void, archive_error> open_volumes(std::uint32_t count, std::uint64_t build_id);
+
+    /**
+     * @brief Resolve io_mode::automatic against the direct I/O threshold
+     * @param entry The directory entry being read
+     * @param io Requested I/O mode
+     * @return io_mode::buffered or io_mode::direct
+     */
+    io_mode resolve_io_mode(const directory_record& entry, io_mode io) const;
+
+    /**
+     * @brief Get the decompressed contents of a chunk, through the chunk cache
+     * @param index Chunk table index
+     * @return Expected containing the chunk contents on success, or archive_error on failure
+     */
+    std::expected<chunk_cache::chunk_data, archive_error> read_chunk(std::uint32_t index) const;
+
+    /**
+     * @brief Reassemble a chunked entry from its stored chunk index list
+     * @param indices Stored bytes of a compression_method::chunked entry
+     * @param out Destination of exactly the entry's uncompressed size
+     * @return Expected void on success, or archive_error on failure
+     */
+    std::expected<void, archive_error>
+    assemble_chunks(std::span<const std::byte> indices, std::span<std::byte> out) const;
 
     std::filesystem::path path_;                                    /**< Path to archive file */
     access_mode mode_;                                              /**< Access mode */
-    mutable std::ifstream file_stream_;                             /**< File stream for disk access */
-    std::vector<std::byte> memory_data_;                            /**< Memory buffer for memory access */
-    std::unordered_map<std::string, directory_entry> directory_;   /**< Archive directory */
+    std::pmr::memory_resource* resource_;                           /**< Source of directory and file buffers */
+    std::shared_ptr<file_handle> file_;                             /**< File handle for disk access */
+    std::pmr::vector<std::byte> memory_data_;                       /**< Memory buffer for memory access */
+    std::vector<std::shared_ptr<file_handle>> volume_files_;        /**< Volume file handles (disk mode, multi-volume only) */
+    std::pmr::vector<std::pmr::vector<std::byte>> volume_data_;     /**< Volume contents (memory mode, multi-volume only) */
+    std::uint32_t volume_count_ = 1;                                /**< Number of files holding entry data */
+    std::uint64_t directory_offset_ = 0;                            /**< End of the data area in single-file archives */
+    directory_table entries_;                                       /**< Directory entries in archive order, indexed by path */
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> folded_index_; /**< Sorted (folded hash, entry index) pairs */
+    std::vector<entry_metadata> metadata_;                          /**< Per-entry metadata in directory order (empty if absent) */
+    std::vector<std::string> tombstones_;                           /**< Sorted paths deleted relative to a base archive */
+    bloom_filter bloom_;                                            /**< Filter for fast negative lookups (empty if absent) */
+    lookup_mode lookup_mode_ = lookup_mode::exact;                  /**< Path matching rules */
+    std::uint32_t path_hash_id_ = 0;                                /**< Hash function of persisted sections */
+    std::uint64_t direct_io_threshold_ = 0;                         /**< Stored size triggering direct I/O (0 = off) */
+    std::shared_ptr<const archive> delta_base_;                     /**< Base archive for delta entries (optional) */
+    std::vector<chunk_record> chunks_;                              /**< Chunk table for chunked entries (empty if absent) */
+    std::unique_ptr<chunk_cache> chunk_cache_;                      /**< Decompressed chunks shared between entries */
 };
 
 } // namespace dp
\ No newline at end of file
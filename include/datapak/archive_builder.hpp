@@ -8,13 +8,26 @@
 
 #include "format.hpp"
 #include "compression.hpp"
+#include "chunk.hpp"
+#include "filter.hpp"
+#include <cstddef>
 #include <filesystem>
 #include <fstream>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
 #include <vector>
 #include <expected>
 
 namespace dp {
 
+class archive;
+class file_writer;
+
 /**
  * @brief Error codes returned by archive builder operations
  */
@@ -25,13 +38,62 @@ enum class builder_error {
     invalid_path       /**< Invalid source or output path */
 };
 
+/**
+ * @brief Order in which file data is laid out in the archive
+ *
+ * Every policy other than insertion is deterministic, so rebuilding the same
+ * inputs produces a byte-identical archive. Ties are broken by archive path.
+ */
+enum class blob_order {
+    insertion, /**< Order in which files were added */
+    path,      /**< Lexicographic by archive path, keeping directories together */
+    extension, /**< Grouped by file extension, then by path */
+    size,      /**< Ascending uncompressed size, then by path (generated entries last) */
+    manifest   /**< Paths listed in the manifest first, in manifest order; the rest by path */
+};
+
+/**
+ * @brief Callback producing the contents of a generated archive entry
+ *
+ * Invoked once per build() call, when the entry's data is written. Patch
+ * builds (see archive_builder::set_patch_base()) invoke it earlier, to compare
+ * the contents with the base archive, and keep the result of changed entries
+ * until they are written.
+ */
+using content_generator = std::function<std::expected<std::vector<std::byte>, builder_error>()>;
+
+/**
+ * @brief Entry data that is already encoded with its compression method
+ */
+struct encoded_blob {
+    std::vector<std::byte> data;        /**< Stored bytes, written verbatim */
+    std::uint64_t uncompressed_size;    /**< Size of the decoded contents */
+    std::uint64_t checksum;             /**< content_hash() of the decoded contents (0 if unknown) */
+};
+
+/**
+ * @brief Callback producing the stored bytes of a pre-encoded archive entry
+ *
+ * Invoked once per build() call, in output order, like content_generator.
+ */
+using encoded_generator = std::function<std::expected<encoded_blob, builder_error>()>;
+
 /**
  * @brief Represents a file to be added to an archive
+ *
+ * The stored bytes come from copy_source if set, then from the encoded
+ * generator if set. Otherwise the contents come from the generator if set,
+ * otherwise from source_path if it is not empty, otherwise from data.
  */
 struct file_entry {
     std::filesystem::path source_path; /**< Path to source file on disk */
     std::string archive_path;          /**< Virtual path within the archive */
     compression_method compression;    /**< Compression method to use */
+    std::vector<std::byte> data;       /**< In-memory contents */
+    content_generator generator;       /**< Callback producing the contents */
+    encoded_generator encoded;         /**< Callback producing already-encoded bytes */
+    std::shared_ptr<const archive> copy_source; /**< Archive whose stored bytes are copied verbatim */
+    std::uint32_t copy_entry = 0;      /**< Entry index within copy_source */
 };
 
 /**
@@ -59,8 +121,78 @@ public:
                   const std::string& archive_path,
                   compression_method compression = compression_method::none);
 
+    /**
+     * @brief Add a file whose contents are copied from memory
+     * @param archive_path Virtual path for the file within the archive
+     * @param data File contents
+     * @param compression Compression method to use (none means use default)
+     */
+    void add_buffer(const std::string& archive_path,
+                    std::span<const std::byte> data,
+                    compression_method compression = compression_method::none);
+
+    /**
+     * @brief Add a file whose contents are moved in from memory
+     * @param archive_path Virtual path for the file within the archive
+     * @param data File contents, taken over without copying
+     * @param compression Compression method to use (none means use default)
+     */
+    void add_buffer(const std::string& archive_path,
+                    std::vector<std::byte>&& data,
+                    compression_method compression = compression_method::none);
+
+    /**
+     * @brief Add a file whose contents are produced on demand during build()
+     *
+     * Only one generated entry is held in memory at a time, so large asset
+     * sets can be packed without staging them on disk or in memory. A
+     * generator error aborts the build and is returned from build().
+     *
+     * @param archive_path Virtual path for the file within the archive
+     * @param generator Callback producing the contents
+     * @param compression Compression method to use (none means use default)
+     */
+    void add_generator(const std::string& archive_path,
+                       content_generator generator,
+                       compression_method compression = compression_method::none);
+
+    /**
+     * @brief Add an entry whose stored bytes are produced already encoded
+     *
+     * The bytes are written verbatim, bypassing compression, chunking,
+     * reference reuse and patch deltas, which lets tools copy blobs between
+     * archives or compress them on their own threads.
+     *
+     * @param archive_path Virtual path for the file within the archive
+     * @param compression Compression method the bytes are encoded with (none means stored)
+     * @param generator Callback producing the encoded bytes
+     */
+    void add_encoded(const std::string& archive_path,
+                     compression_method compression,
+                     encoded_generator generator);
+
+    /**
+     * @brief Add an entry whose stored bytes are copied from another archive
+     *
+     * Like add_encoded(), but the blob is copied when it is written: when
+     * building to a path from a disk-mode archive the bytes go file to file
+     * (copy_file_range where supported) instead of through memory. The
+     * entry keeps its compression method, size and checksum. Chunked
+     * entries cannot be copied, since their chunks live in the source's
+     * chunk table; they fail build() with compression_error.
+     *
+     * @param archive_path Virtual path for the file within the archive
+     * @param source Archive holding the entry
+     * @param entry Entry index within source
+     */
+    void add_copy(const std::string& archive_path, std::shared_ptr<const archive> source, std::uint32_t entry);
+
     /**
      * @brief Add all files from a directory recursively
+     *
+     * Files are added sorted by archive path, independent of the order in
+     * which the file system enumerates them.
+     *
      * @param directory_path Path to source directory on disk
      * @param archive_prefix Prefix to prepend to archive paths
      * @param compression Compression method to use (none means use default)
@@ -77,6 +209,22 @@ public:
     std::expected<void, builder_error>
     build(const std::filesystem::path& output_path);
 
+    /**
+     * @brief Build the archive into a byte sink that need not be seekable
+     *
+     * Not available for multi-volume archives (see set_volume_count()),
+     * which return builder_error::invalid_path.
+     *
+     * The output is written strictly front to back, so it can go to a pipe,
+     * socket or std::cout. Instead of patching the header afterwards, the
+     * directory is located by an archive_trailer at the end of the stream.
+     *
+     * @param output Stream receiving the archive bytes
+     * @return Expected void on success, or builder_error on failure
+     */
+    std::expected<void, builder_error>
+    build(std::ostream& output);
+
     /**
      * @brief Set the default compression method for new files
      * @param compression The compression method to use as default
@@ -85,6 +233,208 @@ public:
         default_compression_ = compression;
     }
 
+    /**
+     * @brief Enable or disable emitting a Bloom filter over archive paths
+     *
+     * The filter lets readers reject lookups for absent files without probing
+     * the directory. It costs roughly 10 bits per entry and is enabled by default.
+     *
+     * @param enable True to emit the filter, false to omit it
+     */
+    void set_bloom_filter(bool enable) { bloom_filter_enabled_ = enable; }
+
+    /**
+     * @brief Enable or disable storing normalized, case-folded path hashes
+     *
+     * Readers use the stored hashes to serve lookup_mode::normalized and
+     * lookup_mode::case_insensitive lookups without hashing every path at
+     * load time. Costs 8 bytes per entry and is enabled by default.
+     *
+     * @param enable True to store the hashes, false to omit them
+     */
+    void set_folded_hashes(bool enable) { folded_hashes_enabled_ = enable; }
+
+    /**
+     * @brief Align the start of every stored blob
+     *
+     * With an alignment of file_handle::direct_io_alignment, direct I/O reads
+     * of an entry start on a block boundary and waste no bytes at the front.
+     *
+     * @param bytes Alignment in bytes (1 disables padding)
+     */
+    void set_alignment(std::uint32_t bytes) { alignment_ = bytes == 0 ? 1 : bytes; }
+
+    /**
+     * @brief Spread file data across several volume files
+     *
+     * With more than one volume, build() writes the header, directory and
+     * sections to the output path and the blobs to output_path.000,
+     * output_path.001 and so on, placing each blob in the volume holding
+     * the fewest bytes so far. Putting the volumes on different drives lets
+     * archive::read_raw_entries() and the batched vfs::read() read them in
+     * parallel. Every build stamps its volumes with a fresh random
+     * identifier so stale volume files are rejected; multi-volume builds
+     * are therefore not byte-identical across runs.
+     *
+     * @param count Number of volume files (1 keeps everything in one file)
+     */
+    void set_volume_count(std::uint32_t count) { volume_count_ = std::clamp<std::uint32_t>(count, 1, MAX_VOLUME_COUNT); }
+
+    /**
+     * @brief Set the order in which file data and directory entries are written
+     *
+     * Placing related files next to each other improves readahead when they
+     * are read together.
+     *
+     * @param order The ordering policy (insertion by default)
+     */
+    void set_blob_order(blob_order order) { blob_order_ = order; }
+
+    /**
+     * @brief Set the explicit path order used by blob_order::manifest
+     * @param paths Archive paths in the desired order
+     */
+    void set_manifest(std::vector<std::string> paths) { manifest_ = std::move(paths); }
+
+    /**
+     * @brief Enable or disable storing per-entry checksums and source mtimes
+     *
+     * The metadata lets a later build() that uses this archive as its
+     * reference skip unchanged files. Costs 16 bytes per entry plus hashing
+     * each file's contents, and is enabled by default. Source mtimes are
+     * stored as 0 unless set_source_mtimes() enables them.
+     *
+     * @param enable True to store the metadata, false to omit it
+     */
+    void set_entry_metadata(bool enable) { entry_metadata_enabled_ = enable; }
+
+    /**
+     * @brief Enable or disable recording source mtimes in the entry metadata
+     *
+     * With mtimes recorded, a later build() using this archive as its
+     * reference skips reading sources whose size and mtime are unchanged,
+     * but the archive bytes then depend on when the files were checked out.
+     * Disabled by default so that identical inputs give byte-identical
+     * archives; unchanged files are then recognised by content hash.
+     *
+     * @param enable True to record mtimes, false to store 0
+     */
+    void set_source_mtimes(bool enable) { source_mtimes_enabled_ = enable; }
+
+    /**
+     * @brief Enable or disable content-defined chunk deduplication
+     *
+     * When enabled, every written file is split into chunks with FastCDC and
+     * stored as compression_method::chunked: a list of indices into a chunk
+     * table in which each unique chunk is stored once. Files that share most
+     * of their bytes, such as variants of the same level or texture, then
+     * cost little more than their differences. Chunks are compressed one by
+     * one with the file's compression method, which compresses worse than
+     * whole files, and reads go through the archive's chunk cache. Chunks
+     * are matched by length and a 128-bit hash, so build() keeps a few dozen
+     * bytes per unique chunk rather than the chunk data. Disabled by default.
+     *
+     * @param enable True to deduplicate chunks, false to store whole files
+     * @param params Chunk size limits
+     */
+    void set_chunk_dedup(bool enable, const chunk_params& params = {}) {
+        chunk_dedup_enabled_ = enable;
+        chunk_params_ = params;
+    }
+
+    /**
+     * @brief Use a previous build of this archive to skip unchanged files
+     *
+     * For every added file whose path and compression method match an entry
+     * of the reference that stores metadata, build() copies the compressed
+     * blob verbatim instead of recompressing. A file counts as unchanged if
+     * its size and mtime match (the source is then not read at all; only
+     * when the reference was built with set_source_mtimes()) or if its size
+     * and content hash match. The output path must differ from the
+     * reference path.
+     *
+     * @param previous_archive Path of the archive produced by an earlier build
+     * @return Expected void on success, or builder_error if it cannot be opened
+     */
+    std::expected<void, builder_error>
+    set_reference(const std::filesystem::path& previous_archive);
+
+    /**
+     * @brief Stop reusing blobs from the reference archive
+     */
+    void clear_reference();
+
+    /**
+     * @brief Mark a path as deleted in the archive being built
+     *
+     * When the archive is mounted above another in a vfs, the path is hidden
+     * in that archive and in every other archive of lower precedence.
+     *
+     * @param archive_path Virtual path to delete
+     */
+    void add_tombstone(const std::string& archive_path);
+
+    /**
+     * @brief Build a patch against a base archive instead of a full archive
+     *
+     * build() then writes only files that are new or whose contents differ
+     * from the base, plus a tombstone for every base path that was not
+     * added. Mounting the patch above the base in a vfs reproduces the full
+     * set of added files. Contents are compared by size and content hash;
+     * size and mtime are enough when the base stores source mtimes.
+     *
+     * @param base_archive Path of the archive the patch applies to
+     * @return Expected void on success, or builder_error if it cannot be opened
+     */
+    std::expected<void, builder_error>
+    set_patch_base(const std::filesystem::path& base_archive);
+
+    /**
+     * @brief Enable or disable storing changed patch entries as binary deltas
+     *
+     * When enabled, a file that exists in the patch base with different
+     * contents is stored as compression_method::delta whenever the delta is
+     * smaller than the normally compressed blob. Reading such an entry needs
+     * the base version, which a vfs finds in the archives mounted below the
+     * patch. Enabled by default.
+     *
+     * @param enable True to try deltas, false to always store full contents
+     */
+    void set_patch_deltas(bool enable) { patch_deltas_enabled_ = enable; }
+
+    /**
+     * @brief Filter an entry's contents before compressing it
+     *
+     * The entry is stored as compression_method::filtered with its own
+     * compression method inside, which helps arrays of fixed-size records
+     * (shuffle or delta by the record or component size) and x86 code
+     * (bcj_x86). Ignored for entries written through chunk dedup or
+     * add_encoded(). An invalid element size fails build() with
+     * builder_error::compression_error.
+     *
+     * @param archive_path Virtual path of the entry
+     * @param filter Filter to apply (none removes an earlier setting)
+     * @param element_size Element size for shuffle, distance for delta
+     */
+    void set_filter(const std::string& archive_path, filter_type filter, std::size_t element_size = 1) {
+        if (filter == filter_type::none) {
+            filters_.erase(archive_path);
+        } else {
+            filters_.insert_or_assign(archive_path, std::pair{filter, element_size});
+        }
+    }
+
+    /**
+     * @brief Go back to building full archives
+     */
+    void clear_patch_base();
+
+    /**
+     * @brief Get the number of blobs the last build() copied from the reference
+     * @return Number of reused entries
+     */
+    std::size_t reused_count() const { return reused_count_; }
+
     /**
      * @brief Get the number of files currently added to the builder
      * @return Number of files that will be included in the archive
@@ -92,8 +442,137 @@ public:
     std::size_t file_count() const { return files_.size(); }
 
 private:
+    /**
+     * @brief Callback results produced while selecting patch entries
+     *
+     * Kept until the entry is written so that no callback runs twice.
+     */
+    struct produced_entry {
+        std::optional<std::vector<std::byte>> contents; /**< Result of the entry's content_generator */
+        std::optional<encoded_blob> blob;               /**< Result of the entry's encoded_generator */
+    };
+
+    /**
+     * @brief Chunks written so far by a chunk deduplicating build
+     */
+    struct chunk_table {
+        /**
+         * @brief Identity of a chunk: length and two independently seeded XXH64 hashes
+         *
+         * The 128 bits of hash make an accidental collision negligible even
+         * across billions of chunks, so a match is trusted without keeping
+         * the chunk bytes around for comparison.
+         */
+        struct digest {
+            std::uint64_t hash;   /**< XXH64, seed 0 */
+            std::uint64_t hash2;  /**< XXH64, second seed */
+            std::uint32_t size;   /**< Chunk length in bytes */
+
+            auto operator<=>(const digest&) const = default;
+        };
+
+        std::vector<chunk_record> records;                     /**< Chunk table in index order */
+        std::map<digest, std::uint32_t> by_digest;             /**< Chunk digest to chunk index */
+    };
+
+    /**
+     * @brief Destination of blob data: the archive itself or its volume files
+     */
+    struct blob_sink {
+        std::vector<std::ostream*> streams;  /**< One stream per volume */
+        std::vector<std::uint64_t> offsets;  /**< Bytes written to each stream so far */
+        std::vector<const file_writer*> writers; /**< Positional writer on each stream's file (empty if not files) */
+
+        /**
+         * @brief Write a blob to the stream holding the fewest bytes
+         * @param data Blob bytes
+         * @param alignment Alignment of the blob start in bytes
+         * @return Expected containing the volume index and blob offset, or builder_error on failure
+         */
+        std::expected<std::pair<std::uint32_t, std::uint64_t>, builder_error>
+        write(std::span<const std::byte> data, std::uint32_t alignment);
+
+        /**
+         * @brief Copy the stored bytes of another archive's entry to the stream holding the fewest bytes
+         * @param source Archive holding the entry
+         * @param entry Entry index within source
+         * @param size Stored size of the entry
+         * @param alignment Alignment of the blob start in bytes
+         * @return Expected containing the volume index and blob offset, or builder_error on failure
+         */
+        std::expected<std::pair<std::uint32_t, std::uint64_t>, builder_error>
+        copy(const archive& source, std::uint32_t entry, std::uint64_t size, std::uint32_t alignment);
+
+        /**
+         * @brief Pick the stream holding the fewest bytes and pad it to an alignment boundary
+         * @param alignment Alignment of the next blob start in bytes
+         * @return Index of the chosen stream
+         */
+        std::uint32_t place(std::uint32_t alignment);
+    };
+
+    /**
+     * @brief Split data into chunks and write the ones not yet stored
+     * @param sink Destination of the chunk data
+     * @param data File contents
+     * @param compression Compression method for new chunks
+     * @param chunks Chunks written so far; new chunks are appended
+     * @return Expected containing the entry blob (32-bit chunk indices), or builder_error on failure
+     */
+    std::expected<std::vector<std::byte>, builder_error>
+    write_chunks(blob_sink& sink, std::span<const std::byte> data,
+                 compression_method compression, chunk_table& chunks) const;
+
+    /**
+     * @brief Compute the order in which files are written
+     * @return Indices into files_ in output order
+     */
+    std::vector<std::size_t> output_order() const;
+
+    /**
+     * @brief Write the archive to a stream
+     * @param output Stream receiving the archive bytes
+     * @param seekable True to patch the header in place, false to write a trailer
+     * @param volumes Streams receiving the blob data of a multi-volume archive (empty for one file)
+     * @param writers Positional writers on the files receiving blob data, in the order of volumes
+     *        (or just output for one file); empty if the output is not a file
+     * @return Expected void on success, or builder_error on failure
+     */
+    std::expected<void, builder_error>
+    write_archive(std::ostream& output, bool seekable, std::span<std::ostream* const> volumes = {},
+                  std::span<const file_writer* const> writers = {});
+
+    /**
+     * @brief Drop files whose contents match the patch base and collect deletions
+     * @param order Indices into files_ in output order
+     * @param tombstones Receives base paths missing from files_
+     * @param produced Receives one element per returned index, holding the callback results
+     *        already obtained for that entry
+     * @return Expected containing the indices to write, or builder_error on failure
+     */
+    std::expected<std::vector<std::size_t>, builder_error>
+    select_patch_entries(const std::vector<std::size_t>& order,
+                         std::vector<std::string>& tombstones,
+                         std::vector<produced_entry>& produced) const;
+
     std::vector<file_entry> files_;             /**< List of files to include in archive */
     compression_method default_compression_;    /**< Default compression method */
+    bool bloom_filter_enabled_ = true;          /**< Emit a Bloom filter section */
+    bool folded_hashes_enabled_ = true;         /**< Emit a folded path hash section */
+    std::uint32_t alignment_ = 1;               /**< Blob start alignment in bytes */
+    blob_order blob_order_ = blob_order::insertion; /**< Layout policy for file data */
+    std::vector<std::string> manifest_;         /**< Path order for blob_order::manifest */
+    bool entry_metadata_enabled_ = true;        /**< Emit an entry metadata section */
+    bool source_mtimes_enabled_ = false;        /**< Record source mtimes in the entry metadata */
+    std::shared_ptr<const archive> reference_;  /**< Previous build to copy unchanged blobs from */
+    std::size_t reused_count_ = 0;              /**< Blobs copied from reference_ by the last build */
+    std::vector<std::string> tombstones_;       /**< Paths explicitly marked as deleted */
+    std::shared_ptr<const archive> patch_base_; /**< Base archive when building a patch */
+    bool patch_deltas_enabled_ = true;          /**< Store changed patch entries as deltas when smaller */
+    bool chunk_dedup_enabled_ = false;          /**< Store files as lists of deduplicated chunks */
+    chunk_params chunk_params_;                 /**< Chunk size limits for chunk_dedup_enabled_ */
+    std::uint32_t volume_count_ = 1;            /**< Number of volume files for blob data */
+    std::map<std::string, std::pair<filter_type, std::size_t>> filters_; /**< Pre-compression filter and element size by path */
 };
 
 } // namespace dp
\ No newline at end of file
@@ -0,0 +1,348 @@
+/**
+ * @file async.hpp
+ * @brief C++20 coroutine API for non-blocking archive reads
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "vfs.hpp"
+#include <concepts>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <expected>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace dp {
+
+/**
+ * @brief An executor that can resume coroutines
+ *
+ * Any type with a schedule(std::coroutine_handle<>) member qualifies, so
+ * the async operations below can hand results back to an existing event
+ * loop or executor.
+ */
+template <typename S>
+concept scheduler = requires(S& s, std::coroutine_handle<> handle) {
+    s.schedule(handle);
+};
+
+/**
+ * @brief Fixed-size pool of worker threads that resumes coroutines in FIFO order
+ */
+class thread_pool {
+public:
+    /**
+     * @brief Start the worker threads
+     * @param threads Number of workers (at least one is started)
+     */
+    explicit thread_pool(unsigned threads);
+
+    /**
+     * @brief Drain remaining work and join all workers
+     */
+    ~thread_pool();
+
+    // Disable copy and move operations; workers reference this object
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /**
+     * @brief Queue a coroutine to be resumed on a worker thread
+     * @param handle The coroutine to resume
+     */
+    void schedule(std::coroutine_handle<> handle);
+
+    /**
+     * @brief Get the number of worker threads
+     * @return Worker count
+     */
+    std::size_t size() const noexcept { return workers_.size(); }
+
+private:
+    /**
+     * @brief Worker loop resuming queued coroutines until shutdown
+     */
+    void run();
+
+    std::mutex mutex_;                           /**< Guards queue_ and stopping_ */
+    std::condition_variable ready_;              /**< Signals queued work or shutdown */
+    std::deque<std::coroutine_handle<>> queue_;  /**< Coroutines waiting to resume */
+    bool stopping_ = false;                      /**< Set when the pool is shutting down */
+    std::vector<std::jthread> workers_;          /**< Worker threads */
+};
+
+static_assert(scheduler<thread_pool>);
+
+/**
+ * @brief Thread pools backing the async archive operations
+ *
+ * Blocking positional reads run on the I/O pool and decompression runs on
+ * the decode pool, so neither ever blocks the caller's executor. One engine
+ * can be shared by any number of concurrent operations.
+ */
+class async_engine {
+public:
+    /**
+     * @brief Create the I/O and decode pools
+     * @param io_threads Number of threads issuing reads
+     * @param decode_threads Number of threads decompressing (0 means hardware concurrency)
+     */
+    explicit async_engine(unsigned io_threads = 2, unsigned decode_threads = 0);
+
+    /**
+     * @brief Get the pool that performs file reads
+     * @return The I/O pool
+     */
+    thread_pool& io() noexcept { return io_; }
+
+    /**
+     * @brief Get the pool that performs decompression
+     * @return The decode pool
+     */
+    thread_pool& decode() noexcept { return decode_; }
+
+private:
+    thread_pool io_;      /**< Pool for blocking reads */
+    thread_pool decode_;  /**< Pool for decompression */
+};
+
+/**
+ * @brief Awaitable that resumes the awaiting coroutine on a scheduler
+ * @param s The scheduler to continue on
+ * @return Awaitable to co_await
+ */
+template <scheduler S>
+auto resume_on(S& s) noexcept {
+    struct awaiter {
+        S& target;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { target.schedule(handle); }
+        void await_resume() const noexcept {}
+    };
+    return awaiter{s};
+}
+
+/**
+ * @brief Lazily started coroutine producing a value of type T
+ *
+ * The coroutine body runs when the task is first awaited, and the awaiting
+ * coroutine is resumed by symmetric transfer when the body completes.
+ */
+template <typename T>
+class task {
+public:
+    struct promise_type {
+        std::optional<T> value;                  /**< Result once complete */
+        std::exception_ptr error;                /**< Escaped exception, if any */
+        std::coroutine_handle<> continuation;    /**< Coroutine awaiting this task */
+
+        task get_return_object() noexcept {
+            return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        auto final_suspend() noexcept {
+            struct final_awaiter {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    const auto next = handle.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+                void await_resume() const noexcept {}
+            };
+            return final_awaiter{};
+        }
+
+        template <typename U>
+            requires std::convertible_to<U&&, T>
+        void return_value(U&& result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+    };
+
+    task(task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            std::coroutine_handle<promise_type> handle;
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() {
+                if (handle.promise().error) {
+                    std::rethrow_exception(handle.promise().error);
+                }
+                return std::move(*handle.promise().value);
+            }
+        };
+        return awaiter{handle_};
+    }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_; /**< Owned coroutine frame */
+};
+
+namespace detail {
+
+/**
+ * @brief Eagerly started, self-destroying coroutine used to drive tasks
+ */
+struct detached_task {
+    struct promise_type {
+        detached_task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+template <typename T>
+detached_task run_and_signal(task<T> work, std::optional<T>& result,
+                             std::exception_ptr& error, std::binary_semaphore& done) {
+    try {
+        result.emplace(co_await std::move(work));
+    } catch (...) {
+        error = std::current_exception();
+    }
+    done.release();
+}
+
+} // namespace detail
+
+/**
+ * @brief Block the calling thread until a task completes
+ * @param work The task to run
+ * @return The task's result; exceptions escaping the task are rethrown
+ */
+template <typename T>
+T sync_wait(task<T> work) {
+    std::optional<T> result;
+    std::exception_ptr error;
+    std::binary_semaphore done{0};
+
+    detail::run_and_signal(std::move(work), result, error, done);
+    done.acquire();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return std::move(*result);
+}
+
+/**
+ * @brief Read a file's full contents without blocking the caller's executor
+ *
+ * The path is resolved on the calling thread, the stored bytes are read on
+ * the engine's I/O pool, compressed entries are decoded on its decode pool,
+ * and the awaiting coroutine resumes on sched. The vfs file cache is not
+ * consulted. The vfs must not be mounted into or unmounted from while the
+ * path is being resolved; afterwards the operation holds its own reference
+ * to the archive.
+ *
+ * @param fs The virtual file system to read from
+ * @param filename Virtual path of the file (copied into the coroutine frame)
+ * @param engine Pools performing the I/O and decompression
+ * @param sched Scheduler the awaiting coroutine resumes on
+ * @return Task producing the file contents, or vfs_error on failure
+ */
+template <scheduler S>
+task<std::expected<std::vector<std::byte>, vfs_error>>
+co_read(const vfs& fs, std::string filename, async_engine& engine, S& sched) {
+    const auto id = fs.resolve(filename);
+    if (!id) {
+        co_return std::unexpected{id.error()};
+    }
+
+    const auto arch = fs.get_archive(*id);
+    if (!arch) {
+        co_return std::unexpected{vfs_error::invalid_handle};
+    }
+
+    const auto info = arch->stat_entry(id->entry);
+    if (!info) {
+        co_return std::unexpected{vfs_error::archive_error};
+    }
+
+    // Deltas need their base resolved through the vfs; read them in one go
+    if (info->compression == compression_method::delta) {
+        co_await resume_on(engine.io());
+        auto contents = fs.read(*id);
+        co_await resume_on(sched);
+        co_return contents;
+    }
+
+    co_await resume_on(engine.io());
+    auto data = arch->read_raw_entry(id->entry);
+
+    if (data && info->compression != compression_method::none) {
+        co_await resume_on(engine.decode());
+        data = arch->decode_entry(id->entry, std::move(*data));
+    }
+
+    co_await resume_on(sched);
+
+    if (!data) {
+        co_return std::unexpected{vfs_error::archive_error};
+    }
+    co_return std::move(*data);
+}
+
+/**
+ * @brief Open a file as a stream without blocking the caller's executor
+ *
+ * Equivalent to co_read() followed by wrapping the contents in a vfstream.
+ *
+ * @param fs The virtual file system to read from
+ * @param filename Virtual path of the file (copied into the coroutine frame)
+ * @param engine Pools performing the I/O and decompression
+ * @param sched Scheduler the awaiting coroutine resumes on
+ * @return Task producing the stream, or vfs_error on failure
+ */
+template <scheduler S>
+task<std::expected<std::unique_ptr<vfstream>, vfs_error>>
+co_open(const vfs& fs, std::string filename, async_engine& engine, S& sched) {
+    auto data = co_await co_read(fs, std::move(filename), engine, sched);
+    if (!data) {
+        co_return std::unexpected{data.error()};
+    }
+    co_return std::make_unique<vfstream>(std::move(*data));
+}
+
+} // namespace dp
@@ -0,0 +1,99 @@
+/**
+ * @file bloom_filter.hpp
+ * @brief Blocked Bloom filter used for fast negative path lookups
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace dp {
+
+/**
+ * @brief Cache-friendly blocked Bloom filter over 64-bit path hashes
+ *
+ * Every key maps to a single 512-bit block (one cache line), and all probe
+ * bits for that key are set within the block. A negative query therefore
+ * touches exactly one cache line and never produces false negatives.
+ */
+class bloom_filter {
+public:
+    /** @brief Number of 64-bit words in a filter block (512 bits) */
+    static constexpr std::size_t words_per_block = 8;
+
+    /**
+     * @brief Construct an empty filter that reports every key as present
+     */
+    bloom_filter() = default;
+
+    /**
+     * @brief Construct a filter from previously serialized state
+     * @param probe_count Number of bits probed per key
+     * @param words Filter bits, a multiple of words_per_block in size
+     */
+    bloom_filter(std::uint32_t probe_count, std::vector<std::uint64_t> words);
+
+    /**
+     * @brief Build a filter containing the given hashes
+     * @param hashes The key hashes to insert
+     * @param bits_per_key Filter bits to allocate per key (10 gives ~1% false positives)
+     * @return The populated filter
+     */
+    static bloom_filter build(std::span<const std::uint64_t> hashes, std::uint32_t bits_per_key = 10);
+
+    /**
+     * @brief Check whether a key may be present
+     * @param hash Hash of the key to test
+     * @return False if the key is definitely absent, true if it may be present
+     */
+    bool may_contain(std::uint64_t hash) const noexcept;
+
+    /**
+     * @brief Check whether the filter holds any blocks
+     * @return True if the filter is empty and accepts every key
+     */
+    bool empty() const noexcept { return words_.empty(); }
+
+    /**
+     * @brief Get the number of 512-bit blocks in the filter
+     * @return Block count
+     */
+    std::uint32_t block_count() const noexcept {
+        return static_cast<std::uint32_t>(words_.size() / words_per_block);
+    }
+
+    /**
+     * @brief Get the number of bits probed per key
+     * @return Probe count
+     */
+    std::uint32_t probe_count() const noexcept { return probe_count_; }
+
+    /**
+     * @brief Get the raw filter bits for serialization
+     * @return Span over the filter words
+     */
+    std::span<const std::uint64_t> words() const noexcept { return words_; }
+
+private:
+    /**
+     * @brief Set the probe bits for a hash
+     * @param hash Hash of the key to insert
+     */
+    void insert(std::uint64_t hash) noexcept;
+
+    /**
+     * @brief Select the block a hash maps to
+     * @param hash Key hash
+     * @return Index of the first word of the block
+     */
+    std::size_t block_offset(std::uint64_t hash) const noexcept;
+
+    std::uint32_t probe_count_ = 0;     /**< Bits probed per key */
+    std::vector<std::uint64_t> words_;  /**< Filter bits, grouped in blocks */
+};
+
+} // namespace dp
@@ -0,0 +1,101 @@
+/**
+ * @file chunk.hpp
+ * @brief Content-defined chunking and the reader-side chunk cache
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace dp {
+
+/**
+ * @brief Size limits for content-defined chunking
+ *
+ * Chunk boundaries depend only on the bytes around them, so an insertion or
+ * deletion changes the chunks next to the edit and leaves the rest intact.
+ */
+struct chunk_params {
+    std::uint32_t min_size = 2 * 1024;      /**< No boundary is placed before this many bytes */
+    std::uint32_t average_size = 8 * 1024;  /**< Target chunk size (rounded down to a power of two) */
+    std::uint32_t max_size = 64 * 1024;     /**< A boundary is forced after this many bytes */
+};
+
+/**
+ * @brief Find the end of the first chunk of data using FastCDC
+ *
+ * A gear rolling hash is evaluated from min_size onwards. Below average_size
+ * a boundary needs two more zero hash bits than above it (normalized
+ * chunking), which keeps chunk sizes close to the average.
+ *
+ * @param data Remaining bytes to split
+ * @param params Chunk size limits
+ * @return Length of the first chunk (all of data if it is short enough)
+ */
+std::size_t next_chunk_boundary(std::span<const std::byte> data, const chunk_params& params) noexcept;
+
+/**
+ * @brief Thread-safe LRU cache of decompressed chunks, bounded in bytes
+ *
+ * Entries sharing chunks are reassembled without reading or decompressing
+ * the shared chunks again while they stay cached.
+ */
+class chunk_cache {
+public:
+    /** @brief Shared, immutable chunk contents */
+    using chunk_data = std::shared_ptr<const std::vector<std::byte>>;
+
+    /**
+     * @brief Construct an empty cache
+     * @param capacity Maximum total size of cached chunks in bytes (0 disables caching)
+     */
+    explicit chunk_cache(std::size_t capacity) : capacity_(capacity) {}
+
+    /**
+     * @brief Look up a chunk and mark it most recently used
+     * @param index Chunk table index
+     * @return The chunk contents, or nullptr if not cached
+     */
+    chunk_data find(std::uint32_t index);
+
+    /**
+     * @brief Add a chunk, evicting least recently used chunks to stay within capacity
+     * @param index Chunk table index
+     * @param data Chunk contents
+     */
+    void insert(std::uint32_t index, chunk_data data);
+
+    /**
+     * @brief Change the capacity, evicting chunks if needed
+     * @param capacity Maximum total size of cached chunks in bytes
+     */
+    void set_capacity(std::size_t capacity);
+
+    /**
+     * @brief Get the total size of the cached chunks
+     * @return Size in bytes
+     */
+    std::size_t size() const;
+
+private:
+    /**
+     * @brief Drop least recently used chunks until size_ fits capacity_ (mutex_ held)
+     */
+    void evict();
+
+    mutable std::mutex mutex_;  /**< Guards all members below */
+    std::size_t capacity_;      /**< Maximum total size in bytes */
+    std::size_t size_ = 0;      /**< Current total size in bytes */
+    std::list<std::pair<std::uint32_t, chunk_data>> lru_; /**< Chunks, most recently used first */
+    std::unordered_map<std::uint32_t, decltype(lru_)::iterator> index_; /**< Chunk index to lru_ position */
+};
+
+} // namespace dp
@@ -10,8 +10,13 @@
 #include <vector>
 #include <cstddef>
 #include <expected>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <string>
 
+struct z_stream_s;
+
 namespace dp {
 
 /**
@@ -32,14 +37,18 @@ enum class compression_error {
  */
 class compression_engine {
 public:
+    /** @brief Compression level selecting each method's default trade-off */
+    static constexpr int default_level = -1;
+
     /**
      * @brief Compress data using the specified compression method
      * @param data The input data to compress
      * @param method The compression method to use
+     * @param level Method-specific level (0-9 for deflate), or default_level
      * @return Expected containing compressed data on success, or compression_error on failure
      */
     static std::expected<std::vector<std::byte>, compression_error>
-    compress(const std::vector<std::byte>& data, compression_method method);
+    compress(const std::vector<std::byte>& data, compression_method method, int level = default_level);
 
     /**
      * @brief Decompress data using the specified compression method
@@ -53,24 +62,86 @@ public:
               compression_method method,
               std::size_t uncompressed_size);
 
+    /**
+     * @brief Decompress data into a buffer allocated from a memory resource
+     * @param compressed_data The compressed input data
+     * @param method The compression method that was used
+     * @param uncompressed_size The expected size of uncompressed data
+     * @param resource Resource the output buffer is allocated from
+     * @return Expected containing decompressed data on success, or compression_error on failure
+     */
+    static std::expected<std::pmr::vector<std::byte>, compression_error>
+    decompress(std::span<const std::byte> compressed_data,
+               compression_method method,
+               std::size_t uncompressed_size,
+               std::pmr::memory_resource* resource);
+
+    /**
+     * @brief Decompress data straight into caller-owned memory
+     * @param compressed_data The compressed input data
+     * @param method The compression method that was used
+     * @param out Destination; must hold the whole decompressed output
+     * @return Expected containing the number of bytes written, or
+     *         compression_error::buffer_too_small if out cannot hold the output
+     */
+    static std::expected<std::size_t, compression_error>
+    decompress_into(std::span<const std::byte> compressed_data,
+                    compression_method method,
+                    std::span<std::byte> out);
+
 private:
     /**
      * @brief Compress data using DEFLATE algorithm
      * @param data The input data to compress
+     * @param level zlib level (0-9), or default_level
      * @return Expected containing compressed data on success, or compression_error on failure
      */
     static std::expected<std::vector<std::byte>, compression_error>
-    deflate_compress(const std::vector<std::byte>& data);
+    deflate_compress(const std::vector<std::byte>& data, int level);
+};
 
+/**
+ * @brief Incremental DEFLATE decoder for input that arrives in pieces
+ *
+ * Lets a caller inflate an entry window by window while its compressed
+ * bytes are still being read, instead of holding both whole buffers.
+ */
+class inflate_stream {
+public:
     /**
-     * @brief Decompress DEFLATE-compressed data
-     * @param compressed_data The compressed input data
-     * @param uncompressed_size The expected size of uncompressed data
-     * @return Expected containing decompressed data on success, or compression_error on failure
+     * @brief Start decoding a new DEFLATE stream
      */
-    static std::expected<std::vector<std::byte>, compression_error>
-    deflate_decompress(const std::vector<std::byte>& compressed_data,
-                      std::size_t uncompressed_size);
+    inflate_stream();
+
+    /**
+     * @brief Release the decoder state
+     */
+    ~inflate_stream();
+
+    // zlib keeps a pointer back to its stream, so the decoder stays put
+    inflate_stream(const inflate_stream&) = delete;
+    inflate_stream& operator=(const inflate_stream&) = delete;
+
+    /**
+     * @brief Inflate as much input as fits into out
+     * @param input Compressed bytes; advanced past the bytes consumed
+     * @param out Destination for decompressed bytes
+     * @return Expected containing the number of bytes written (0 once finished()),
+     *         or compression_error::decompression_failed on corrupt input
+     */
+    std::expected<std::size_t, compression_error>
+    decompress(std::span<const std::byte>& input, std::span<std::byte> out);
+
+    /**
+     * @brief Check whether the end of the DEFLATE stream was reached
+     * @return True once all output has been produced
+     */
+    bool finished() const noexcept { return finished_; }
+
+private:
+    std::unique_ptr<z_stream_s> stream_;  /**< zlib decoder state */
+    bool initialized_ = false;            /**< inflateInit() succeeded */
+    bool finished_ = false;               /**< End of stream reached */
 };
 
-} // namespace dp
\ No newline at end of file
+} // namespace dp
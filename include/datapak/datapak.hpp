@@ -20,4 +20,15 @@
 #include "datapak/archive_builder.hpp"
 #include "datapak/vfstream.hpp"
 #include "datapak/compression.hpp"
-#include "datapak/format.hpp"
\ No newline at end of file
+#include "datapak/format.hpp"
+#include "datapak/hash.hpp"
+#include "datapak/bloom_filter.hpp"
+#include "datapak/path.hpp"
+#include "datapak/file_handle.hpp"
+#include "datapak/async.hpp"
+#include "datapak/delta.hpp"
+#include "datapak/chunk.hpp"
+#include "datapak/recompress.hpp"
+#include "datapak/merge.hpp"
+#include "datapak/memory_budget.hpp"
+#include "datapak/filter.hpp"
\ No newline at end of file
@@ -0,0 +1,85 @@
+/**
+ * @file delta.hpp
+ * @brief Binary deltas storing an entry relative to a base entry
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "format.hpp"
+#include "compression.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace dp {
+
+/**
+ * @brief Identifies the base entry a delta was computed against
+ */
+struct delta_reference {
+    std::string base_path;        /**< Virtual path of the base entry */
+    std::uint64_t base_size;      /**< Uncompressed size of the base entry */
+    std::uint64_t base_checksum;  /**< content_hash() of the base entry */
+};
+
+/**
+ * @brief Encode target as a delta against base
+ *
+ * The instruction stream alternates literal runs with copies of base ranges
+ * (varint literal length, literal bytes, varint copy length, varint base
+ * offset) and is deflate-compressed. Matches are found through an index of
+ * 16-byte base blocks, so any common run of 31 bytes or more is copied.
+ *
+ * @param base Contents of the base entry
+ * @param target Contents to encode
+ * @param reference Base entry description stored in the blob header
+ * @return Expected containing the delta blob, or compression_error on failure
+ */
+std::expected<std::vector<std::byte>, compression_error>
+make_delta(std::span<const std::byte> base, std::span<const std::byte> target,
+           const delta_reference& reference);
+
+/**
+ * @brief Read the base entry description from a delta blob
+ * @param blob Stored bytes of a compression_method::delta entry
+ * @return Base description, or std::nullopt if the blob is malformed
+ */
+std::optional<delta_reference> read_delta_reference(std::span<const std::byte> blob);
+
+/**
+ * @brief Check that a candidate base entry is the one a delta was made against
+ *
+ * Without metadata only the size can be compared here; callers must then
+ * compare content_hash() of the decoded base with reference.base_checksum
+ * before applying the delta.
+ *
+ * @param reference Base description from read_delta_reference()
+ * @param size Uncompressed size of the candidate
+ * @param metadata Stored metadata of the candidate, if any (checksum compared when present)
+ * @return True if the candidate matches
+ */
+bool delta_base_matches(const delta_reference& reference, std::uint64_t size,
+                        const std::optional<entry_metadata>& metadata) noexcept;
+
+/**
+ * @brief Reconstruct the target contents from a delta blob
+ *
+ * Copy instructions seek within base and read the referenced range, so a
+ * base stream backed by a range_streambuf is read on demand rather than
+ * loaded whole.
+ *
+ * @param blob Stored bytes of a compression_method::delta entry
+ * @param base Stream over the uncompressed base entry
+ * @param target_size Uncompressed size of the target
+ * @return Expected containing the target contents, or compression_error on failure
+ */
+std::expected<std::vector<std::byte>, compression_error>
+apply_delta(std::span<const std::byte> blob, std::istream& base, std::uint64_t target_size);
+
+} // namespace dp
@@ -0,0 +1,140 @@
+/**
+ * @file directory_table.hpp
+ * @brief Compact in-memory directory used by archive readers
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "format.hpp"
+#include "hash.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dp {
+
+/**
+ * @brief Fixed-size directory record of a loaded archive
+ *
+ * The path lives in the owning directory_table's string arena; the record
+ * only stores where. Volume and data offset share one word, which limits
+ * data offsets to 256 TiB per file.
+ */
+struct directory_record {
+    std::uint64_t data_offset : 48;    /**< Byte offset to compressed data */
+    std::uint64_t volume : 16;         /**< Volume file holding the data */
+    std::uint64_t compressed_size;     /**< Size of compressed data in bytes */
+    std::uint64_t uncompressed_size;   /**< Size of uncompressed data in bytes */
+    std::uint32_t name_offset;         /**< Start of the path in the string arena */
+    std::uint16_t name_length;         /**< Length of the path (0 if the stored path was invalid) */
+    compression_method compression;    /**< Compression method used */
+    std::uint8_t reserved;             /**< Padding, always zero */
+};
+
+static_assert(sizeof(directory_record) == 32);
+
+/** @brief Largest data offset a directory_record can hold */
+constexpr std::uint64_t MAX_RECORD_DATA_OFFSET = (std::uint64_t{1} << 48) - 1;
+
+/**
+ * @brief Packed directory: a string arena, 32-byte records and an open-addressing index
+ *
+ * Each path is stored once, in a single arena shared by all entries, and
+ * lookups probe a flat table of 64-bit slots (upper half of the path hash as
+ * a tag, entry index in the lower half) with linear probing. Compared with
+ * an unordered_map keyed by std::string this removes one heap node and one
+ * string allocation per entry; memory_usage() reports the total.
+ */
+class directory_table {
+public:
+    /**
+     * @brief Construct an empty table
+     * @param resource Resource the records, arena and index are allocated from
+     */
+    explicit directory_table(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : records_(resource), names_(resource), slots_(resource) {}
+
+    /**
+     * @brief Remove all entries and release their memory
+     */
+    void clear();
+
+    /**
+     * @brief Reserve space for entries before appending them
+     * @param count Number of entries
+     * @param name_bytes Total length of their paths (an upper bound is fine)
+     */
+    void reserve(std::size_t count, std::size_t name_bytes);
+
+    /**
+     * @brief Append an entry in directory order
+     *
+     * Entries with an empty name are kept (so indices match the archive
+     * directory) but never found by name.
+     *
+     * @param name Virtual path of the entry
+     * @param record Entry fields; name_offset and name_length are filled in
+     * @return False if the path or arena exceeds the record's limits
+     */
+    bool push_back(std::string_view name, directory_record record);
+
+    /**
+     * @brief Build the lookup index over all appended entries
+     *
+     * Must be called after the last push_back() and before find(); also
+     * releases capacity left over from reserve(). When a path occurs more
+     * than once, the later entry is found.
+     */
+    void build_index();
+
+    /**
+     * @brief Look up an entry by exact path
+     * @param key Path and its path_hash()
+     * @return Entry index, or std::nullopt if absent
+     */
+    std::optional<std::uint32_t> find(const path_key& key) const noexcept;
+
+    /**
+     * @brief Get the number of entries
+     * @return Entry count
+     */
+    std::size_t size() const noexcept { return records_.size(); }
+
+    /**
+     * @brief Access an entry's record
+     * @param index Entry index (must be below size())
+     * @return The record
+     */
+    const directory_record& operator[](std::uint32_t index) const noexcept { return records_[index]; }
+
+    /** @copydoc operator[](std::uint32_t) const */
+    directory_record& operator[](std::uint32_t index) noexcept { return records_[index]; }
+
+    /**
+     * @brief Get an entry's path
+     * @param index Entry index (must be below size())
+     * @return View into the string arena, valid until clear()
+     */
+    std::string_view name(std::uint32_t index) const noexcept {
+        const auto& record = records_[index];
+        return std::string_view(names_).substr(record.name_offset, record.name_length);
+    }
+
+    /**
+     * @brief Get the heap memory held by the table
+     * @return Bytes allocated for records, paths and index
+     */
+    std::size_t memory_usage() const noexcept;
+
+private:
+    std::pmr::vector<directory_record> records_;  /**< Entries in directory order */
+    std::pmr::string names_;                      /**< Concatenated paths of all entries */
+    std::pmr::vector<std::uint64_t> slots_;       /**< Hash tag << 32 | (index + 1), 0 when empty */
+};
+
+} // namespace dp
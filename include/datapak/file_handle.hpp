@@ -0,0 +1,165 @@
+/**
+ * @file file_handle.hpp
+ * @brief Read-only file handle with thread-safe positional reads
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace dp {
+
+/**
+ * @brief Read-only file handle supporting concurrent positional reads
+ *
+ * Reads take an explicit offset and never move a shared file position
+ * (pread on POSIX, overlapped ReadFile on Windows), so a single handle can
+ * be shared by any number of threads and streams.
+ */
+class file_handle {
+public:
+    /**
+     * @brief Open a file for reading
+     * @param path Path to the file; check is_open() for success
+     */
+    explicit file_handle(const std::filesystem::path& path);
+
+    /**
+     * @brief Close the file
+     */
+    ~file_handle();
+
+    // Disable copy operations
+    file_handle(const file_handle&) = delete;
+    file_handle& operator=(const file_handle&) = delete;
+
+    // Enable move operations
+    file_handle(file_handle&& other) noexcept;
+    file_handle& operator=(file_handle&& other) noexcept;
+
+    /**
+     * @brief Check whether the file was opened successfully
+     * @return True if the handle refers to an open file
+     */
+    bool is_open() const noexcept;
+
+    /**
+     * @brief Get the size of the file
+     * @return File size in bytes, or 0 if the file is not open
+     */
+    std::uint64_t size() const noexcept { return size_; }
+
+    /**
+     * @brief Read bytes at an absolute offset
+     * @param offset Byte offset to start reading from
+     * @param out Destination buffer; its full size is read
+     * @return True if out was filled completely, false on error or end of file
+     */
+    bool read_at(std::uint64_t offset, std::span<std::byte> out) const noexcept;
+
+    /**
+     * @brief Read bytes at an absolute offset, bypassing the page cache
+     *
+     * Uses O_DIRECT where supported, so streaming a large entry once does not
+     * evict other data from the page cache. Reads go through an aligned
+     * bounce buffer that each thread reuses, sized to the largest request
+     * seen up to 4 MiB. On
+     * platforms or file systems without direct I/O, falls back to a buffered
+     * read followed by a hint to drop the range from the cache.
+     *
+     * @param offset Byte offset to start reading from
+     * @param out Destination buffer; its full size is read
+     * @return True if out was filled completely, false on error or end of file
+     */
+    bool read_at_direct(std::uint64_t offset, std::span<std::byte> out) const noexcept;
+
+    /** @brief Alignment required for direct I/O offsets, sizes and buffers */
+    static constexpr std::size_t direct_io_alignment = 4096;
+
+private:
+    friend class file_writer;
+
+    /**
+     * @brief Close the underlying file if open
+     */
+    void close() noexcept;
+
+#ifdef _WIN32
+    void* handle_ = nullptr;  /**< Win32 file HANDLE */
+#else
+    int fd_ = -1;             /**< POSIX file descriptor */
+    mutable std::atomic<int> direct_fd_{-2}; /**< O_DIRECT descriptor (-2 unopened, -1 unsupported) */
+#endif
+    std::filesystem::path path_; /**< Path used to reopen for direct I/O */
+    std::uint64_t size_ = 0;  /**< File size captured at open */
+};
+
+/**
+ * @brief Write handle for positional writes into an existing file
+ *
+ * Opens the file without truncating it, so it can fill in ranges of a file
+ * that is also being written through a stream. Like file_handle, writes
+ * take an explicit offset and never move a shared file position.
+ */
+class file_writer {
+public:
+    /**
+     * @brief Open an existing file for writing
+     * @param path Path to the file; check is_open() for success
+     */
+    explicit file_writer(const std::filesystem::path& path);
+
+    /**
+     * @brief Close the file
+     */
+    ~file_writer();
+
+    // Disable copy and move operations
+    file_writer(const file_writer&) = delete;
+    file_writer& operator=(const file_writer&) = delete;
+
+    /**
+     * @brief Check whether the file was opened successfully
+     * @return True if the handle refers to an open file
+     */
+    bool is_open() const noexcept;
+
+    /**
+     * @brief Write bytes at an absolute offset
+     * @param offset Byte offset to start writing at
+     * @param data Bytes to write
+     * @return True if all bytes were written
+     */
+    bool write_at(std::uint64_t offset, std::span<const std::byte> data) const noexcept;
+
+    /**
+     * @brief Copy a byte range of another file to an absolute offset
+     *
+     * Uses copy_file_range where supported, so the data moves inside the
+     * kernel (or is shared by reflink on file systems that support it)
+     * instead of passing through user memory. Elsewhere, or when the kernel
+     * refuses (e.g. across file systems), copies through a bounded buffer.
+     *
+     * @param source File to copy from
+     * @param source_offset Byte offset of the range in source
+     * @param length Number of bytes to copy
+     * @param offset Byte offset to write the range at
+     * @return True if the whole range was copied
+     */
+    bool copy_from(const file_handle& source, std::uint64_t source_offset, std::uint64_t length,
+                   std::uint64_t offset) const noexcept;
+
+private:
+#ifdef _WIN32
+    void* handle_ = nullptr;  /**< Win32 file HANDLE */
+#else
+    int fd_ = -1;             /**< POSIX file descriptor */
+#endif
+};
+
+} // namespace dp
@@ -0,0 +1,89 @@
+/**
+ * @file filter.hpp
+ * @brief Reversible filters that make binary data compress better
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "format.hpp"
+#include "compression.hpp"
+#include <cstddef>
+#include <expected>
+#include <span>
+#include <vector>
+
+namespace dp {
+
+/** @brief Largest element size (shuffle) or distance (delta) a filter_header can hold */
+constexpr std::size_t MAX_FILTER_ELEMENT_SIZE = 255;
+
+/**
+ * @brief Check whether a filter configuration can be stored and reversed
+ * @param filter Filter to apply
+ * @param element_size Element size (shuffle) or distance (delta); 1 for the other filters
+ * @return True if element_size is in range for the filter
+ */
+bool valid_filter(filter_type filter, std::size_t element_size) noexcept;
+
+/**
+ * @brief Apply a filter to contents before compression
+ *
+ * - shuffle stores byte 0 of every element, then byte 1, and so on, so the
+ *   slowly changing high bytes of vertex, float and sample arrays form long
+ *   runs; a partial trailing element is kept as is.
+ * - delta replaces every byte with its difference from the byte
+ *   element_size positions earlier, turning smooth signals into small values.
+ * - bcj_x86 rewrites the rel32 operand of E8 (CALL) and E9 (JMP) opcodes
+ *   into an absolute target when it is within 16 MiB, so repeated calls to
+ *   one function become identical byte strings.
+ *
+ * @param data Contents to filter
+ * @param filter Filter to apply
+ * @param element_size Element size (shuffle) or distance (delta); ignored otherwise
+ * @return Filtered contents, the same size as data
+ */
+std::vector<std::byte> apply_filter(std::span<const std::byte> data, filter_type filter, std::size_t element_size);
+
+/**
+ * @brief Undo apply_filter()
+ *
+ * Uses SSE2 where available: shuffle interleaves 2, 4 and 8 byte planes
+ * sixteen elements at a time, delta runs a parallel prefix sum over 16-byte
+ * blocks for distances 1, 2, 4 and 8, and bcj_x86 scans 16 bytes per step
+ * for branch opcodes. Other sizes take the scalar path.
+ *
+ * @param filtered Output of apply_filter()
+ * @param filter Filter that was applied
+ * @param element_size Element size or distance that was used
+ * @param out Destination of filtered.size() bytes, not overlapping filtered
+ * @return False if the configuration is invalid or out has the wrong size
+ */
+bool reverse_filter(std::span<const std::byte> filtered, filter_type filter, std::size_t element_size,
+                    std::span<std::byte> out);
+
+/**
+ * @brief Encode contents as a compression_method::filtered blob
+ * @param data Contents to store
+ * @param filter Filter to apply before compressing
+ * @param element_size Element size (shuffle) or distance (delta)
+ * @param method Inner compression method (none or deflate)
+ * @param level Method-specific level, or compression_engine::default_level
+ * @return Expected containing the blob (filter_header and compressed filtered contents),
+ *         or compression_error on failure
+ */
+std::expected<std::vector<std::byte>, compression_error>
+make_filtered(std::span<const std::byte> data, filter_type filter, std::size_t element_size,
+              compression_method method = compression_method::deflate,
+              int level = compression_engine::default_level);
+
+/**
+ * @brief Decode a compression_method::filtered blob into caller-owned memory
+ * @param blob Stored bytes of the entry
+ * @param out Destination of exactly the entry's uncompressed size
+ * @return Expected void on success, or compression_error::decompression_failed
+ *         if the blob is malformed or does not decode to out.size() bytes
+ */
+std::expected<void, compression_error> decode_filtered(std::span<const std::byte> blob, std::span<std::byte> out);
+
+} // namespace dp
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -18,13 +19,69 @@ constexpr std::uint32_t MAGIC_NUMBER = 0x50414B46; // "PAKF"
 /** @brief Current format version */
 constexpr std::uint32_t FORMAT_VERSION = 1;
 
+/** @brief Maximum length of a virtual path stored in the directory */
+constexpr std::size_t MAX_PATH_LENGTH = 4096;
+
+/**
+ * @brief Header flag: a Bloom filter section follows the directory
+ *
+ * Optional sections are stored after the directory in ascending flag-bit order.
+ */
+constexpr std::uint32_t HEADER_FLAG_BLOOM_FILTER = 1u << 0;
+
+/** @brief Header flag: a normalized, case-folded path hash section follows the directory */
+constexpr std::uint32_t HEADER_FLAG_FOLDED_HASHES = 1u << 1;
+
+/**
+ * @brief Header flag: the archive ends with an archive_trailer
+ *
+ * Set by streaming builds that cannot seek back to patch the header. The
+ * header's directory_offset is then zero and the trailer holds the real
+ * offset and the remaining flags.
+ */
+constexpr std::uint32_t HEADER_FLAG_TRAILER = 1u << 2;
+
+/** @brief Header flag: an entry metadata section (checksums, mtimes) follows the directory */
+constexpr std::uint32_t HEADER_FLAG_ENTRY_METADATA = 1u << 3;
+
+/** @brief Header flag: a tombstone section listing deleted paths follows the directory */
+constexpr std::uint32_t HEADER_FLAG_TOMBSTONES = 1u << 4;
+
+/** @brief Header flag: a chunk table section for compression_method::chunked entries follows the directory */
+constexpr std::uint32_t HEADER_FLAG_CHUNKS = 1u << 5;
+
+/**
+ * @brief Header flag: entry data lives in separate volume files
+ *
+ * A volume section gives the volume of every directory entry, and data
+ * offsets are relative to the start of that volume file. The archive file
+ * itself then holds only the header, directory and sections.
+ */
+constexpr std::uint32_t HEADER_FLAG_VOLUMES = 1u << 6;
+
+/** @brief Magic number identifying an archive trailer ("PAKT") */
+constexpr std::uint32_t TRAILER_MAGIC = 0x50414B54; // "PAKT"
+
 /**
  * @brief Supported compression methods for archive entries
  */
 enum class compression_method : std::uint8_t {
     none = 0,    /**< No compression */
     deflate = 1, /**< DEFLATE compression (zlib) */
-    zstd = 2     /**< Zstandard compression */
+    zstd = 2,    /**< Zstandard compression */
+    delta = 3,   /**< Binary delta against an entry of a base archive (see delta.hpp) */
+    chunked = 4, /**< List of 32-bit chunk table indices whose chunks concatenate to the contents */
+    filtered = 5 /**< filter_header, then the filtered contents compressed with an inner method (see filter.hpp) */
+};
+
+/**
+ * @brief Reversible transforms applied to entry contents before compression
+ */
+enum class filter_type : std::uint8_t {
+    none = 0,    /**< Contents unchanged */
+    shuffle = 1, /**< Byte planes of fixed-size elements stored one after another */
+    delta = 2,   /**< Each byte minus the byte element_size positions earlier */
+    bcj_x86 = 3  /**< x86 CALL/JMP rel32 targets made absolute */
 };
 
 /**
@@ -38,7 +95,19 @@ struct archive_header {
     std::uint32_t version;          /**< Format version (FORMAT_VERSION) */
     std::uint64_t directory_offset; /**< Byte offset to directory table */
     std::uint32_t directory_count;  /**< Number of entries in directory */
-    std::uint32_t reserved;         /**< Reserved for future use */
+    std::uint32_t flags;            /**< Combination of HEADER_FLAG_* values (zero in older archives) */
+};
+
+/**
+ * @brief Trailer locating the directory of a streamed archive
+ *
+ * Occupies the last bytes of the file when HEADER_FLAG_TRAILER is set, after
+ * the directory and all optional sections.
+ */
+struct archive_trailer {
+    std::uint64_t directory_offset; /**< Byte offset to directory table */
+    std::uint32_t flags;            /**< HEADER_FLAG_* values describing the optional sections */
+    std::uint32_t magic;            /**< Magic number (TRAILER_MAGIC) */
 };
 
 /**
@@ -53,6 +122,156 @@ struct directory_entry {
     std::uint64_t compressed_size;       /**< Size of compressed data in bytes */
     std::uint64_t uncompressed_size;     /**< Size of uncompressed data in bytes */
     compression_method compression;      /**< Compression method used */
+    std::uint32_t volume = 0;            /**< Volume file holding the data (stored in the volume section) */
+};
+
+/**
+ * @brief Header of the optional Bloom filter section
+ *
+ * Present after the directory when HEADER_FLAG_BLOOM_FILTER is set, followed by
+ * block_count * 8 64-bit words of filter bits. Keys are the
+ * path_hash() of every archive path.
+ */
+struct bloom_section_header {
+    std::uint32_t hash_id;      /**< Path hash function the filter was built with (PATH_HASH_ID) */
+    std::uint32_t block_count;  /**< Number of 512-bit filter blocks */
+    std::uint32_t probe_count;  /**< Number of bits probed per key */
+    std::uint32_t reserved;     /**< Reserved for future use */
+};
+
+/**
+ * @brief Header of the optional folded path hash section
+ *
+ * Present when HEADER_FLAG_FOLDED_HASHES is set, followed by count 64-bit
+ * hashes in directory order. Each hash is the path_hash() of the entry's path
+ * after normalize_path() with case folding, which lets readers serve
+ * normalized and case-insensitive lookups without rehashing every entry.
+ */
+struct folded_hash_section_header {
+    std::uint32_t hash_id;  /**< Path hash function the hashes were computed with (PATH_HASH_ID) */
+    std::uint32_t count;    /**< Number of hashes, equal to the directory count */
+};
+
+/** @brief Magic number identifying a delta blob ("PAKD") */
+constexpr std::uint32_t DELTA_MAGIC = 0x50414B44; // "PAKD"
+
+/**
+ * @brief Header at the start of every compression_method::delta blob
+ *
+ * Followed by base_path_length bytes naming the base entry and then the
+ * deflate-compressed instruction stream described in delta.hpp.
+ */
+struct delta_header {
+    std::uint32_t magic;              /**< Magic number (DELTA_MAGIC) */
+    std::uint32_t base_path_length;   /**< Length of the base entry path */
+    std::uint64_t base_size;          /**< Uncompressed size of the base entry */
+    std::uint64_t base_checksum;      /**< content_hash() of the base entry */
+    std::uint64_t instructions_size;  /**< Size of the instruction stream before deflate */
+};
+
+/**
+ * @brief Header at the start of every compression_method::filtered blob
+ *
+ * Followed by the filtered contents, compressed with the inner method. The
+ * entry's uncompressed size is also the size of the filtered contents.
+ */
+struct filter_header {
+    filter_type filter;              /**< Transform applied before compression */
+    std::uint8_t element_size;       /**< Element size (shuffle) or distance (delta) in bytes, 1 otherwise */
+    compression_method compression;  /**< Method the filtered contents are compressed with (none or deflate) */
+    std::uint8_t reserved;           /**< Reserved for future use */
+};
+
+static_assert(sizeof(filter_header) == 4);
+
+/**
+ * @brief Header of the optional entry metadata section
+ *
+ * Present when HEADER_FLAG_ENTRY_METADATA is set, followed by count
+ * entry_metadata records in directory order. Builders use it to detect
+ * unchanged sources when rebuilding against a previous archive.
+ */
+struct entry_metadata_section_header {
+    std::uint32_t checksum_id;  /**< Content hash function of the checksums (CONTENT_HASH_ID) */
+    std::uint32_t count;        /**< Number of records, equal to the directory count */
+};
+
+/**
+ * @brief Header of the optional tombstone section
+ *
+ * Present when HEADER_FLAG_TOMBSTONES is set, followed by count paths, each
+ * stored as a 32-bit length and the path bytes. A tombstone marks a path as
+ * deleted, hiding it in archives of lower precedence when mounted in a vfs.
+ */
+struct tombstone_section_header {
+    std::uint32_t count;    /**< Number of deleted paths */
+    std::uint32_t reserved; /**< Reserved for future use */
+};
+
+/**
+ * @brief Header of the optional chunk table section
+ *
+ * Present when HEADER_FLAG_CHUNKS is set, followed by count chunk_record
+ * values. Chunks are stored in the data area like entry blobs, and each
+ * unique chunk is stored once no matter how many entries reference it.
+ */
+struct chunk_section_header {
+    std::uint32_t count;    /**< Number of chunk records */
+    std::uint32_t reserved; /**< Reserved for future use */
+};
+
+/**
+ * @brief Location and encoding of one stored chunk
+ */
+struct chunk_record {
+    std::uint64_t data_offset;       /**< Byte offset to the stored chunk */
+    std::uint32_t compressed_size;   /**< Stored size in bytes */
+    std::uint32_t size;              /**< Uncompressed size in bytes */
+    compression_method compression;  /**< Compression method of the stored chunk */
+    std::uint8_t reserved[3];        /**< Reserved for future use (zero) */
+    std::uint32_t volume;            /**< Volume file holding the chunk (0 without HEADER_FLAG_VOLUMES) */
+};
+
+/** @brief Magic number identifying a volume file ("PAKV") */
+constexpr std::uint32_t VOLUME_MAGIC = 0x50414B56; // "PAKV"
+
+/** @brief Maximum number of volumes of a multi-volume archive */
+constexpr std::uint32_t MAX_VOLUME_COUNT = 1000;
+
+/**
+ * @brief Header at the start of every volume file
+ *
+ * Volume files are named after the archive with a three-digit suffix
+ * (assets.pak.000, assets.pak.001, ...) and contain only blob data.
+ */
+struct volume_header {
+    std::uint32_t magic;    /**< Magic number (VOLUME_MAGIC) */
+    std::uint32_t version;  /**< Format version (FORMAT_VERSION) */
+    std::uint32_t index;    /**< Index of this volume */
+    std::uint32_t count;    /**< Total number of volumes */
+    std::uint64_t build_id; /**< Random identifier shared with the archive's volume section */
+};
+
+/**
+ * @brief Header of the volume section
+ *
+ * Present when HEADER_FLAG_VOLUMES is set, followed by one 32-bit volume
+ * index per directory entry, in directory order. The build identifier is
+ * drawn anew for every build, so volume files left over from another build
+ * with the same volume count are rejected instead of serving wrong bytes.
+ */
+struct volume_section_header {
+    std::uint32_t volume_count; /**< Number of volume files */
+    std::uint32_t reserved;     /**< Reserved for future use */
+    std::uint64_t build_id;     /**< Must match volume_header::build_id of every volume */
+};
+
+/**
+ * @brief Per-entry metadata stored in the entry metadata section
+ */
+struct entry_metadata {
+    std::uint64_t checksum; /**< content_hash() of the uncompressed contents */
+    std::int64_t mtime;     /**< Source modification time in file_clock nanoseconds (0 if unknown) */
 };
 
 } // namespace dp
\ No newline at end of file
@@ -0,0 +1,210 @@
+/**
+ * @file hash.hpp
+ * @brief Stable hash functions used by the DataPak archive format
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <span>
+#include <string_view>
+
+namespace dp {
+
+/**
+ * @brief Identifier of the path hash function used for persisted hashes
+ *
+ * Archives record this value next to every structure that stores path hashes,
+ * so readers can detect archives written with a different hash function.
+ * Version 1 was FNV-1a; such archives still open and rebuild their hashes.
+ */
+constexpr std::uint32_t PATH_HASH_ID = 2; // wyhash-style multiply-mix, 64-bit
+
+namespace detail {
+
+/** @brief Multiplier constants of the path hash */
+constexpr std::uint64_t path_hash_secret[4] = {
+    0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL};
+
+/**
+ * @brief Full 64x64 -> 128-bit multiply, folded to 64 bits by xor of the halves
+ */
+constexpr std::uint64_t path_hash_mix(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __extension__ using uint128 = unsigned __int128;
+    const uint128 product = static_cast<uint128>(a) * b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+#else
+    const std::uint64_t ha = a >> 32, hb = b >> 32;
+    const std::uint64_t la = static_cast<std::uint32_t>(a), lb = static_cast<std::uint32_t>(b);
+    const std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const std::uint64_t t = rl + (rm0 << 32);
+    std::uint64_t carry = t < rl;
+    const std::uint64_t lo = t + (rm1 << 32);
+    carry += lo < t;
+    const std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    return lo ^ hi;
+#endif
+}
+
+/**
+ * @brief Load bytes as a little-endian integer, usable in constant expressions
+ * @tparam N Number of bytes to load (4 or 8)
+ */
+template <std::size_t N>
+constexpr std::uint64_t path_hash_load(const char* p) noexcept {
+    if !consteval {
+        if constexpr (std::endian::native == std::endian::little) {
+            std::conditional_t<N == 8, std::uint64_t, std::uint32_t> value;
+            std::memcpy(&value, p, N);
+            return value;
+        }
+    }
+
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+        value |= std::uint64_t{static_cast<std::uint8_t>(p[i])} << (8 * i);
+    }
+    return value;
+}
+
+} // namespace detail
+
+/**
+ * @brief Compute the stable 64-bit hash of an archive path
+ *
+ * A wyhash-style hash: input is consumed 16 bytes per step, each step a
+ * single 64x64-bit multiply, so typical 20-80 byte asset paths hash in a
+ * handful of multiplies instead of one multiply per byte. Unlike
+ * std::hash, the result is identical across platforms and standard library
+ * implementations, so it can be persisted in archive files. Usable in
+ * constant expressions for the _dp literal.
+ *
+ * @param path The virtual path to hash
+ * @return 64-bit hash of the path bytes
+ */
+constexpr std::uint64_t path_hash(std::string_view path) noexcept {
+    using detail::path_hash_load;
+    using detail::path_hash_mix;
+    constexpr auto& secret = detail::path_hash_secret;
+
+    const char* p = path.data();
+    const std::size_t length = path.size();
+    std::uint64_t seed = path_hash_mix(secret[0], secret[1]);
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+
+    if (length <= 16) {
+        if (length >= 4) {
+            // Two overlapping loads from each end cover every byte
+            const std::size_t middle = (length >> 3) << 2;
+            a = (path_hash_load<4>(p) << 32) | path_hash_load<4>(p + middle);
+            b = (path_hash_load<4>(p + length - 4) << 32) | path_hash_load<4>(p + length - 4 - middle);
+        } else if (length > 0) {
+            a = (std::uint64_t{static_cast<std::uint8_t>(p[0])} << 16) |
+                (std::uint64_t{static_cast<std::uint8_t>(p[length >> 1])} << 8) |
+                static_cast<std::uint8_t>(p[length - 1]);
+        }
+    } else {
+        std::size_t remaining = length;
+        if (remaining > 48) {
+            // Three independent lanes keep the multiplier busy on long paths
+            std::uint64_t lane1 = seed;
+            std::uint64_t lane2 = seed;
+            do {
+                seed = path_hash_mix(path_hash_load<8>(p) ^ secret[1], path_hash_load<8>(p + 8) ^ seed);
+                lane1 = path_hash_mix(path_hash_load<8>(p + 16) ^ secret[2], path_hash_load<8>(p + 24) ^ lane1);
+                lane2 = path_hash_mix(path_hash_load<8>(p + 32) ^ secret[3], path_hash_load<8>(p + 40) ^ lane2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= lane1 ^ lane2;
+        }
+        while (remaining > 16) {
+            seed = path_hash_mix(path_hash_load<8>(p) ^ secret[1], path_hash_load<8>(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        a = path_hash_load<8>(p + remaining - 16);
+        b = path_hash_load<8>(p + remaining - 8);
+    }
+
+    return path_hash_mix(secret[1] ^ length, path_hash_mix(a ^ secret[1], b ^ seed));
+}
+
+/**
+ * @brief Compute a path hash at compile time
+ * @param path The virtual path to hash
+ * @return The same value path_hash() returns at runtime
+ */
+consteval std::uint64_t static_path_hash(std::string_view path) {
+    return path_hash(path);
+}
+
+/**
+ * @brief A virtual path paired with its precomputed path_hash()
+ *
+ * Lookups taking a path_key skip hashing entirely. Keys built from the
+ * _dp literal are hashed at compile time; keys built at runtime hash once
+ * on construction and can be reused across many lookups.
+ */
+struct path_key {
+    std::string_view path; /**< The virtual path */
+    std::uint64_t hash;    /**< path_hash() of path */
+
+    /**
+     * @brief Construct a key, hashing the path
+     * @param p The virtual path; must outlive the key
+     */
+    constexpr explicit path_key(std::string_view p) noexcept
+        : path(p), hash(path_hash(p)) {}
+};
+
+/**
+ * @brief Identifier of the content hash function used for entry checksums
+ */
+constexpr std::uint32_t CONTENT_HASH_ID = 1; // XXH64, seed 0
+
+/**
+ * @brief Compute the stable 64-bit hash of file contents
+ *
+ * Processes 32 bytes per step, so hashing runs far faster than reading or
+ * compressing the same data. Results are persisted as entry checksums.
+ *
+ * @param data The bytes to hash
+ * @return 64-bit hash of the data
+ */
+std::uint64_t content_hash(std::span<const std::byte> data) noexcept;
+
+/**
+ * @brief Compute XXH64 of data with an explicit seed
+ *
+ * Different seeds give practically independent hashes, so two of them
+ * together serve as a 128-bit digest. content_hash(data) uses seed 0.
+ *
+ * @param data The bytes to hash
+ * @param seed XXH64 seed
+ * @return 64-bit hash of the data
+ */
+std::uint64_t content_hash(std::span<const std::byte> data, std::uint64_t seed) noexcept;
+
+namespace literals {
+
+/**
+ * @brief Create a compile-time hashed path key, e.g. "config/app.json"_dp
+ * @param str Literal characters
+ * @param length Literal length
+ * @return Key whose hash is computed during compilation
+ */
+consteval path_key operator""_dp(const char* str, std::size_t length) {
+    return path_key{std::string_view(str, length)};
+}
+
+} // namespace literals
+
+} // namespace dp
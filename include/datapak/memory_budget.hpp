@@ -0,0 +1,124 @@
+/**
+ * @file memory_budget.hpp
+ * @brief Byte budget limiting memory held by in-flight operations
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace dp {
+
+/**
+ * @brief Counting semaphore over bytes with FIFO admission
+ *
+ * Callers reserve the bytes an operation will allocate before starting it
+ * and release them when it is done; reservations that do not fit wait.
+ * Waiters are admitted in arrival order, so a large request is not starved
+ * by a stream of small ones. A request larger than the whole budget is
+ * admitted once it is alone.
+ */
+class memory_budget {
+public:
+    /**
+     * @brief Bytes held from a memory_budget, returned on destruction
+     */
+    class reservation {
+    public:
+        reservation(reservation&& other) noexcept
+            : budget_(std::exchange(other.budget_, nullptr)), bytes_(other.bytes_) {}
+
+        reservation& operator=(reservation&& other) noexcept {
+            if (this != &other) {
+                reset();
+                budget_ = std::exchange(other.budget_, nullptr);
+                bytes_ = other.bytes_;
+            }
+            return *this;
+        }
+
+        reservation(const reservation&) = delete;
+        reservation& operator=(const reservation&) = delete;
+
+        ~reservation() { reset(); }
+
+        /**
+         * @brief Return the bytes to the budget early
+         */
+        void reset() noexcept;
+
+        /**
+         * @brief Return part of the bytes, keeping the rest reserved
+         * @param bytes Bytes to keep (no effect if not below bytes())
+         */
+        void shrink_to(std::uint64_t bytes) noexcept;
+
+        /**
+         * @brief Get the number of bytes held
+         * @return Reserved bytes (clamped to the budget's capacity)
+         */
+        std::uint64_t bytes() const noexcept { return bytes_; }
+
+    private:
+        friend class memory_budget;
+
+        reservation(memory_budget* budget, std::uint64_t bytes) noexcept : budget_(budget), bytes_(bytes) {}
+
+        memory_budget* budget_;  /**< Budget to return the bytes to (nullptr once released) */
+        std::uint64_t bytes_;    /**< Bytes held */
+    };
+
+    /**
+     * @brief Construct a budget
+     * @param capacity Total bytes that may be reserved at once
+     */
+    explicit memory_budget(std::uint64_t capacity) : capacity_(capacity) {}
+
+    // Reservations point at the budget
+    memory_budget(const memory_budget&) = delete;
+    memory_budget& operator=(const memory_budget&) = delete;
+
+    /**
+     * @brief Reserve bytes, waiting for them to become available
+     * @param bytes Bytes the caller is about to allocate
+     * @param deadline Give up at this time (std::nullopt waits indefinitely)
+     * @return The reservation, or std::nullopt if the deadline passed first
+     */
+    std::optional<reservation>
+    acquire(std::uint64_t bytes, std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+
+    /**
+     * @brief Get the total capacity
+     * @return Capacity in bytes
+     */
+    std::uint64_t capacity() const noexcept { return capacity_; }
+
+    /**
+     * @brief Get the bytes currently reserved
+     * @return Reserved bytes
+     */
+    std::uint64_t in_use() const;
+
+private:
+    /**
+     * @brief Return bytes and wake waiters
+     * @param bytes Bytes to return
+     */
+    void release(std::uint64_t bytes) noexcept;
+
+    const std::uint64_t capacity_;      /**< Total bytes that may be reserved at once */
+    mutable std::mutex mutex_;          /**< Guards the members below */
+    std::condition_variable changed_;   /**< Signals releases and queue changes */
+    std::uint64_t in_use_ = 0;          /**< Bytes currently reserved */
+    std::uint64_t next_ticket_ = 0;     /**< Ticket handed to the next waiter */
+    std::deque<std::uint64_t> queue_;   /**< Tickets of waiting callers, in arrival order */
+};
+
+} // namespace dp
@@ -0,0 +1,52 @@
+/**
+ * @file merge.hpp
+ * @brief Combining several archives into one
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "archive.hpp"
+#include "archive_builder.hpp"
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace dp {
+
+/**
+ * @brief Counts reported by merge()
+ */
+struct merge_stats {
+    std::size_t copied = 0;       /**< Entries whose stored bytes were copied verbatim */
+    std::size_t materialized = 0; /**< Delta and chunked entries decoded and stored whole */
+    std::size_t shadowed = 0;     /**< Entries dropped because a later input replaced or deleted them */
+};
+
+/**
+ * @brief Combine archives into one with a single directory
+ *
+ * Later inputs take precedence, as when the inputs are mounted in order in
+ * a vfs with search_order::reverse_mount_order: a path present in several
+ * inputs is taken from the last one, and a tombstone drops the path from
+ * all earlier inputs. Entries keep the position where their path first
+ * appeared, so merging a base with its patches keeps the base layout.
+ *
+ * Stored bytes are copied without decoding, file to file with
+ * copy_file_range where supported (see archive_builder::add_copy()). Delta
+ * entries whose base is in an earlier input are decoded and stored
+ * deflate-compressed, since their base may be replaced in the result; the
+ * rest are only read as far as their base path. Chunked entries are
+ * decoded as well, since their chunks are not copied. Tombstones for paths the result does
+ * not contain are kept, so they still apply to archives mounted below it.
+ *
+ * @param inputs Archives in ascending precedence
+ * @param output_path Path of the merged archive (must differ from every input)
+ * @return Expected containing the entry counts, or builder_error on failure
+ */
+std::expected<merge_stats, builder_error>
+merge(std::span<const std::shared_ptr<const archive>> inputs, const std::filesystem::path& output_path);
+
+} // namespace dp
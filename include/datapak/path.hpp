@@ -0,0 +1,50 @@
+/**
+ * @file path.hpp
+ * @brief Virtual path normalization for archive lookups
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "format.hpp"
+#include <array>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace dp {
+
+/** @brief Stack buffer large enough to hold any normalized archive path */
+using path_buffer = std::array<char, MAX_PATH_LENGTH>;
+
+/**
+ * @brief Normalize a virtual path into a caller-provided buffer
+ *
+ * Both '/' and '\\' are treated as separators. Empty and "." segments are
+ * dropped, ".." removes the preceding segment, and the result is joined with
+ * single '/' characters without leading or trailing separators. When
+ * fold_case is set, ASCII letters are lowercased. No memory is allocated.
+ *
+ * @param path The path to normalize
+ * @param buffer Output storage for the normalized path
+ * @param fold_case True to lowercase ASCII letters
+ * @return View into buffer on success, or std::nullopt if the path escapes
+ *         the archive root or does not fit in the buffer
+ */
+std::optional<std::string_view>
+normalize_path(std::string_view path, std::span<char> buffer, bool fold_case = false) noexcept;
+
+/**
+ * @brief Match a virtual path against a wildcard pattern
+ *
+ * '*' matches any run of characters, including '/', and '?' matches any
+ * single character; everything else matches itself. So "*.json" selects
+ * JSON files in every directory and "textures/?*" everything below textures.
+ *
+ * @param pattern The wildcard pattern
+ * @param path The path to test
+ * @return True if the whole path matches the pattern
+ */
+bool match_glob(std::string_view pattern, std::string_view path) noexcept;
+
+} // namespace dp
@@ -0,0 +1,55 @@
+/**
+ * @file recompress.hpp
+ * @brief Re-encoding the entries of an existing archive
+ * @author DataPak Team
+ */
+
+#pragma once
+
+#include "archive.hpp"
+#include "archive_builder.hpp"
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace dp {
+
+/**
+ * @brief Settings for recompress()
+ */
+struct recompress_options {
+    compression_method compression = compression_method::deflate; /**< Method for selected entries */
+    int level = compression_engine::default_level;                 /**< Method-specific level */
+    std::vector<std::string> filters;  /**< match_glob() patterns selecting entries (empty selects all) */
+    unsigned threads = 0;              /**< Worker threads (0 uses all hardware threads) */
+};
+
+/**
+ * @brief Counts reported by recompress()
+ */
+struct recompress_stats {
+    std::size_t recompressed = 0; /**< Entries decoded and encoded again */
+    std::size_t copied = 0;       /**< Entries copied verbatim */
+};
+
+/**
+ * @brief Write a copy of an archive with selected entries re-encoded
+ *
+ * Selected entries are decoded and encoded with the new method on a pool
+ * of worker threads, while the rest are copied byte for byte. Chunked
+ * entries are always re-encoded, since their chunks are not copied; delta
+ * entries are always copied, since decoding them needs their base. Entries
+ * and tombstones keep their directory order. The output is a single file.
+ *
+ * @param input Archive to read
+ * @param output_path Path of the new archive (must differ from the input)
+ * @param options Method, level, filters and thread count
+ * @return Expected containing the entry counts, or builder_error on failure
+ */
+std::expected<recompress_stats, builder_error>
+recompress(const archive& input, const std::filesystem::path& output_path,
+           const recompress_options& options = {});
+
+} // namespace dp
@@ -7,9 +7,13 @@
 #pragma once
 
 #include "archive.hpp"
+#include "memory_budget.hpp"
 #include "vfstream.hpp"
+#include <chrono>
+#include <optional>
 #include <vector>
 #include <memory>
+#include <memory_resource>
 #include <unordered_map>
 #include <string_view>
 #include <filesystem>
@@ -22,7 +26,10 @@ namespace dp {
 enum class vfs_error {
     archive_error,   /**< Error occurred with underlying archive */
     file_not_found,  /**< Requested file not found in any mounted archive */
-    cache_error      /**< Error occurred with cache operations */
+    cache_error,     /**< Error occurred with cache operations */
+    invalid_handle,  /**< File handle refers to an archive that is no longer mounted */
+    buffer_too_small,/**< Destination buffer cannot hold the file */
+    budget_exhausted /**< Decompression budget did not free up before the timeout */
 };
 
 /**
@@ -33,6 +40,21 @@ enum class search_order {
     reverse_mount_order /**< Search in reverse order (most recently mounted has priority) */
 };
 
+/**
+ * @brief Resolved handle naming a file within a specific mounted archive
+ *
+ * Obtained from vfs::resolve(). Opening a handle skips path hashing and the
+ * search across archives. Mount identifiers are never reused, so a handle to
+ * an unmounted archive is reported as vfs_error::invalid_handle rather than
+ * silently naming a different file.
+ */
+struct file_id {
+    std::uint32_t mount = 0; /**< Identifier of the mounted archive (0 is never assigned) */
+    std::uint32_t entry = 0; /**< Directory entry index within the archive */
+
+    friend bool operator==(const file_id&, const file_id&) = default;
+};
+
 /**
  * @brief Virtual File System for DataPak archives
  *
@@ -47,6 +69,21 @@ public:
      */
     vfs() = default;
 
+    /**
+     * @brief Construct a vfs allocating from a memory resource
+     *
+     * Mounted archives, the file cache and the buffers behind returned
+     * streams allocate from resource, so a request-scoped vfs over a
+     * monotonic or arena resource releases all file data at once. The
+     * resource must outlive the vfs and every stream it returned. It is
+     * not locked: if streams are opened from, or destroyed on, several
+     * threads, the resource must be thread-safe (for example a
+     * std::pmr::synchronized_pool_resource, possibly on top of an arena).
+     *
+     * @param resource Memory resource for directories, cache entries and file buffers
+     */
+    explicit vfs(std::pmr::memory_resource* resource) : resource_(resource), cache_(resource) {}
+
     /**
      * @brief Default destructor
      */
@@ -69,14 +106,158 @@ public:
     std::expected<void, vfs_error>
     mount(const std::filesystem::path& archive_path, access_mode mode = access_mode::disk);
 
+    /**
+     * @brief Unmount a previously mounted archive
+     *
+     * Handles resolved against the archive become invalid and the file cache
+     * is cleared.
+     *
+     * @param archive_path Path the archive was mounted from
+     * @return True if an archive was unmounted, false if none matched
+     */
+    bool unmount(const std::filesystem::path& archive_path);
+
+    /**
+     * @brief Resolve a virtual path to a handle for repeated access
+     *
+     * The handle names the archive that currently provides the file under the
+     * active search order. Mounting more archives later does not re-resolve it.
+     *
+     * @param filename The virtual path of the file
+     * @return Expected containing file_id on success, or vfs_error on failure
+     */
+    std::expected<file_id, vfs_error> resolve(std::string_view filename) const;
+
+    /**
+     * @brief Resolve a pre-hashed path key to a handle
+     * @param key Path and its precomputed hash, e.g. "config/app.json"_dp
+     * @return Expected containing file_id on success, or vfs_error on failure
+     */
+    std::expected<file_id, vfs_error> resolve(const path_key& key) const;
+
     /**
      * @brief Open a file from any mounted archive as a virtual stream
+     *
+     * With the cache enabled, the contents are also copied into the file
+     * cache, unless a decompression budget is set (see
+     * set_decompression_budget()); cached files are served from the cache.
+     *
      * @param filename The virtual path of the file to open
      * @return Expected containing vfstream on success, or vfs_error on failure
      */
     std::expected<std::unique_ptr<vfstream>, vfs_error>
     open(std::string_view filename);
 
+    /**
+     * @brief Open a file by resolved handle
+     *
+     * Reads directly from the archive named by the handle, bypassing path
+     * lookup and the path-keyed file cache.
+     *
+     * @param id Handle previously returned by resolve()
+     * @return Expected containing vfstream on success, or vfs_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, vfs_error>
+    open(file_id id) const;
+
+    /**
+     * @brief Open a file for sequential reading with background readahead
+     *
+     * Large stored and deflate entries are read and inflated a window ahead
+     * of the consumer on a background thread (see archive::open_sequential()).
+     * The stream is forward-only, bypasses the file cache and holds two
+     * windows of memory; other entries are opened as by open(file_id).
+     *
+     * @param filename The virtual path of the file to open
+     * @param window_size Size of each of the two readahead windows in bytes
+     * @return Expected containing vfstream on success, or vfs_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, vfs_error>
+    open_sequential(std::string_view filename,
+                    std::size_t window_size = readahead_streambuf::default_window_size) const;
+
+    /**
+     * @brief Open a file for sequential reading by resolved handle
+     * @param id Handle previously returned by resolve()
+     * @param window_size Size of each of the two readahead windows in bytes
+     * @return Expected containing vfstream on success, or vfs_error on failure
+     */
+    std::expected<std::unique_ptr<vfstream>, vfs_error>
+    open_sequential(file_id id, std::size_t window_size = readahead_streambuf::default_window_size) const;
+
+    /**
+     * @brief Read the full contents of a file by resolved handle
+     *
+     * Delta entries are reconstructed against the entry they name, resolved
+     * in the archives of lower precedence than the handle's archive.
+     *
+     * @param id Handle previously returned by resolve()
+     * @return Expected containing the file contents on success, or vfs_error on failure
+     */
+    std::expected<std::vector<std::byte>, vfs_error> read(file_id id) const;
+
+    /**
+     * @brief Read the full contents of several files by resolved handle
+     *
+     * The stored bytes of the files in each archive are fetched together
+     * with archive::read_raw_entries(), so the volumes of a multi-volume
+     * archive are read in parallel, one thread per volume, before the
+     * entries are decoded on the calling thread. Delta entries, and every
+     * entry while a decompression budget is set, are read one at a time as
+     * by read(file_id).
+     *
+     * @param ids Handles previously returned by resolve()
+     * @return One result per handle, in the order of ids
+     */
+    std::vector<std::expected<std::vector<std::byte>, vfs_error>> read(std::span<const file_id> ids) const;
+
+    /**
+     * @brief Read a file's contents into caller-owned memory
+     *
+     * Decompresses or copies straight into out (a GPU staging buffer, a
+     * pooled allocation, ...) instead of going through a vfstream. Cached
+     * files are copied from the cache; files read here are not added to it.
+     *
+     * @param filename Virtual path of the file
+     * @param out Destination of at least the file's size (see stat())
+     * @return Expected containing the number of bytes written, or vfs_error
+     *         (buffer_too_small if out is shorter than the file)
+     */
+    std::expected<std::size_t, vfs_error> read(std::string_view filename, std::span<std::byte> out) const;
+
+    /**
+     * @brief Read a file's contents into caller-owned memory by resolved handle
+     * @param id Handle previously returned by resolve()
+     * @param out Destination of at least the file's size
+     * @return Expected containing the number of bytes written, or vfs_error on failure
+     */
+    std::expected<std::size_t, vfs_error> read(file_id id, std::span<std::byte> out) const;
+
+    /**
+     * @brief Get metadata for a file in any mounted archive
+     * @param filename The virtual path of the file
+     * @return Expected containing file_stat on success, or vfs_error on failure
+     */
+    std::expected<file_stat, vfs_error> stat(std::string_view filename) const;
+
+    /**
+     * @brief Get metadata for a file by resolved handle
+     * @param id Handle previously returned by resolve()
+     * @return Expected containing file_stat on success, or vfs_error on failure
+     */
+    std::expected<file_stat, vfs_error> stat(file_id id) const;
+
+    /**
+     * @brief Get the mounted archive a handle refers to
+     *
+     * The returned pointer keeps the archive alive even if it is unmounted
+     * while the caller is still reading from it.
+     *
+     * @param id Handle previously returned by resolve()
+     * @return The archive, or nullptr if it is no longer mounted
+     */
+    std::shared_ptr<const archive> get_archive(file_id id) const;
+
     /**
      * @brief Check if any mounted archive contains the specified file
      * @param filename The virtual path to check
@@ -119,11 +300,132 @@ public:
      */
     search_order get_search_order() const { return search_order_; }
 
+    /**
+     * @brief Set how lookup paths are matched in all mounted archives
+     *
+     * The mode also applies to archives mounted afterwards. The file cache
+     * is cleared, since it is keyed by the requested path.
+     *
+     * @param mode The lookup mode to use
+     */
+    void set_lookup_mode(lookup_mode mode);
+
+    /**
+     * @brief Get the current lookup mode
+     * @return The current lookup mode setting
+     */
+    lookup_mode get_lookup_mode() const { return lookup_mode_; }
+
+    /**
+     * @brief Set the direct I/O threshold for all mounted archives
+     *
+     * The threshold also applies to archives mounted afterwards; see
+     * archive::set_direct_io_threshold().
+     *
+     * @param bytes Minimum stored size for direct I/O (0 disables it)
+     */
+    void set_direct_io_threshold(std::uint64_t bytes);
+
+    /**
+     * @brief Limit the memory held by decompressions in progress
+     *
+     * open() and read() of compressed entries reserve the entry's stored and
+     * uncompressed size while reading and decoding it, and wait in arrival
+     * order while concurrent calls hold the rest. Streams returned by open()
+     * keep the uncompressed size reserved until they are destroyed, so
+     * threads holding many large streams cannot allocate more than the
+     * budget between them. read(file_id) hands its vector to the caller and
+     * stops counting on return; use read() into caller memory or open() to
+     * keep the contents accounted for. While a budget is set, open() does
+     * not fill the file cache. Must not be called while reads are in progress.
+     *
+     * @param bytes Budget in bytes (0 removes the limit)
+     */
+    void set_decompression_budget(std::uint64_t bytes);
+
+    /**
+     * @brief Get the decompression budget
+     * @return Budget in bytes (0 if unlimited)
+     */
+    std::uint64_t get_decompression_budget() const {
+        return decompression_budget_ ? decompression_budget_->capacity() : 0;
+    }
+
+    /**
+     * @brief Bound how long open() and read() wait for decompression budget
+     * @param timeout Maximum wait before failing with vfs_error::budget_exhausted
+     *                (std::nullopt waits indefinitely, zero fails fast)
+     */
+    void set_decompression_timeout(std::optional<std::chrono::milliseconds> timeout) {
+        decompression_timeout_ = timeout;
+    }
+
 private:
-    std::vector<std::unique_ptr<archive>> archives_;                        /**< Mounted archives */
+    /**
+     * @brief A mounted archive and its never-reused mount identifier
+     */
+    struct mounted_archive {
+        std::uint32_t id;                 /**< Mount identifier */
+        std::shared_ptr<archive> arch;    /**< The archive (shared with in-flight async operations) */
+    };
+
+    /**
+     * @brief Find the mount a handle refers to
+     * @param id Handle to look up
+     * @return Pointer to the mount, or nullptr if it is no longer mounted
+     */
+    const mounted_archive* find_mount(file_id id) const;
+
+    /**
+     * @brief Resolve a path in the archives ranked below a given mount
+     * @param key Path and its precomputed hash
+     * @param above Mount whose lower-precedence archives are searched (nullptr searches all)
+     * @return Expected containing file_id on success, or vfs_error on failure
+     */
+    std::expected<file_id, vfs_error> resolve_below(const path_key& key, const mounted_archive* above) const;
+
+    /**
+     * @brief Reserve decompression budget for reading an entry
+     * @param info The entry being read
+     * @param into_caller_buffer True if the output goes to caller memory (only the stored bytes are allocated)
+     * @return Reservation (std::nullopt if no budget applies), or vfs_error::budget_exhausted
+     */
+    std::expected<std::optional<memory_budget::reservation>, vfs_error>
+    reserve_decompression(const file_stat& info, bool into_caller_buffer) const;
+
+    /**
+     * @brief Reserve bytes from the decompression budget, honouring the timeout
+     * @param bytes Bytes to reserve
+     * @return Reservation (std::nullopt if no budget is set), or vfs_error::budget_exhausted
+     */
+    std::expected<std::optional<memory_budget::reservation>, vfs_error> reserve_bytes(std::uint64_t bytes) const;
+
+    /**
+     * @brief Keep a reservation until a stream is destroyed
+     * @param stream Stream whose buffer the reservation covers
+     * @param reservation Reservation to hand over (no effect if empty)
+     */
+    void retain_reservation(vfstream& stream, std::optional<memory_budget::reservation> reservation) const;
+
+    /**
+     * @brief Transparent string hasher so the cache can be probed without allocating a key
+     */
+    struct cache_hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view path) const noexcept { return path_hash(path); }
+    };
+
+    std::vector<mounted_archive> archives_;                                 /**< Mounted archives, in mount order */
+    std::uint32_t next_mount_id_ = 1;                                       /**< Identifier for the next mount */
     bool cache_enabled_ = true;                                             /**< Cache enable flag */
     search_order search_order_ = search_order::reverse_mount_order;         /**< Default: most recent first */
-    mutable std::unordered_map<std::string, std::vector<std::byte>> cache_; /**< File data cache */
+    lookup_mode lookup_mode_ = lookup_mode::exact;                          /**< Path matching rules */
+    std::uint64_t direct_io_threshold_ = 0;                                 /**< Direct I/O threshold (0 = off) */
+    std::shared_ptr<memory_budget> decompression_budget_;                   /**< Decompression limit, shared with open streams (null = unlimited) */
+    std::optional<std::chrono::milliseconds> decompression_timeout_;        /**< Longest wait for budget (nullopt = forever) */
+    std::pmr::memory_resource* resource_ = std::pmr::get_default_resource(); /**< Source of archive and file buffers */
+    mutable std::pmr::unordered_map<std::pmr::string, std::pmr::vector<std::byte>,
+                                    cache_hash, std::equal_to<>> cache_;    /**< File data cache */
 };
 
 } // namespace dp
\ No newline at end of file
@@ -7,12 +7,23 @@
 #pragma once
 
 #include <iostream>
+#include <array>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
 #include <vector>
 #include <cstddef>
+#include <cstdint>
 
 namespace dp {
 
+class file_handle;
+
 /**
  * @brief Custom stream buffer for virtual file data
  *
@@ -28,6 +39,12 @@ public:
      */
     explicit vfstreambuf(std::vector<std::byte> data);
 
+    /**
+     * @brief Construct stream buffer from byte data owned by a memory resource
+     * @param data The byte data to create a stream buffer from
+     */
+    explicit vfstreambuf(std::pmr::vector<std::byte> data);
+
 protected:
     /**
      * @brief Called when buffer is empty and more data is needed
@@ -62,8 +79,194 @@ protected:
     pos_type seekpos(pos_type sp, std::ios_base::openmode which = std::ios_base::in) override;
 
 private:
-    std::vector<std::byte> data_; /**< The underlying byte data */
-    std::size_t position_;        /**< Current read position */
+    std::vector<std::byte> data_;          /**< The underlying byte data */
+    std::pmr::vector<std::byte> pmr_data_; /**< The underlying byte data, when allocated from a resource */
+    std::size_t position_;                 /**< Current read position */
+};
+
+/**
+ * @brief Stream buffer reading a byte range of a file on demand
+ *
+ * Only the range's offset and size are kept; data is read with positional
+ * reads into a small buffer as the stream is consumed, and large reads go
+ * straight into the caller's memory. Opening costs O(1) regardless of the
+ * range size, memory use stays constant, and seeking only moves the read
+ * position. A failed read ends the stream early.
+ */
+class range_streambuf : public std::streambuf {
+public:
+    /** @brief Default size of the read buffer in bytes */
+    static constexpr std::size_t default_buffer_size = 64 * 1024;
+
+    /**
+     * @brief Construct stream buffer over a range of a file
+     * @param file Open file to read from (shared, so the stream may outlive its archive)
+     * @param offset Byte offset of the range within the file
+     * @param size Length of the range in bytes
+     * @param direct Read with file_handle::read_at_direct() instead of read_at()
+     * @param buffer_size Size of the read buffer in bytes
+     */
+    range_streambuf(std::shared_ptr<const file_handle> file, std::uint64_t offset, std::uint64_t size,
+                    bool direct = false, std::size_t buffer_size = default_buffer_size);
+
+protected:
+    /**
+     * @brief Refill the buffer from the file at the current position
+     * @return Next character or EOF
+     */
+    int_type underflow() override;
+
+    /**
+     * @brief Extract characters, bypassing the buffer for large requests
+     * @param s Pointer to character array to fill
+     * @param count Maximum number of characters to extract
+     * @return Number of characters actually extracted
+     */
+    std::streamsize xsgetn(char_type* s, std::streamsize count) override;
+
+    /**
+     * @brief Get the number of characters left in the range
+     * @return Remaining characters, or -1 at the end of the range
+     */
+    std::streamsize showmanyc() override;
+
+    /**
+     * @brief Seek to a position relative to some base
+     * @param off Offset value
+     * @param way Seek direction (beg, cur, end)
+     * @param which Stream open mode flags
+     * @return New position on success, invalid position on failure
+     */
+    pos_type seekoff(off_type off, std::ios_base::seekdir way,
+                     std::ios_base::openmode which = std::ios_base::in) override;
+
+    /**
+     * @brief Seek to an absolute position
+     * @param sp Absolute position to seek to
+     * @param which Stream open mode flags
+     * @return New position on success, invalid position on failure
+     */
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which = std::ios_base::in) override;
+
+private:
+    /**
+     * @brief Get the logical read position within the range
+     * @return Offset of gptr() relative to the start of the range
+     */
+    std::uint64_t position() const;
+
+    /**
+     * @brief Read range bytes into memory
+     * @param position Offset within the range
+     * @param out Destination
+     * @param count Number of bytes to read
+     * @return True on success
+     */
+    bool read(std::uint64_t position, char* out, std::size_t count) const;
+
+    std::shared_ptr<const file_handle> file_; /**< File containing the range */
+    std::uint64_t offset_;                    /**< Start of the range within the file */
+    std::uint64_t size_;                      /**< Length of the range */
+    bool direct_;                             /**< Bypass the page cache when reading */
+    std::vector<char> buffer_;                /**< Read buffer */
+    std::uint64_t buffer_start_ = 0;          /**< Range offset of buffer_[0] */
+};
+
+/**
+ * @brief Forward-only stream buffer that produces the next window ahead of the reader
+ *
+ * Two windows alternate: a background thread fills one through the source
+ * function (reading and, for compressed entries, decoding) while the caller
+ * consumes the other. A sequential reader therefore waits only for whichever
+ * of the source and the consumer is slower, not for both in turn. Memory use
+ * is two windows regardless of the stream size. Seeking is not supported
+ * beyond querying the position.
+ *
+ * If the source fails or ends before size bytes, reading past the data
+ * produced so far throws std::ios_base::failure from underflow(), so
+ * std::istream operations set badbit (and rethrow if exceptions() asks for
+ * it) instead of reporting a normal end of file.
+ */
+class readahead_streambuf : public std::streambuf {
+public:
+    /**
+     * @brief Produces the next bytes of the stream
+     *
+     * Called on the background thread with a window to fill; returns the
+     * number of bytes written (0 at the end), or std::nullopt on error.
+     */
+    using source_function = std::move_only_function<std::optional<std::size_t>(std::span<std::byte>)>;
+
+    /** @brief Default size of each window in bytes */
+    static constexpr std::size_t default_window_size = 1024 * 1024;
+
+    /**
+     * @brief Construct stream buffer and start prefetching
+     * @param source Function producing consecutive bytes of the stream
+     * @param size Total stream length in bytes
+     * @param window_size Size of each of the two windows in bytes
+     */
+    readahead_streambuf(source_function source, std::uint64_t size,
+                        std::size_t window_size = default_window_size);
+
+protected:
+    /**
+     * @brief Hand the current window back to the producer and switch to the next
+     * @return Next character or EOF
+     * @throws std::ios_base::failure if the source failed before the end of the stream
+     */
+    int_type underflow() override;
+
+    /**
+     * @brief Get the number of characters left in the stream
+     * @return Remaining characters, or -1 at the end of the stream
+     */
+    std::streamsize showmanyc() override;
+
+    /**
+     * @brief Report the current position; other seeks fail
+     * @param off Offset value
+     * @param way Seek direction (beg, cur, end)
+     * @param which Stream open mode flags
+     * @return Current position if the target is the current position, invalid position otherwise
+     */
+    pos_type seekoff(off_type off, std::ios_base::seekdir way,
+                     std::ios_base::openmode which = std::ios_base::in) override;
+
+    /**
+     * @brief Seek to an absolute position (only the current one succeeds)
+     * @param sp Absolute position to seek to
+     * @param which Stream open mode flags
+     * @return New position on success, invalid position on failure
+     */
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which = std::ios_base::in) override;
+
+private:
+    /**
+     * @brief Fill windows in turn until the stream ends or a stop is requested
+     * @param stop Stop token of the producer thread
+     */
+    void produce(std::stop_token stop);
+
+    /**
+     * @brief Get the logical read position within the stream
+     * @return Bytes consumed so far
+     */
+    std::uint64_t position() const;
+
+    source_function source_;                    /**< Produces stream bytes on the producer thread */
+    std::uint64_t size_;                        /**< Total stream length */
+    std::array<std::vector<char>, 2> windows_;  /**< Alternating windows */
+    std::array<std::size_t, 2> filled_{};       /**< Valid bytes in each window */
+    std::mutex mutex_;                          /**< Guards the hand-off state below */
+    std::condition_variable_any changed_;       /**< Signals filled and released windows */
+    std::size_t full_ = 0;                      /**< Windows filled and not yet released by the reader */
+    bool finished_ = false;                     /**< Producer has stopped */
+    bool failed_ = false;                       /**< Producer stopped on a source error or short stream */
+    std::size_t current_ = 0;                   /**< Window the reader consumes next or is consuming */
+    bool holding_ = false;                      /**< Reader is consuming windows_[current_] */
+    std::uint64_t window_start_ = 0;            /**< Stream offset of the current window */
+    std::jthread producer_;                     /**< Last, so it stops before the state it uses goes away */
 };
 
 /**
@@ -81,6 +284,21 @@ public:
      */
     explicit vfstream(std::vector<std::byte> data);
 
+    /**
+     * @brief Construct virtual file stream from byte data owned by a memory resource
+     *
+     * The resource must outlive the stream.
+     *
+     * @param data The decompressed file data to stream
+     */
+    explicit vfstream(std::pmr::vector<std::byte> data);
+
+    /**
+     * @brief Construct virtual file stream over an existing stream buffer
+     * @param buffer The stream buffer to read from (e.g. a range_streambuf)
+     */
+    explicit vfstream(std::unique_ptr<std::streambuf> buffer);
+
     /**
      * @brief Virtual destructor
      */
@@ -94,8 +312,19 @@ public:
     vfstream(vfstream&&) noexcept = default;
     vfstream& operator=(vfstream&&) noexcept = default;
 
+    /**
+     * @brief Keep an object alive until the stream is destroyed
+     *
+     * Used for state tied to the stream's buffer, such as the memory budget
+     * reservation covering it. It is released after the buffer.
+     *
+     * @param owner Object to keep alive
+     */
+    void retain(std::shared_ptr<void> owner) { retained_ = std::move(owner); }
+
 private:
-    std::unique_ptr<vfstreambuf> buffer_; /**< Custom stream buffer */
+    std::shared_ptr<void> retained_;         /**< Released after buffer_ (see retain()) */
+    std::unique_ptr<std::streambuf> buffer_; /**< Custom stream buffer */
 };
 
 } // namespace dp
\ No newline at end of file
@@ -1,23 +1,182 @@
 #include "datapak/archive.hpp"
+#include "datapak/delta.hpp"
+#include "datapak/filter.hpp"
+#include "datapak/hash.hpp"
+#include "datapak/path.hpp"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
+#include <cstdio>
+#include <span>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace dp {
 
-archive::archive(const std::filesystem::path& path, access_mode mode)
-    : path_(path), mode_(mode) {
+std::filesystem::path volume_path(const std::filesystem::path& archive_path, std::uint32_t volume) {
+    char suffix[8];
+    std::snprintf(suffix, sizeof(suffix), ".%03u", static_cast<unsigned>(volume));
+    auto path = archive_path;
+    path += suffix;
+    return path;
+}
+
+namespace {
+
+/**
+ * @brief Sequential reader over a byte range with bounds checking
+ */
+class byte_reader {
+public:
+    explicit byte_reader(std::span<const std::byte> data) : data_(data) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (data_.size() - position_ < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data() + position_, sizeof(T));
+        position_ += sizeof(T);
+        return true;
+    }
+
+    std::span<const std::byte> read_bytes(std::size_t count) {
+        count = std::min(count, data_.size() - position_);
+        const auto bytes = data_.subspan(position_, count);
+        position_ += count;
+        return bytes;
+    }
+
+private:
+    std::span<const std::byte> data_;
+    std::size_t position_ = 0;
+};
+
+/**
+ * @brief Readahead source reading consecutive bytes of a file range
+ */
+class range_source {
+public:
+    range_source(std::shared_ptr<const file_handle> file, std::uint64_t offset, bool direct)
+        : file_(std::move(file)), offset_(offset), direct_(direct) {}
+
+    std::optional<std::size_t> operator()(std::span<std::byte> window) {
+        if (!(direct_ ? file_->read_at_direct(offset_ + position_, window)
+                      : file_->read_at(offset_ + position_, window))) {
+            return std::nullopt;
+        }
+        position_ += window.size();
+        return window.size();
+    }
+
+private:
+    std::shared_ptr<const file_handle> file_;  /**< File holding the range */
+    std::uint64_t offset_;                     /**< Start of the range within the file */
+    bool direct_;                              /**< Bypass the page cache when reading */
+    std::uint64_t position_ = 0;               /**< Range bytes read so far */
+};
+
+/**
+ * @brief Readahead source inflating a DEFLATE range of a file window by window
+ *
+ * The compressed bytes come through a readahead_streambuf of their own, so
+ * the next input block is read on a second thread while this one inflates:
+ * disk, decoder and consumer form a three-stage pipeline.
+ */
+class inflating_source {
+public:
+    /** @brief Compressed bytes prefetched per input window */
+    static constexpr std::size_t input_size = 256 * 1024;
+
+    inflating_source(std::shared_ptr<const file_handle> file, std::uint64_t offset, std::uint64_t size,
+                     std::uint64_t uncompressed_size, bool direct)
+        : size_(size), uncompressed_size_(uncompressed_size),
+          input_(std::make_unique<readahead_streambuf>(range_source(std::move(file), offset, direct), size,
+                                                       input_size)),
+          buffer_(static_cast<std::size_t>(std::min<std::uint64_t>(input_size, size))),
+          inflater_(std::make_unique<inflate_stream>()) {}
+
+    std::optional<std::size_t> operator()(std::span<std::byte> window) {
+        std::size_t produced = 0;
+        while (produced < window.size() && !inflater_->finished()) {
+            if (!refill()) {
+                return std::nullopt;
+            }
+
+            const auto before = pending_.size();
+            const auto written = inflater_->decompress(pending_, window.subspan(produced));
+            if (!written || (*written == 0 && pending_.size() == before && !inflater_->finished())) {
+                return std::nullopt;
+            }
+            produced += *written;
+        }
+
+        // The zlib trailer checksum is only checked once the stream ends, so
+        // drive it to the end after the last byte; output past it means corruption
+        produced_ += produced;
+        if (produced_ == uncompressed_size_) {
+            std::byte spare;
+            while (!inflater_->finished()) {
+                if (!refill()) {
+                    return std::nullopt;
+                }
+                const auto before = pending_.size();
+                const auto written = inflater_->decompress(pending_, std::span(&spare, 1));
+                if (!written || *written != 0 || (pending_.size() == before && !inflater_->finished())) {
+                    return std::nullopt;
+                }
+            }
+        }
+        return produced;
+    }
+
+private:
+    /**
+     * @brief Fetch the next compressed block once the current one is used up
+     * @return False on a read error or if the compressed range ends first
+     */
+    bool refill() {
+        if (!pending_.empty()) {
+            return true;
+        }
+
+        const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(buffer_.size(), size_ - consumed_));
+        if (count == 0 ||
+            input_->sgetn(reinterpret_cast<char*>(buffer_.data()), static_cast<std::streamsize>(count)) !=
+                static_cast<std::streamsize>(count)) {
+            return false;
+        }
+        consumed_ += count;
+        pending_ = std::span(buffer_).first(count);
+        return true;
+    }
+
+    std::uint64_t size_;                           /**< Compressed length */
+    std::uint64_t uncompressed_size_;              /**< Length the stream must inflate to */
+    std::uint64_t consumed_ = 0;                   /**< Compressed bytes taken from input_ */
+    std::uint64_t produced_ = 0;                   /**< Bytes inflated so far */
+    std::unique_ptr<readahead_streambuf> input_;   /**< Compressed bytes, read ahead on their own thread */
+    std::vector<std::byte> buffer_;                /**< Compressed block being inflated */
+    std::span<const std::byte> pending_;           /**< Unconsumed part of buffer_ */
+    std::unique_ptr<inflate_stream> inflater_;     /**< Decoder state (pinned, see inflate_stream) */
+};
+
+} // namespace
+
+archive::archive(const std::filesystem::path& path, access_mode mode, std::pmr::memory_resource* resource)
+    : path_(path), mode_(mode), resource_(resource), memory_data_(resource), volume_data_(resource),
+      entries_(resource), chunk_cache_(std::make_unique<chunk_cache>(DEFAULT_CHUNK_CACHE_CAPACITY)) {
 
     if (mode_ == access_mode::disk) {
-        file_stream_.open(path_, std::ios::binary);
+        file_ = std::make_shared<file_handle>(path_);
     } else {
-        std::ifstream temp_file(path_, std::ios::binary);
-        if (temp_file) {
-            temp_file.seekg(0, std::ios::end);
-            const auto size = temp_file.tellg();
-            temp_file.seekg(0, std::ios::beg);
-
-            memory_data_.resize(size);
-            temp_file.read(reinterpret_cast<char*>(memory_data_.data()), size);
+        const file_handle temp_file(path_);
+        if (temp_file.is_open()) {
+            memory_data_.resize(temp_file.size());
+            if (!temp_file.read_at(0, memory_data_)) {
+                memory_data_.clear();
+            }
         }
     }
 
@@ -28,16 +187,15 @@ archive::archive(const std::filesystem::path& path, access_mode mode)
 
 std::expected<void, archive_error> archive::load_directory() {
     archive_header header{};
+    std::vector<std::byte> directory_buffer;
+    std::span<const std::byte> directory_data;
 
     if (mode_ == access_mode::disk) {
-        if (!file_stream_.is_open()) {
+        if (!file_->is_open()) {
             return std::unexpected{archive_error::file_not_found};
         }
 
-        file_stream_.seekg(0);
-        file_stream_.read(reinterpret_cast<char*>(&header), sizeof(header));
-
-        if (!file_stream_ || file_stream_.gcount() != sizeof(header)) {
+        if (!file_->read_at(0, std::as_writable_bytes(std::span(&header, 1)))) {
             return std::unexpected{archive_error::read_error};
         }
     } else {
@@ -56,142 +214,952 @@ std::expected<void, archive_error> archive::load_directory() {
         return std::unexpected{archive_error::invalid_format};
     }
 
-    directory_.clear();
-    directory_.reserve(header.directory_count);
+    std::uint64_t directory_end = mode_ == access_mode::disk ? file_->size() : memory_data_.size();
+
+    // Streamed archives locate the directory through a trailer at the end
+    if (header.flags & HEADER_FLAG_TRAILER) {
+        archive_trailer trailer{};
+        if (directory_end < sizeof(header) + sizeof(trailer)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        directory_end -= sizeof(trailer);
+
+        if (mode_ == access_mode::disk) {
+            if (!file_->read_at(directory_end, std::as_writable_bytes(std::span(&trailer, 1)))) {
+                return std::unexpected{archive_error::read_error};
+            }
+        } else {
+            std::memcpy(&trailer, memory_data_.data() + directory_end, sizeof(trailer));
+        }
+
+        if (trailer.magic != TRAILER_MAGIC) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        header.directory_offset = trailer.directory_offset;
+        header.flags |= trailer.flags;
+    }
+
+    // The directory and any optional sections run to the end of the file (or
+    // the trailer), so fetch them with a single read instead of several small
+    // reads per entry
+    if (header.directory_offset > directory_end) {
+        return std::unexpected{archive_error::read_error};
+    }
+
+    if (mode_ == access_mode::disk) {
+        directory_buffer.resize(directory_end - header.directory_offset);
+        if (!file_->read_at(header.directory_offset, directory_buffer)) {
+            return std::unexpected{archive_error::read_error};
+        }
+        directory_data = directory_buffer;
+    } else {
+        directory_data = std::span<const std::byte>(memory_data_)
+                             .subspan(header.directory_offset, directory_end - header.directory_offset);
+    }
+
+    directory_offset_ = header.directory_offset;
+    entries_.clear();
+    entries_.reserve(header.directory_count, directory_data.size());
 
-    std::uint64_t current_pos = header.directory_offset;
+    byte_reader reader(directory_data);
 
     for (std::uint32_t i = 0; i < header.directory_count; ++i) {
-        directory_entry entry{};
         std::uint32_t filename_length = 0;
+        if (!reader.read(filename_length)) {
+            return std::unexpected{archive_error::read_error};
+        }
 
-        if (mode_ == access_mode::disk) {
-            file_stream_.seekg(current_pos);
-            file_stream_.read(reinterpret_cast<char*>(&filename_length), sizeof(filename_length));
+        const auto filename = reader.read_bytes(filename_length);
+        if (filename.size() != filename_length) {
+            return std::unexpected{archive_error::read_error};
+        }
 
-            if (filename_length > 0 && filename_length < 4096) {
-                std::string filename(filename_length, '\0');
-                file_stream_.read(filename.data(), filename_length);
-                entry.filename = std::move(filename);
-            }
+        std::uint64_t data_offset = 0;
+        directory_record entry{};
+        if (!reader.read(data_offset) || !reader.read(entry.compressed_size) ||
+            !reader.read(entry.uncompressed_size) || !reader.read(entry.compression)) {
+            return std::unexpected{archive_error::read_error};
+        }
 
-            file_stream_.read(reinterpret_cast<char*>(&entry.data_offset), sizeof(entry.data_offset));
-            file_stream_.read(reinterpret_cast<char*>(&entry.compressed_size), sizeof(entry.compressed_size));
-            file_stream_.read(reinterpret_cast<char*>(&entry.uncompressed_size), sizeof(entry.uncompressed_size));
-            file_stream_.read(reinterpret_cast<char*>(&entry.compression), sizeof(entry.compression));
-        } else {
-            if (current_pos + sizeof(filename_length) > memory_data_.size()) {
-                return std::unexpected{archive_error::read_error};
+        if (data_offset > MAX_RECORD_DATA_OFFSET) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        entry.data_offset = data_offset;
+
+        std::string_view name;
+        if (filename_length > 0 && filename_length < MAX_PATH_LENGTH) {
+            name = std::string_view(reinterpret_cast<const char*>(filename.data()), filename.size());
+        }
+        if (!entries_.push_back(name, entry)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+    }
+
+    entries_.build_index();
+
+    bloom_ = bloom_filter{};
+    path_hash_id_ = 0;
+    if (header.flags & HEADER_FLAG_BLOOM_FILTER) {
+        bloom_section_header bloom_header{};
+        if (!reader.read(bloom_header)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        path_hash_id_ = bloom_header.hash_id;
+
+        const auto word_count = std::size_t{bloom_header.block_count} * bloom_filter::words_per_block;
+        const auto bits = reader.read_bytes(word_count * sizeof(std::uint64_t));
+        if (bits.size() != word_count * sizeof(std::uint64_t)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        // A filter keyed by a different hash function cannot be probed; fall
+        // back to plain directory lookups rather than rejecting the archive
+        if (bloom_header.hash_id == PATH_HASH_ID) {
+            std::vector<std::uint64_t> words(word_count);
+            std::memcpy(words.data(), bits.data(), bits.size());
+            bloom_ = bloom_filter(bloom_header.probe_count, std::move(words));
+        }
+    }
+
+    folded_index_.clear();
+    folded_index_.reserve(entries_.size());
+    bool have_folded_hashes = false;
+
+    if (header.flags & HEADER_FLAG_FOLDED_HASHES) {
+        folded_hash_section_header folded_header{};
+        if (!reader.read(folded_header)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        path_hash_id_ = folded_header.hash_id;
+
+        const auto hashes = reader.read_bytes(std::size_t{folded_header.count} * sizeof(std::uint64_t));
+        if (hashes.size() != std::size_t{folded_header.count} * sizeof(std::uint64_t)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        if (folded_header.hash_id == PATH_HASH_ID && folded_header.count == entries_.size()) {
+            byte_reader hash_reader(hashes);
+            for (std::uint32_t i = 0; i < folded_header.count; ++i) {
+                std::uint64_t hash = 0;
+                hash_reader.read(hash);
+                folded_index_.emplace_back(hash, i);
             }
+            have_folded_hashes = true;
+        }
+    }
 
-            std::memcpy(&filename_length, memory_data_.data() + current_pos, sizeof(filename_length));
-            current_pos += sizeof(filename_length);
+    // Older archives lack the section, so fold and hash every path once here
+    if (!have_folded_hashes) {
+        path_buffer buffer;
+        for (std::uint32_t i = 0; i < entries_.size(); ++i) {
+            const auto folded = normalize_path(entries_.name(i), buffer, true);
+            folded_index_.emplace_back(path_hash(folded.value_or(entries_.name(i))), i);
+        }
+    }
 
-            if (current_pos + filename_length > memory_data_.size()) {
-                return std::unexpected{archive_error::read_error};
+    std::ranges::sort(folded_index_);
+
+    metadata_.clear();
+    if (header.flags & HEADER_FLAG_ENTRY_METADATA) {
+        entry_metadata_section_header metadata_header{};
+        if (!reader.read(metadata_header)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        const auto records = reader.read_bytes(std::size_t{metadata_header.count} * sizeof(entry_metadata));
+        if (records.size() != std::size_t{metadata_header.count} * sizeof(entry_metadata)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        // Checksums from another hash function cannot be compared; drop them
+        if (metadata_header.checksum_id == CONTENT_HASH_ID && metadata_header.count == entries_.size()) {
+            metadata_.resize(metadata_header.count);
+            std::memcpy(metadata_.data(), records.data(), records.size());
+        }
+    }
+
+    tombstones_.clear();
+    if (header.flags & HEADER_FLAG_TOMBSTONES) {
+        tombstone_section_header tombstone_header{};
+        if (!reader.read(tombstone_header)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        tombstones_.reserve(tombstone_header.count);
+        for (std::uint32_t i = 0; i < tombstone_header.count; ++i) {
+            std::uint32_t length = 0;
+            if (!reader.read(length) || length >= MAX_PATH_LENGTH) {
+                return std::unexpected{archive_error::invalid_format};
             }
 
-            if (filename_length > 0 && filename_length < 4096) {
-                entry.filename = std::string(
-                    reinterpret_cast<const char*>(memory_data_.data() + current_pos),
-                    filename_length
-                );
+            const auto path = reader.read_bytes(length);
+            if (path.size() != length) {
+                return std::unexpected{archive_error::invalid_format};
             }
-            current_pos += filename_length;
+            tombstones_.emplace_back(reinterpret_cast<const char*>(path.data()), path.size());
+        }
 
-            if (current_pos + sizeof(entry.data_offset) + sizeof(entry.compressed_size) +
-                sizeof(entry.uncompressed_size) + sizeof(entry.compression) > memory_data_.size()) {
-                return std::unexpected{archive_error::read_error};
+        std::ranges::sort(tombstones_);
+    }
+
+    chunks_.clear();
+    if (header.flags & HEADER_FLAG_CHUNKS) {
+        chunk_section_header chunk_header{};
+        if (!reader.read(chunk_header)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        const auto records = reader.read_bytes(std::size_t{chunk_header.count} * sizeof(chunk_record));
+        if (records.size() != std::size_t{chunk_header.count} * sizeof(chunk_record)) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        chunks_.resize(chunk_header.count);
+        std::memcpy(chunks_.data(), records.data(), records.size());
+    }
+
+    volume_count_ = 1;
+    volume_files_.clear();
+    volume_data_.clear();
+    if (header.flags & HEADER_FLAG_VOLUMES) {
+        volume_section_header volume_header{};
+        if (!reader.read(volume_header) || volume_header.volume_count == 0 ||
+            volume_header.volume_count > MAX_VOLUME_COUNT) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+
+        for (std::uint32_t i = 0; i < entries_.size(); ++i) {
+            std::uint32_t volume = 0;
+            if (!reader.read(volume) || volume >= volume_header.volume_count) {
+                return std::unexpected{archive_error::invalid_format};
             }
+            entries_[i].volume = volume;
+        }
 
-            std::memcpy(&entry.data_offset, memory_data_.data() + current_pos, sizeof(entry.data_offset));
-            current_pos += sizeof(entry.data_offset);
-            std::memcpy(&entry.compressed_size, memory_data_.data() + current_pos, sizeof(entry.compressed_size));
-            current_pos += sizeof(entry.compressed_size);
-            std::memcpy(&entry.uncompressed_size, memory_data_.data() + current_pos, sizeof(entry.uncompressed_size));
-            current_pos += sizeof(entry.uncompressed_size);
-            std::memcpy(&entry.compression, memory_data_.data() + current_pos, sizeof(entry.compression));
-            current_pos += sizeof(entry.compression);
+        if (auto opened = open_volumes(volume_header.volume_count, volume_header.build_id); !opened) {
+            return opened;
         }
+    }
 
-        if (!entry.filename.empty()) {
-            directory_[entry.filename] = std::move(entry);
+    for (const auto& chunk : chunks_) {
+        if (chunk.volume >= volume_count_) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+    }
+
+    return {};
+}
+
+std::expected<void, archive_error> archive::open_volumes(std::uint32_t count, std::uint64_t build_id) {
+    for (std::uint32_t i = 0; i < count; ++i) {
+        auto file = std::make_shared<file_handle>(volume_path(path_, i));
+        if (!file->is_open()) {
+            return std::unexpected{archive_error::file_not_found};
+        }
+
+        // Reject volumes left over from a different build
+        volume_header header{};
+        if (!file->read_at(0, std::as_writable_bytes(std::span(&header, 1))) || header.magic != VOLUME_MAGIC ||
+            header.version != FORMAT_VERSION || header.index != i || header.count != count ||
+            header.build_id != build_id) {
+            return std::unexpected{archive_error::invalid_format};
         }
 
         if (mode_ == access_mode::disk) {
-            current_pos += sizeof(filename_length) + filename_length +
-                          sizeof(entry.data_offset) + sizeof(entry.compressed_size) +
-                          sizeof(entry.uncompressed_size) + sizeof(entry.compression);
+            volume_files_.push_back(std::move(file));
+        } else {
+            auto& data = volume_data_.emplace_back(file->size());
+            if (!file->read_at(0, data)) {
+                return std::unexpected{archive_error::read_error};
+            }
         }
     }
 
+    volume_count_ = count;
     return {};
 }
 
+std::optional<std::uint32_t> archive::find(const path_key& key) const {
+    if (lookup_mode_ != lookup_mode::exact) {
+        return find(key.path);
+    }
+
+    if (!bloom_.may_contain(key.hash)) {
+        return std::nullopt;
+    }
+
+    return entries_.find(key);
+}
+
+std::optional<std::uint32_t> archive::find(std::string_view filename) const {
+    if (lookup_mode_ == lookup_mode::exact) {
+        // Hash once and share it between the Bloom filter and the directory
+        return find(path_key{filename});
+    }
+
+    // Probe with the folded hash, then verify candidates under the active mode
+    const bool fold_case = lookup_mode_ == lookup_mode::case_insensitive;
+
+    path_buffer query_buffer;
+    const auto query = normalize_path(filename, query_buffer, fold_case);
+    if (!query) {
+        return std::nullopt;
+    }
+
+    path_buffer scratch;
+    std::uint64_t hash = 0;
+    if (fold_case) {
+        hash = path_hash(*query);
+    } else {
+        const auto folded = normalize_path(*query, scratch, true);
+        hash = path_hash(*folded);
+    }
+
+    const auto [first, last] = std::ranges::equal_range(
+        folded_index_, hash, {}, &std::pair<std::uint64_t, std::uint32_t>::first);
+
+    for (auto it = first; it != last; ++it) {
+        const auto candidate = entries_.name(it->second);
+        if (candidate == *query) {
+            return it->second;
+        }
+
+        const auto normalized = normalize_path(candidate, scratch, fold_case);
+        if (normalized && *normalized == *query) {
+            return it->second;
+        }
+    }
+
+    return std::nullopt;
+}
+
 std::expected<std::unique_ptr<vfstream>, archive_error>
-archive::open(std::string_view filename) const {
-    const auto it = directory_.find(std::string{filename});
-    if (it == directory_.end()) {
+archive::open(std::string_view filename, io_mode io) const {
+    const auto index = find(filename);
+    if (!index) {
         return std::unexpected{archive_error::entry_not_found};
     }
 
-    auto data_result = read_file_data(it->second);
-    if (!data_result) {
-        return std::unexpected{data_result.error()};
+    return open_entry(*index, io);
+}
+
+std::expected<std::unique_ptr<vfstream>, archive_error>
+archive::open(const path_key& key, io_mode io) const {
+    const auto index = find(key);
+    if (!index) {
+        return std::unexpected{archive_error::entry_not_found};
     }
 
-    if (it->second.compression != compression_method::none) {
-        auto decompressed = compression_engine::decompress(
-            *data_result, it->second.compression, it->second.uncompressed_size
-        );
+    return open_entry(*index, io);
+}
 
-        if (!decompressed) {
+std::expected<std::unique_ptr<vfstream>, archive_error>
+archive::open_entry(std::uint32_t index, io_mode io) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    // Stored entries on disk are streamed on demand instead of read up front
+    const auto& entry = entries_[index];
+    if (mode_ == access_mode::disk && entry.compression == compression_method::none) {
+        const auto& file = volume_files_.empty() ? file_ : volume_files_[entry.volume];
+        if (entry.data_offset + entry.compressed_size > file->size()) {
+            return std::unexpected{archive_error::read_error};
+        }
+
+        const bool direct = resolve_io_mode(entry, io) == io_mode::direct;
+        return std::make_unique<vfstream>(
+            std::make_unique<range_streambuf>(file, entry.data_offset, entry.compressed_size, direct));
+    }
+
+    // Stored entries are read straight into a buffer from the memory resource
+    if (entry.compression == compression_method::none) {
+        std::pmr::vector<std::byte> data(entry.compressed_size, resource_);
+        if (auto read = read_file_data(entry, io, data); !read) {
+            return std::unexpected{read.error()};
+        }
+        return std::make_unique<vfstream>(std::move(data));
+    }
+
+    auto raw = read_raw_entry(index, io);
+    if (!raw) {
+        return std::unexpected{raw.error()};
+    }
+
+    if (entry.compression == compression_method::deflate) {
+        auto data = compression_engine::decompress(*raw, entry.compression, entry.uncompressed_size, resource_);
+        if (!data) {
             return std::unexpected{archive_error::compression_error};
         }
+        return std::make_unique<vfstream>(std::move(*data));
+    }
+
+    // Deltas and chunked entries are assembled by decode_entry(), then copied
+    // into the resource so every stream buffer has the same owner
+    auto data = decode_entry(index, std::move(*raw));
+    if (!data) {
+        return std::unexpected{data.error()};
+    }
+
+    return std::make_unique<vfstream>(std::pmr::vector<std::byte>(data->begin(), data->end(), resource_));
+}
+
+std::expected<std::unique_ptr<vfstream>, archive_error>
+archive::open_sequential(std::string_view filename, std::size_t window_size, io_mode io) const {
+    const auto index = find(filename);
+    if (!index) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    return open_sequential_entry(*index, window_size, io);
+}
+
+std::expected<std::unique_ptr<vfstream>, archive_error>
+archive::open_sequential_entry(std::uint32_t index, std::size_t window_size, io_mode io) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
 
-        return std::make_unique<vfstream>(std::move(*decompressed));
+    // Memory-mode data needs no I/O to overlap, and deltas and chunked
+    // entries are assembled from other entries
+    const auto& entry = entries_[index];
+    if (mode_ != access_mode::disk ||
+        (entry.compression != compression_method::none && entry.compression != compression_method::deflate)) {
+        return open_entry(index, io);
     }
 
-    return std::make_unique<vfstream>(std::move(*data_result));
+    const auto& file = volume_files_.empty() ? file_ : volume_files_[entry.volume];
+    if (entry.data_offset + entry.compressed_size > file->size()) {
+        return std::unexpected{archive_error::read_error};
+    }
+    if (entry.compression == compression_method::none && entry.compressed_size != entry.uncompressed_size) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+
+    const bool direct = resolve_io_mode(entry, io) == io_mode::direct;
+    readahead_streambuf::source_function source;
+    if (entry.compression == compression_method::none) {
+        source = range_source(file, entry.data_offset, direct);
+    } else {
+        source = inflating_source(file, entry.data_offset, entry.compressed_size, entry.uncompressed_size, direct);
+    }
+
+    return std::make_unique<vfstream>(
+        std::make_unique<readahead_streambuf>(std::move(source), entry.uncompressed_size, window_size));
+}
+
+std::expected<std::size_t, archive_error>
+archive::read(std::string_view filename, std::span<std::byte> out, io_mode io) const {
+    const auto index = find(filename);
+    if (!index) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    return read_entry(*index, out, io);
+}
+
+std::expected<std::size_t, archive_error>
+archive::read(const path_key& key, std::span<std::byte> out, io_mode io) const {
+    const auto index = find(key);
+    if (!index) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    return read_entry(*index, out, io);
+}
+
+std::expected<std::size_t, archive_error>
+archive::read_entry(std::uint32_t index, std::span<std::byte> out, io_mode io) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    const auto& entry = entries_[index];
+    if (out.size() < entry.uncompressed_size) {
+        return std::unexpected{archive_error::buffer_too_small};
+    }
+    out = out.first(entry.uncompressed_size);
+
+    if (entry.compression == compression_method::none) {
+        if (entry.compressed_size != entry.uncompressed_size) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        if (auto read = read_file_data(entry, io, out); !read) {
+            return std::unexpected{read.error()};
+        }
+        return out.size();
+    }
+
+    auto raw = read_raw_entry(index, io);
+    if (!raw) {
+        return std::unexpected{raw.error()};
+    }
+
+    if (entry.compression == compression_method::chunked) {
+        if (auto assembled = assemble_chunks(*raw, out); !assembled) {
+            return std::unexpected{assembled.error()};
+        }
+        return out.size();
+    }
+
+    if (entry.compression == compression_method::filtered) {
+        if (!decode_filtered(*raw, out)) {
+            return std::unexpected{archive_error::compression_error};
+        }
+        return out.size();
+    }
+
+    if (entry.compression == compression_method::delta) {
+        auto data = decode_entry(index, std::move(*raw));
+        if (!data) {
+            return std::unexpected{data.error()};
+        }
+        if (data->size() != out.size()) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        std::ranges::copy(*data, out.begin());
+        return data->size();
+    }
+
+    const auto written = compression_engine::decompress_into(*raw, entry.compression, out);
+    if (!written || *written != out.size()) {
+        return std::unexpected{archive_error::compression_error};
+    }
+    return *written;
+}
+
+std::expected<std::vector<std::byte>, archive_error>
+archive::read_raw_entry(std::uint32_t index, io_mode io) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    return read_file_data(entries_[index], io);
+}
+
+std::expected<void, archive_error>
+archive::read_raw_range(std::uint32_t index, std::uint64_t offset, std::span<std::byte> out) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    auto range = entries_[index];
+    if (offset > range.compressed_size || out.size() > range.compressed_size - offset) {
+        return std::unexpected{archive_error::read_error};
+    }
+    range.data_offset = range.data_offset + offset;
+    range.compressed_size = out.size();
+    return read_file_data(range, io_mode::buffered, out);
+}
+
+std::expected<void, archive_error>
+archive::copy_raw_entry(std::uint32_t index, const file_writer& out, std::uint64_t offset) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    const auto& entry = entries_[index];
+    if (mode_ == access_mode::disk) {
+        const auto& file = volume_files_.empty() ? *file_ : *volume_files_[entry.volume];
+        if (!out.copy_from(file, entry.data_offset, entry.compressed_size, offset)) {
+            return std::unexpected{archive_error::read_error};
+        }
+        return {};
+    }
+
+    const auto& memory = volume_data_.empty() ? memory_data_ : volume_data_[entry.volume];
+    if (entry.data_offset + entry.compressed_size > memory.size()) {
+        return std::unexpected{archive_error::read_error};
+    }
+    if (!out.write_at(offset, std::span(memory).subspan(entry.data_offset, entry.compressed_size))) {
+        return std::unexpected{archive_error::read_error};
+    }
+    return {};
+}
+
+std::expected<std::vector<std::byte>, archive_error>
+archive::decode_entry(std::uint32_t index, std::vector<std::byte> raw) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    const auto& entry = entries_[index];
+    if (entry.compression == compression_method::none) {
+        return raw;
+    }
+
+    if (entry.compression == compression_method::delta) {
+        const auto reference = read_delta_reference(raw);
+        if (!delta_base_ || !reference) {
+            return std::unexpected{archive_error::compression_error};
+        }
+
+        const auto base_index = delta_base_->find(reference->base_path);
+        const auto base_info = base_index ? delta_base_->stat_entry(*base_index)
+                                          : std::unexpected{archive_error::entry_not_found};
+        if (!base_info || !delta_base_matches(*reference, base_info->size, base_info->metadata)) {
+            return std::unexpected{archive_error::entry_not_found};
+        }
+
+        std::unique_ptr<vfstream> base;
+        if (base_info->metadata) {
+            auto opened = delta_base_->open_entry(*base_index);
+            if (!opened) {
+                return std::unexpected{opened.error()};
+            }
+            base = std::move(*opened);
+        } else {
+            // Without stored metadata only the size was compared, so the
+            // decoded base is hashed before the delta is applied to it
+            auto base_raw = delta_base_->read_raw_entry(*base_index);
+            if (!base_raw) {
+                return std::unexpected{base_raw.error()};
+            }
+            auto base_data = delta_base_->decode_entry(*base_index, std::move(*base_raw));
+            if (!base_data) {
+                return std::unexpected{base_data.error()};
+            }
+            if (content_hash(*base_data) != reference->base_checksum) {
+                return std::unexpected{archive_error::entry_not_found};
+            }
+            base = std::make_unique<vfstream>(std::move(*base_data));
+        }
+
+        auto target = apply_delta(raw, *base, entry.uncompressed_size);
+        if (!target) {
+            return std::unexpected{archive_error::compression_error};
+        }
+        return std::move(*target);
+    }
+
+    if (entry.compression == compression_method::chunked) {
+        std::vector<std::byte> data(entry.uncompressed_size);
+        if (auto assembled = assemble_chunks(raw, data); !assembled) {
+            return std::unexpected{assembled.error()};
+        }
+        return data;
+    }
+
+    if (entry.compression == compression_method::filtered) {
+        std::vector<std::byte> data(entry.uncompressed_size);
+        if (!decode_filtered(raw, data)) {
+            return std::unexpected{archive_error::compression_error};
+        }
+        return data;
+    }
+
+    auto decompressed = compression_engine::decompress(raw, entry.compression, entry.uncompressed_size);
+    if (!decompressed) {
+        return std::unexpected{archive_error::compression_error};
+    }
+
+    return std::move(*decompressed);
+}
+
+std::vector<std::expected<std::vector<std::byte>, archive_error>>
+archive::read_raw_entries(std::span<const std::uint32_t> indices, io_mode io) const {
+    std::vector<std::expected<std::vector<std::byte>, archive_error>> results(
+        indices.size(), std::unexpected{archive_error::entry_not_found});
+
+    // Per volume, the positions in indices sorted by data offset
+    std::vector<std::vector<std::size_t>> queues(volume_count_);
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        if (indices[i] < entries_.size()) {
+            queues[entries_[indices[i]].volume].push_back(i);
+        }
+    }
+
+    const auto drain = [&](std::vector<std::size_t>& queue) {
+        std::ranges::sort(queue, {}, [&](std::size_t i) { return entries_[indices[i]].data_offset; });
+        for (const auto i : queue) {
+            results[i] = read_file_data(entries_[indices[i]], io);
+        }
+    };
+
+    // Memory-mode volumes are already loaded, so threads would only add overhead
+    if (mode_ == access_mode::memory || volume_count_ == 1) {
+        for (auto& queue : queues) {
+            drain(queue);
+        }
+        return results;
+    }
+
+    {
+        std::vector<std::jthread> readers;
+        for (auto& queue : queues) {
+            if (!queue.empty()) {
+                readers.emplace_back([&drain, &queue] { drain(queue); });
+            }
+        }
+    }
+
+    return results;
+}
+
+std::expected<void, archive_error> archive::verify_entry(std::uint32_t index) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    // Blobs sit between the header and the directory, or inside their volume
+    const auto& entry = entries_[index];
+    std::uint64_t data_begin = sizeof(archive_header);
+    std::uint64_t data_end = directory_offset_;
+    if (volume_count_ > 1) {
+        data_begin = sizeof(volume_header);
+        data_end = mode_ == access_mode::disk ? volume_files_[entry.volume]->size()
+                                              : volume_data_[entry.volume].size();
+    }
+    if (entry.data_offset < data_begin || entry.data_offset > data_end ||
+        entry.compressed_size > data_end - entry.data_offset) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+
+    auto raw = read_raw_entry(index, io_mode::buffered);
+    if (!raw) {
+        return std::unexpected{raw.error()};
+    }
+
+    auto data = decode_entry(index, std::move(*raw));
+    if (!data) {
+        return std::unexpected{data.error()};
+    }
+
+    if (data->size() != entry.uncompressed_size) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+
+    if (index < metadata_.size() && content_hash(*data) != metadata_[index].checksum) {
+        return std::unexpected{archive_error::checksum_mismatch};
+    }
+
+    return {};
+}
+
+std::vector<verify_failure> archive::verify(unsigned threads) const {
+    std::vector<std::uint32_t> order(entries_.size());
+    for (std::uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::ranges::sort(order, {}, [this](std::uint32_t i) {
+        return std::pair{entries_[i].volume, entries_[i].data_offset};
+    });
+
+    // More workers than a few per core only add thread startup and contention
+    const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    if (threads == 0) {
+        threads = hardware;
+    }
+    threads = std::min(threads, hardware * MAX_VERIFY_THREADS_PER_CORE);
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(order.size(), 1)));
+
+    // Workers claim the next entry in offset order, so reads stay mostly sequential
+    std::atomic<std::size_t> next{0};
+    std::mutex failures_mutex;
+    std::vector<verify_failure> failures;
+
+    const auto work = [&] {
+        for (auto i = next.fetch_add(1); i < order.size(); i = next.fetch_add(1)) {
+            if (auto result = verify_entry(order[i]); !result) {
+                std::lock_guard lock(failures_mutex);
+                failures.push_back({order[i], result.error()});
+            }
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned t = 1; t < threads; ++t) {
+            workers.emplace_back(work);
+        }
+        work();
+    }
+
+    std::ranges::sort(failures, {}, &verify_failure::entry);
+    return failures;
+}
+
+bool archive::has_tombstone(std::string_view filename) const {
+    if (tombstones_.empty()) {
+        return false;
+    }
+
+    if (lookup_mode_ == lookup_mode::exact) {
+        return std::ranges::binary_search(tombstones_, filename);
+    }
+
+    // Tombstones are rare, so normalize them on demand instead of indexing
+    const bool fold_case = lookup_mode_ == lookup_mode::case_insensitive;
+    path_buffer query_buffer;
+    const auto query = normalize_path(filename, query_buffer, fold_case);
+    if (!query) {
+        return false;
+    }
+
+    path_buffer buffer;
+    return std::ranges::any_of(tombstones_, [&](const std::string& tombstone) {
+        const auto normalized = normalize_path(tombstone, buffer, fold_case);
+        return normalized && *normalized == *query;
+    });
 }
 
 bool archive::contains(std::string_view filename) const {
-    return directory_.contains(std::string{filename});
+    return find(filename).has_value();
+}
+
+bool archive::contains(const path_key& key) const {
+    return find(key).has_value();
+}
+
+std::expected<file_stat, archive_error> archive::stat(std::string_view filename) const {
+    const auto index = find(filename);
+    if (!index) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    return stat_entry(*index);
+}
+
+std::expected<file_stat, archive_error> archive::stat_entry(std::uint32_t index) const {
+    if (index >= entries_.size()) {
+        return std::unexpected{archive_error::entry_not_found};
+    }
+
+    const auto& entry = entries_[index];
+    std::optional<entry_metadata> metadata;
+    if (index < metadata_.size()) {
+        metadata = metadata_[index];
+    }
+    return file_stat{entry.uncompressed_size, entry.compressed_size, entry.compression, metadata};
 }
 
 std::vector<std::string> archive::list_files() const {
     std::vector<std::string> files;
-    files.reserve(directory_.size());
+    files.reserve(entries_.size());
 
-    for (const auto& [filename, _] : directory_) {
-        files.emplace_back(filename);
+    for (std::uint32_t i = 0; i < entries_.size(); ++i) {
+        files.emplace_back(entries_.name(i));
     }
 
     return files;
 }
 
 std::expected<std::vector<std::byte>, archive_error>
-archive::read_file_data(const directory_entry& entry) const {
+archive::read_file_data(const directory_record& entry, io_mode io) const {
     std::vector<std::byte> data(entry.compressed_size);
+    if (auto read = read_file_data(entry, io, data); !read) {
+        return std::unexpected{read.error()};
+    }
+    return data;
+}
 
-    if (mode_ == access_mode::disk) {
-        file_stream_.seekg(entry.data_offset);
-        file_stream_.read(reinterpret_cast<char*>(data.data()), entry.compressed_size);
+std::expected<void, archive_error>
+archive::read_file_data(const directory_record& entry, io_mode io, std::span<std::byte> out) const {
+    if (out.size() != entry.compressed_size) {
+        return std::unexpected{archive_error::read_error};
+    }
 
-        if (!file_stream_ || file_stream_.gcount() != static_cast<std::streamsize>(entry.compressed_size)) {
+    if (mode_ == access_mode::disk) {
+        const auto& file = volume_files_.empty() ? *file_ : *volume_files_[entry.volume];
+        const bool ok = resolve_io_mode(entry, io) == io_mode::direct ? file.read_at_direct(entry.data_offset, out)
+                                              : file.read_at(entry.data_offset, out);
+        if (!ok) {
             return std::unexpected{archive_error::read_error};
         }
     } else {
-        if (entry.data_offset + entry.compressed_size > memory_data_.size()) {
+        const auto& memory = volume_data_.empty() ? memory_data_ : volume_data_[entry.volume];
+        if (entry.data_offset + entry.compressed_size > memory.size()) {
             return std::unexpected{archive_error::read_error};
         }
 
-        std::memcpy(data.data(), memory_data_.data() + entry.data_offset, entry.compressed_size);
+        std::memcpy(out.data(), memory.data() + entry.data_offset, entry.compressed_size);
+    }
+
+    return {};
+}
+
+std::expected<void, archive_error>
+archive::assemble_chunks(std::span<const std::byte> indices, std::span<std::byte> out) const {
+    if (indices.size() % sizeof(std::uint32_t) != 0) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+
+    std::size_t written = 0;
+    byte_reader reader(indices);
+    for (std::uint32_t index = 0; reader.read(index);) {
+        auto chunk = read_chunk(index);
+        if (!chunk) {
+            return std::unexpected{chunk.error()};
+        }
+        if ((*chunk)->size() > out.size() - written) {
+            return std::unexpected{archive_error::invalid_format};
+        }
+        std::ranges::copy(**chunk, out.begin() + static_cast<std::ptrdiff_t>(written));
+        written += (*chunk)->size();
+    }
+
+    if (written != out.size()) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+    return {};
+}
+
+std::expected<chunk_cache::chunk_data, archive_error> archive::read_chunk(std::uint32_t index) const {
+    if (index >= chunks_.size()) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+
+    if (auto cached = chunk_cache_->find(index)) {
+        return cached;
+    }
+
+    const auto& chunk = chunks_[index];
+    if (chunk.data_offset > MAX_RECORD_DATA_OFFSET) {
+        return std::unexpected{archive_error::invalid_format};
+    }
+
+    directory_record entry{};
+    entry.data_offset = chunk.data_offset;
+    entry.volume = chunk.volume;
+    entry.compressed_size = chunk.compressed_size;
+    entry.uncompressed_size = chunk.size;
+    entry.compression = chunk.compression;
+
+    auto raw = read_file_data(entry, io_mode::buffered);
+    if (!raw) {
+        return std::unexpected{raw.error()};
+    }
+
+    std::vector<std::byte> contents;
+    if (chunk.compression == compression_method::none) {
+        contents = std::move(*raw);
+    } else {
+        auto decompressed = compression_engine::decompress(*raw, chunk.compression, chunk.size);
+        if (!decompressed) {
+            return std::unexpected{archive_error::compression_error};
+        }
+        contents = std::move(*decompressed);
+    }
+
+    if (contents.size() != chunk.size) {
+        return std::unexpected{archive_error::compression_error};
     }
 
+    auto data = std::make_shared<const std::vector<std::byte>>(std::move(contents));
+    chunk_cache_->insert(index, data);
     return data;
 }
 
+io_mode archive::resolve_io_mode(const directory_record& entry, io_mode io) const {
+    if (io != io_mode::automatic) {
+        return io;
+    }
+
+    const bool large = direct_io_threshold_ != 0 && entry.compressed_size >= direct_io_threshold_;
+    return large ? io_mode::direct : io_mode::buffered;
+}
+
 std::expected<archive, archive_error>
 archive::create(const std::filesystem::path& path) {
     try {
@@ -1,11 +1,67 @@
 #include "datapak/archive_builder.hpp"
+#include "datapak/archive.hpp"
+#include "datapak/bloom_filter.hpp"
+#include "datapak/chunk.hpp"
+#include "datapak/delta.hpp"
+#include "datapak/file_handle.hpp"
+#include "datapak/hash.hpp"
+#include "datapak/path.hpp"
 #include <iostream>
 #include <fstream>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace dp {
 
+namespace {
+
+// Second XXH64 seed of chunk digests; any constant other than 0 works
+constexpr std::uint64_t CHUNK_DIGEST_SEED = 0x9E3779B97F4A7C15ULL;
+
+/**
+ * @brief Read a whole source file
+ * @param path Path of the file on disk
+ * @return Expected containing the file contents, or builder_error::file_not_found
+ */
+std::expected<std::vector<std::byte>, builder_error> read_source(const std::filesystem::path& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return std::unexpected{builder_error::file_not_found};
+    }
+
+    input.seekg(0, std::ios::end);
+    const auto file_size = input.tellg();
+    input.seekg(0, std::ios::beg);
+
+    std::vector<std::byte> data(file_size);
+    input.read(reinterpret_cast<char*>(data.data()), file_size);
+    if (!input) {
+        return std::unexpected{builder_error::file_not_found};
+    }
+    return data;
+}
+
+/**
+ * @brief Get a source file's modification time as stored in entry_metadata
+ * @param path Path of the file on disk
+ * @return Nanoseconds on the file clock, or 0 if unavailable
+ */
+std::int64_t source_mtime(const std::filesystem::path& path) {
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(write_time.time_since_epoch()).count();
+}
+
+} // namespace
+
 archive_builder::archive_builder(compression_method default_compression)
     : default_compression_(default_compression) {}
 
@@ -19,6 +75,48 @@ void archive_builder::add_file(const std::filesystem::path& source_path,
     files_.emplace_back(source_path, archive_path, compression);
 }
 
+void archive_builder::add_buffer(const std::string& archive_path,
+                                 std::span<const std::byte> data,
+                                 compression_method compression) {
+    add_buffer(archive_path, std::vector<std::byte>(data.begin(), data.end()), compression);
+}
+
+void archive_builder::add_buffer(const std::string& archive_path,
+                                 std::vector<std::byte>&& data,
+                                 compression_method compression) {
+    if (compression == compression_method::none) {
+        compression = default_compression_;
+    }
+
+    files_.emplace_back(std::filesystem::path{}, archive_path, compression, std::move(data));
+}
+
+void archive_builder::add_generator(const std::string& archive_path,
+                                    content_generator generator,
+                                    compression_method compression) {
+    if (compression == compression_method::none) {
+        compression = default_compression_;
+    }
+
+    files_.emplace_back(std::filesystem::path{}, archive_path, compression,
+                        std::vector<std::byte>{}, std::move(generator));
+}
+
+void archive_builder::add_encoded(const std::string& archive_path,
+                                  compression_method compression,
+                                  encoded_generator generator) {
+    files_.emplace_back(std::filesystem::path{}, archive_path, compression,
+                        std::vector<std::byte>{}, content_generator{}, std::move(generator));
+}
+
+void archive_builder::add_copy(const std::string& archive_path, std::shared_ptr<const archive> source,
+                               std::uint32_t entry) {
+    const auto info = source->stat_entry(entry);
+    const auto compression = info ? info->compression : compression_method::none;
+    files_.emplace_back(std::filesystem::path{}, archive_path, compression, std::vector<std::byte>{},
+                        content_generator{}, encoded_generator{}, std::move(source), entry);
+}
+
 void archive_builder::add_directory(const std::filesystem::path& directory_path,
                                    const std::string& archive_prefix,
                                    compression_method compression) {
@@ -30,6 +128,9 @@ void archive_builder::add_directory(const std::filesystem::path& directory_path,
         compression = default_compression_;
     }
 
+    // Enumeration order is file system specific; sort for reproducible builds
+    std::vector<std::pair<std::string, std::filesystem::path>> found;
+
     for (const auto& entry : std::filesystem::recursive_directory_iterator(directory_path)) {
         if (entry.is_regular_file()) {
             auto relative_path = std::filesystem::relative(entry.path(), directory_path);
@@ -42,25 +143,449 @@ void archive_builder::add_directory(const std::filesystem::path& directory_path,
             // Convert Windows backslashes to forward slashes
             std::replace(archive_path.begin(), archive_path.end(), '\\', '/');
 
-            add_file(entry.path(), archive_path, compression);
+            found.emplace_back(std::move(archive_path), entry.path());
         }
     }
+
+    std::sort(found.begin(), found.end());
+    for (const auto& [archive_path, source_path] : found) {
+        add_file(source_path, archive_path, compression);
+    }
+}
+
+std::expected<void, builder_error>
+archive_builder::set_reference(const std::filesystem::path& previous_archive) {
+    if (!std::filesystem::exists(previous_archive)) {
+        return std::unexpected{builder_error::file_not_found};
+    }
+
+    try {
+        reference_ = std::make_shared<const archive>(previous_archive);
+    } catch (const std::exception&) {
+        return std::unexpected{builder_error::invalid_path};
+    }
+    return {};
+}
+
+void archive_builder::clear_reference() {
+    reference_.reset();
+}
+
+void archive_builder::add_tombstone(const std::string& archive_path) {
+    tombstones_.push_back(archive_path);
+}
+
+std::expected<void, builder_error>
+archive_builder::set_patch_base(const std::filesystem::path& base_archive) {
+    if (!std::filesystem::exists(base_archive)) {
+        return std::unexpected{builder_error::file_not_found};
+    }
+
+    try {
+        patch_base_ = std::make_shared<const archive>(base_archive);
+    } catch (const std::exception&) {
+        return std::unexpected{builder_error::invalid_path};
+    }
+    return {};
+}
+
+void archive_builder::clear_patch_base() {
+    patch_base_.reset();
+}
+
+std::expected<std::vector<std::size_t>, builder_error>
+archive_builder::select_patch_entries(const std::vector<std::size_t>& order,
+                                      std::vector<std::string>& tombstones,
+                                      std::vector<produced_entry>& produced) const {
+    std::vector<std::size_t> changed;
+    std::unordered_set<std::string_view> present;
+    const auto mark_changed = [&](std::size_t index, produced_entry entry = {}) {
+        changed.push_back(index);
+        produced.push_back(std::move(entry));
+    };
+
+    for (const auto index : order) {
+        const auto& file = files_[index];
+        present.insert(file.archive_path);
+
+        const auto base_index = patch_base_->find(file.archive_path);
+        const auto info = base_index ? patch_base_->stat_entry(*base_index)
+                                     : std::unexpected{archive_error::entry_not_found};
+        if (!info) {
+            mark_changed(index); // added
+            continue;
+        }
+
+        // Copied entries carry their checksum if the source stores metadata
+        if (file.copy_source) {
+            const auto copied = file.copy_source->stat_entry(file.copy_entry);
+            if (!copied || !copied->metadata || !info->metadata || copied->size != info->size ||
+                copied->metadata->checksum != info->metadata->checksum) {
+                mark_changed(index);
+            }
+            continue;
+        }
+
+        // Encoded entries carry their checksum; bases without one count as changed
+        if (file.encoded) {
+            auto blob = file.encoded();
+            if (!blob) {
+                return std::unexpected{blob.error()};
+            }
+            if (!info->metadata || blob->uncompressed_size != info->size ||
+                blob->checksum != info->metadata->checksum) {
+                mark_changed(index, {std::nullopt, std::move(*blob)});
+            }
+            continue;
+        }
+
+        // Unchanged size and mtime: no need to read either side
+        if (info->metadata && !file.generator && !file.source_path.empty()) {
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(file.source_path, ec);
+            const auto mtime = source_mtime(file.source_path);
+            if (!ec && size == info->size && mtime != 0 && mtime == info->metadata->mtime) {
+                continue;
+            }
+        }
+
+        std::vector<std::byte> loaded;
+        const std::vector<std::byte>* data = &file.data;
+        const auto mark_loaded_changed = [&] {
+            mark_changed(index, file.generator ? produced_entry{std::move(loaded), std::nullopt}
+                                               : produced_entry{});
+        };
+        if (file.generator) {
+            auto generated = file.generator();
+            if (!generated) {
+                return std::unexpected{generated.error()};
+            }
+            loaded = std::move(*generated);
+            data = &loaded;
+        } else if (!file.source_path.empty()) {
+            auto contents = read_source(file.source_path);
+            if (!contents) {
+                return std::unexpected{contents.error()};
+            }
+            loaded = std::move(*contents);
+            data = &loaded;
+        }
+
+        if (data->size() != info->size) {
+            mark_loaded_changed();
+            continue;
+        }
+
+        // Bases without stored checksums are hashed from their decoded contents
+        std::uint64_t base_checksum = 0;
+        if (info->metadata) {
+            base_checksum = info->metadata->checksum;
+        } else {
+            auto raw = patch_base_->read_raw_entry(*base_index);
+            auto decoded = raw ? patch_base_->decode_entry(*base_index, std::move(*raw))
+                               : std::unexpected{raw.error()};
+            if (!decoded) {
+                mark_loaded_changed();
+                continue;
+            }
+            base_checksum = content_hash(*decoded);
+        }
+
+        if (content_hash(*data) != base_checksum) {
+            mark_loaded_changed();
+        }
+    }
+
+    for (const auto& path : patch_base_->list_files()) {
+        if (!present.contains(path)) {
+            tombstones.push_back(path);
+        }
+    }
+
+    return changed;
+}
+
+std::uint32_t archive_builder::blob_sink::place(std::uint32_t alignment) {
+    const auto volume = static_cast<std::uint32_t>(std::ranges::min_element(offsets) - offsets.begin());
+    auto& offset = offsets[volume];
+
+    // Pad so the blob starts on an alignment boundary
+    if (alignment > 1 && offset % alignment != 0) {
+        const std::vector<char> padding(alignment - offset % alignment, 0);
+        streams[volume]->write(padding.data(), padding.size());
+        offset += padding.size();
+    }
+    return volume;
+}
+
+std::expected<std::pair<std::uint32_t, std::uint64_t>, builder_error>
+archive_builder::blob_sink::write(std::span<const std::byte> data, std::uint32_t alignment) {
+    const auto volume = place(alignment);
+    auto& output = *streams[volume];
+    auto& offset = offsets[volume];
+
+    output.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!output) {
+        return std::unexpected{builder_error::write_error};
+    }
+
+    const auto start = offset;
+    offset += data.size();
+    return std::pair{volume, start};
+}
+
+std::expected<std::pair<std::uint32_t, std::uint64_t>, builder_error>
+archive_builder::blob_sink::copy(const archive& source, std::uint32_t entry, std::uint64_t size,
+                                 std::uint32_t alignment) {
+    const auto volume = place(alignment);
+    auto& output = *streams[volume];
+    auto& offset = offsets[volume];
+
+    if (volume < writers.size()) {
+        // Flush what the stream buffered, copy file to file behind it, then move the stream past the copy
+        if (!output.flush()) {
+            return std::unexpected{builder_error::write_error};
+        }
+        if (!source.copy_raw_entry(entry, *writers[volume], offset)) {
+            return std::unexpected{builder_error::file_not_found};
+        }
+        output.seekp(static_cast<std::streamoff>(offset + size));
+    } else {
+        auto raw = source.read_raw_entry(entry, io_mode::buffered);
+        if (!raw) {
+            return std::unexpected{builder_error::file_not_found};
+        }
+        output.write(reinterpret_cast<const char*>(raw->data()), raw->size());
+    }
+    if (!output) {
+        return std::unexpected{builder_error::write_error};
+    }
+
+    const auto start = offset;
+    offset += size;
+    return std::pair{volume, start};
+}
+
+std::expected<std::vector<std::byte>, builder_error>
+archive_builder::write_chunks(blob_sink& sink, std::span<const std::byte> data,
+                              compression_method compression, chunk_table& chunks) const {
+    std::vector<std::uint32_t> indices;
+
+    while (!data.empty()) {
+        const auto length = next_chunk_boundary(data, chunk_params_);
+        const auto chunk = data.first(length);
+        data = data.subspan(length);
+
+        // Chunks are identified by size and two independently seeded hashes
+        const chunk_table::digest key{content_hash(chunk), content_hash(chunk, CHUNK_DIGEST_SEED),
+                                      static_cast<std::uint32_t>(chunk.size())};
+        if (const auto match = chunks.by_digest.find(key); match != chunks.by_digest.end()) {
+            indices.push_back(match->second);
+            continue;
+        }
+
+        chunk_record record{};
+        record.size = static_cast<std::uint32_t>(chunk.size());
+        record.compression = compression_method::none;
+
+        std::span<const std::byte> stored = chunk;
+        std::vector<std::byte> compressed;
+        if (compression != compression_method::none) {
+            const std::vector<std::byte> buffer(chunk.begin(), chunk.end());
+            auto result = compression_engine::compress(buffer, compression);
+            if (!result) {
+                return std::unexpected{builder_error::compression_error};
+            }
+
+            // Keep chunks that do not shrink uncompressed so reads skip inflate
+            if (result->size() < chunk.size()) {
+                compressed = std::move(*result);
+                stored = compressed;
+                record.compression = compression;
+            }
+        }
+        record.compressed_size = static_cast<std::uint32_t>(stored.size());
+
+        const auto placed = sink.write(stored, 1);
+        if (!placed) {
+            return std::unexpected{placed.error()};
+        }
+        record.volume = placed->first;
+        record.data_offset = placed->second;
+
+        const auto index = static_cast<std::uint32_t>(chunks.records.size());
+        chunks.records.push_back(record);
+        chunks.by_digest.emplace(key, index);
+        indices.push_back(index);
+    }
+
+    std::vector<std::byte> list(indices.size() * sizeof(std::uint32_t));
+    std::memcpy(list.data(), indices.data(), list.size());
+    return list;
+}
+
+std::vector<std::size_t> archive_builder::output_order() const {
+    std::vector<std::size_t> order(files_.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    const auto by_path = [this](std::size_t a, std::size_t b) {
+        return files_[a].archive_path < files_[b].archive_path;
+    };
+
+    switch (blob_order_) {
+    case blob_order::insertion:
+        break;
+
+    case blob_order::path:
+        std::stable_sort(order.begin(), order.end(), by_path);
+        break;
+
+    case blob_order::extension: {
+        std::vector<std::string> extensions(files_.size());
+        for (std::size_t i = 0; i < files_.size(); ++i) {
+            extensions[i] = std::filesystem::path(files_[i].archive_path).extension().string();
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (extensions[a] != extensions[b]) {
+                return extensions[a] < extensions[b];
+            }
+            return by_path(a, b);
+        });
+        break;
+    }
+
+    case blob_order::size: {
+        std::vector<std::uintmax_t> sizes(files_.size());
+        for (std::size_t i = 0; i < files_.size(); ++i) {
+            const auto& file = files_[i];
+            if (file.generator || file.encoded) {
+                sizes[i] = std::numeric_limits<std::uintmax_t>::max(); // unknown until generated
+            } else if (file.source_path.empty()) {
+                sizes[i] = file.data.size();
+            } else {
+                std::error_code ec;
+                const auto size = std::filesystem::file_size(file.source_path, ec);
+                sizes[i] = ec ? 0 : size;
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (sizes[a] != sizes[b]) {
+                return sizes[a] < sizes[b];
+            }
+            return by_path(a, b);
+        });
+        break;
+    }
+
+    case blob_order::manifest: {
+        // Unlisted files rank after every listed one
+        std::unordered_map<std::string_view, std::size_t> rank;
+        for (const auto& path : manifest_) {
+            rank.try_emplace(path, rank.size());
+        }
+
+        std::vector<std::size_t> ranks(files_.size());
+        for (std::size_t i = 0; i < files_.size(); ++i) {
+            const auto it = rank.find(files_[i].archive_path);
+            ranks[i] = it != rank.end() ? it->second : manifest_.size();
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            if (ranks[a] != ranks[b]) {
+                return ranks[a] < ranks[b];
+            }
+            return ranks[a] == manifest_.size() && by_path(a, b);
+        });
+        break;
+    }
+    }
+
+    return order;
 }
 
 std::expected<void, builder_error>
 archive_builder::build(const std::filesystem::path& output_path) {
+    // Truncating the reference would destroy the blobs about to be copied
+    std::error_code ec;
+    if (reference_ && std::filesystem::equivalent(output_path, reference_->path(), ec)) {
+        return std::unexpected{builder_error::invalid_path};
+    }
+
     std::ofstream output(output_path, std::ios::binary);
     if (!output) {
         return std::unexpected{builder_error::write_error};
     }
 
-    // Write placeholder header
+    // Second handles on the created files let copied blobs skip the stream
+    std::vector<std::unique_ptr<file_writer>> writer_files;
+    std::vector<const file_writer*> writers;
+    const auto open_writer = [&](const std::filesystem::path& path) {
+        auto& writer = writer_files.emplace_back(std::make_unique<file_writer>(path));
+        writers.push_back(writer.get());
+        return writer->is_open();
+    };
+
+    if (volume_count_ == 1) {
+        if (!open_writer(output_path)) {
+            return std::unexpected{builder_error::write_error};
+        }
+        return write_archive(output, true, {}, writers);
+    }
+
+    std::vector<std::ofstream> volume_files;
+    std::vector<std::ostream*> volumes;
+    volume_files.reserve(volume_count_);
+    for (std::uint32_t i = 0; i < volume_count_; ++i) {
+        auto& file = volume_files.emplace_back(volume_path(output_path, i), std::ios::binary);
+        if (!file || !open_writer(volume_path(output_path, i))) {
+            return std::unexpected{builder_error::write_error};
+        }
+        volumes.push_back(&file);
+    }
+
+    return write_archive(output, true, volumes, writers);
+}
+
+std::expected<void, builder_error>
+archive_builder::build(std::ostream& output) {
+    // Volume files need paths of their own
+    if (volume_count_ > 1) {
+        return std::unexpected{builder_error::invalid_path};
+    }
+
+    return write_archive(output, false);
+}
+
+std::expected<void, builder_error>
+archive_builder::write_archive(std::ostream& output, bool seekable, std::span<std::ostream* const> volumes,
+                               std::span<const file_writer* const> writers) {
+    auto order = output_order();
+    std::vector<std::string> tombstones = tombstones_;
+
+    // Patches keep only entries that differ from the base, along with the
+    // callback results already produced to tell
+    std::vector<produced_entry> produced;
+    if (patch_base_) {
+        auto changed = select_patch_entries(order, tombstones, produced);
+        if (!changed) {
+            return std::unexpected{changed.error()};
+        }
+        order = std::move(*changed);
+    } else {
+        produced.resize(order.size());
+    }
+
+    std::ranges::sort(tombstones);
+    tombstones.erase(std::ranges::unique(tombstones).begin(), tombstones.end());
+
+    // Write placeholder header; streamed archives never come back to it
     archive_header header{};
     header.magic = MAGIC_NUMBER;
     header.version = FORMAT_VERSION;
-    header.directory_count = static_cast<std::uint32_t>(files_.size());
+    header.directory_count = static_cast<std::uint32_t>(order.size());
     header.directory_offset = 0; // Will be updated later
-    header.reserved = 0;
+    header.flags = seekable ? 0 : HEADER_FLAG_TRAILER;
 
     output.write(reinterpret_cast<const char*>(&header), sizeof(header));
     if (!output) {
@@ -69,60 +594,241 @@ archive_builder::build(const std::filesystem::path& output_path) {
 
     // Write file data and collect directory entries
     std::vector<directory_entry> directory;
-    directory.reserve(files_.size());
+    directory.reserve(order.size());
 
-    std::uint64_t current_offset = sizeof(header);
+    std::vector<entry_metadata> metadata_records;
+    metadata_records.reserve(order.size());
+    reused_count_ = 0;
 
-    for (const auto& file : files_) {
-        // Read source file
-        std::ifstream input(file.source_path, std::ios::binary);
-        if (!input) {
-            return std::unexpected{builder_error::file_not_found};
+    // Blobs follow the header, or the volume header of each volume file
+    blob_sink sink;
+    if (volumes.empty()) {
+        sink.streams.push_back(&output);
+        sink.offsets.push_back(sizeof(header));
+    }
+    // Ties the volume files to this build's directory
+    std::uint64_t build_id = 0;
+    if (!volumes.empty()) {
+        std::random_device random;
+        build_id = (std::uint64_t{random()} << 32) ^ random() ^
+                   static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+    for (std::uint32_t i = 0; i < volumes.size(); ++i) {
+        const volume_header volume{VOLUME_MAGIC, FORMAT_VERSION, i, static_cast<std::uint32_t>(volumes.size()),
+                                   build_id};
+        volumes[i]->write(reinterpret_cast<const char*>(&volume), sizeof(volume));
+        if (!*volumes[i]) {
+            return std::unexpected{builder_error::write_error};
         }
+        sink.streams.push_back(volumes[i]);
+        sink.offsets.push_back(sizeof(volume));
+    }
+    sink.writers.assign(writers.begin(), writers.end());
 
-        input.seekg(0, std::ios::end);
-        const auto file_size = input.tellg();
-        input.seekg(0, std::ios::beg);
+    chunk_table chunks;
 
-        std::vector<std::byte> data(file_size);
-        input.read(reinterpret_cast<char*>(data.data()), file_size);
-        if (!input) {
-            return std::unexpected{builder_error::file_not_found};
+    for (std::size_t position = 0; position < order.size(); ++position) {
+        const auto index = order[position];
+        const auto& file = files_[index];
+
+        // Find the matching blob of the reference archive, if it can be reused
+        std::optional<std::uint32_t> reference_index;
+        entry_metadata reference_metadata{};
+        std::uint64_t reference_size = 0;
+        if (reference_ && !file.encoded && !file.copy_source) {
+            if (const auto found = reference_->find(file.archive_path)) {
+                const auto info = reference_->stat_entry(*found);
+                if (info && info->metadata && info->compression == file.compression) {
+                    reference_index = found;
+                    reference_metadata = *info->metadata;
+                    reference_size = info->size;
+                }
+            }
+        }
+
+        entry_metadata metadata{};
+        bool reuse = false;
+        std::vector<std::byte> reused;
+        std::vector<std::byte> loaded;
+        const std::vector<std::byte>* data = &file.data;
+
+        // Copied blobs are written straight from the source archive below
+        std::optional<file_stat> copied;
+        if (file.copy_source) {
+            auto info = file.copy_source->stat_entry(file.copy_entry);
+            if (!info) {
+                return std::unexpected{builder_error::file_not_found};
+            }
+            if (info->compression == compression_method::chunked) {
+                return std::unexpected{builder_error::compression_error};
+            }
+            copied = *info;
+            reference_size = info->size;
+            metadata.checksum = info->metadata ? info->metadata->checksum : 0;
+            reuse = true;
+        }
+
+        // Pre-encoded bytes are stored as they are
+        if (file.encoded) {
+            auto& earlier = produced[position].blob;
+            auto blob = earlier ? std::expected<encoded_blob, builder_error>{std::move(*earlier)} : file.encoded();
+            if (!blob) {
+                return std::unexpected{blob.error()};
+            }
+            reused = std::move(blob->data);
+            reference_size = blob->uncompressed_size;
+            metadata.checksum = blob->checksum;
+            reuse = true;
+        }
+
+        // Unchanged size and mtime: copy the blob without reading the source
+        if (!file.encoded && !file.generator && !file.source_path.empty()) {
+            metadata.mtime = source_mtime(file.source_path);
+
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(file.source_path, ec);
+            if (reference_index && !ec && size == reference_size && metadata.mtime != 0 &&
+                metadata.mtime == reference_metadata.mtime) {
+                if (auto raw = reference_->read_raw_entry(*reference_index, io_mode::buffered)) {
+                    reused = std::move(*raw);
+                    metadata.checksum = reference_metadata.checksum;
+                    reuse = true;
+                }
+            }
+        }
+
+        if (!reuse) {
+            // Load the contents; in-memory buffers are used in place
+            if (file.generator) {
+                auto& earlier = produced[position].contents;
+                auto generated = earlier ? std::expected<std::vector<std::byte>, builder_error>{std::move(*earlier)}
+                                         : file.generator();
+                if (!generated) {
+                    return std::unexpected{generated.error()};
+                }
+                loaded = std::move(*generated);
+                data = &loaded;
+            } else if (!file.source_path.empty()) {
+                auto contents = read_source(file.source_path);
+                if (!contents) {
+                    return std::unexpected{contents.error()};
+                }
+                loaded = std::move(*contents);
+                data = &loaded;
+            }
+
+            if (entry_metadata_enabled_ || reference_index) {
+                metadata.checksum = content_hash(*data);
+            }
+
+            // Same contents under a new mtime: still skip recompression
+            if (reference_index && data->size() == reference_size &&
+                metadata.checksum == reference_metadata.checksum) {
+                if (auto raw = reference_->read_raw_entry(*reference_index, io_mode::buffered)) {
+                    reused = std::move(*raw);
+                    reuse = true;
+                }
+            }
         }
 
         // Compress if needed
         std::vector<std::byte> compressed_data;
-        if (file.compression != compression_method::none) {
-            auto result = compression_engine::compress(data, file.compression);
+        std::uint64_t uncompressed_size = reference_size;
+        std::span<const std::byte> stored = reused;
+        compression_method method = file.compression;
+        std::vector<std::byte> chunk_list;
+        if (copied) {
+            method = copied->compression;
+        } else if (reuse) {
+            reused_count_ += file.encoded ? 0 : 1;
+        } else if (chunk_dedup_enabled_) {
+            auto list = write_chunks(sink, *data, file.compression, chunks);
+            if (!list) {
+                return std::unexpected{list.error()};
+            }
+            chunk_list = std::move(*list);
+            stored = chunk_list;
+            uncompressed_size = data->size();
+            method = compression_method::chunked;
+        } else if (const auto filter = filters_.find(file.archive_path); filter != filters_.end()) {
+            auto result = make_filtered(*data, filter->second.first, filter->second.second, file.compression);
             if (!result) {
                 return std::unexpected{builder_error::compression_error};
             }
             compressed_data = std::move(*result);
+            stored = compressed_data;
+            uncompressed_size = data->size();
+            method = compression_method::filtered;
+        } else if (file.compression != compression_method::none) {
+            auto result = compression_engine::compress(*data, file.compression);
+            if (!result) {
+                return std::unexpected{builder_error::compression_error};
+            }
+            compressed_data = std::move(*result);
+            stored = compressed_data;
+            uncompressed_size = data->size();
         } else {
-            compressed_data = std::move(data);
+            stored = *data;
+            uncompressed_size = data->size();
         }
 
+        // Changed patch entries may be smaller as a delta against the base version
+        std::vector<std::byte> delta;
+        if (!reuse && method != compression_method::chunked && patch_base_ && patch_deltas_enabled_) {
+            if (const auto base_index = patch_base_->find(file.archive_path)) {
+                const auto info = patch_base_->stat_entry(*base_index);
+                auto raw = info && info->compression != compression_method::delta
+                               ? patch_base_->read_raw_entry(*base_index, io_mode::buffered)
+                               : std::unexpected{archive_error::compression_error};
+                auto base = raw ? patch_base_->decode_entry(*base_index, std::move(*raw))
+                                : std::unexpected{raw.error()};
+                if (base) {
+                    const delta_reference reference{
+                        file.archive_path, info->size,
+                        info->metadata ? info->metadata->checksum : content_hash(*base)};
+                    auto encoded = make_delta(*base, *data, reference);
+                    if (encoded && encoded->size() < stored.size()) {
+                        delta = std::move(*encoded);
+                        stored = delta;
+                        method = compression_method::delta;
+                    }
+                }
+            }
+        }
+
+        // The mtime was only needed for the reuse check unless it is recorded
+        if (!source_mtimes_enabled_) {
+            metadata.mtime = 0;
+        }
+        metadata_records.push_back(metadata);
+
         // Write compressed data to archive
-        output.write(reinterpret_cast<const char*>(compressed_data.data()), compressed_data.size());
-        if (!output) {
-            return std::unexpected{builder_error::write_error};
+        const auto placed = copied ? sink.copy(*file.copy_source, file.copy_entry, copied->compressed_size, alignment_)
+                                   : sink.write(stored, alignment_);
+        if (!placed) {
+            return std::unexpected{placed.error()};
         }
 
         // Create directory entry
         directory_entry entry;
         entry.filename = file.archive_path;
-        entry.data_offset = current_offset;
-        entry.compressed_size = compressed_data.size();
-        entry.uncompressed_size = data.size();
-        entry.compression = file.compression;
+        entry.data_offset = placed->second;
+        entry.compressed_size = copied ? copied->compressed_size : stored.size();
+        entry.uncompressed_size = uncompressed_size;
+        entry.compression = method;
+        entry.volume = placed->first;
 
         directory.push_back(std::move(entry));
-        current_offset += compressed_data.size();
     }
 
-    // Update header with directory offset
-    const auto directory_offset = output.tellp();
-    header.directory_offset = static_cast<std::uint64_t>(directory_offset);
+    for (auto* volume : volumes) {
+        if (!volume->flush()) {
+            return std::unexpected{builder_error::write_error};
+        }
+    }
+
+    // Offsets are counted rather than queried, since pipes cannot tellp()
+    header.directory_offset = volumes.empty() ? sink.offsets.front() : sizeof(header);
 
     // Write directory entries
     for (const auto& entry : directory) {
@@ -140,6 +846,138 @@ archive_builder::build(const std::filesystem::path& output_path) {
         }
     }
 
+    // Write the Bloom filter section over all archive paths
+    if (bloom_filter_enabled_ && !directory.empty()) {
+        std::vector<std::uint64_t> hashes;
+        hashes.reserve(directory.size());
+        for (const auto& entry : directory) {
+            hashes.push_back(path_hash(entry.filename));
+        }
+
+        const auto filter = bloom_filter::build(hashes);
+
+        bloom_section_header bloom_header{};
+        bloom_header.hash_id = PATH_HASH_ID;
+        bloom_header.block_count = filter.block_count();
+        bloom_header.probe_count = filter.probe_count();
+        bloom_header.reserved = 0;
+
+        output.write(reinterpret_cast<const char*>(&bloom_header), sizeof(bloom_header));
+        output.write(reinterpret_cast<const char*>(filter.words().data()), filter.words().size_bytes());
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+
+        header.flags |= HEADER_FLAG_BLOOM_FILTER;
+    }
+
+    // Write the normalized, case-folded hashes in directory order
+    if (folded_hashes_enabled_ && !directory.empty()) {
+        folded_hash_section_header folded_header{};
+        folded_header.hash_id = PATH_HASH_ID;
+        folded_header.count = static_cast<std::uint32_t>(directory.size());
+
+        std::vector<std::uint64_t> hashes;
+        hashes.reserve(directory.size());
+
+        path_buffer buffer;
+        for (const auto& entry : directory) {
+            const auto folded = normalize_path(entry.filename, buffer, true);
+            hashes.push_back(path_hash(folded.value_or(entry.filename)));
+        }
+
+        output.write(reinterpret_cast<const char*>(&folded_header), sizeof(folded_header));
+        output.write(reinterpret_cast<const char*>(hashes.data()), hashes.size() * sizeof(std::uint64_t));
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+
+        header.flags |= HEADER_FLAG_FOLDED_HASHES;
+    }
+
+    // Write checksums and mtimes so later builds can reuse unchanged blobs
+    if (entry_metadata_enabled_ && !directory.empty()) {
+        entry_metadata_section_header metadata_header{};
+        metadata_header.checksum_id = CONTENT_HASH_ID;
+        metadata_header.count = static_cast<std::uint32_t>(metadata_records.size());
+
+        output.write(reinterpret_cast<const char*>(&metadata_header), sizeof(metadata_header));
+        output.write(reinterpret_cast<const char*>(metadata_records.data()),
+                     metadata_records.size() * sizeof(entry_metadata));
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+
+        header.flags |= HEADER_FLAG_ENTRY_METADATA;
+    }
+
+    // Write the paths deleted relative to the base
+    if (!tombstones.empty()) {
+        tombstone_section_header tombstone_header{};
+        tombstone_header.count = static_cast<std::uint32_t>(tombstones.size());
+        tombstone_header.reserved = 0;
+
+        output.write(reinterpret_cast<const char*>(&tombstone_header), sizeof(tombstone_header));
+        for (const auto& path : tombstones) {
+            const auto length = static_cast<std::uint32_t>(path.size());
+            output.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            output.write(path.data(), path.size());
+        }
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+
+        header.flags |= HEADER_FLAG_TOMBSTONES;
+    }
+
+    // Write the table of chunks referenced by chunked entries
+    if (!chunks.records.empty()) {
+        chunk_section_header chunk_header{};
+        chunk_header.count = static_cast<std::uint32_t>(chunks.records.size());
+        chunk_header.reserved = 0;
+
+        output.write(reinterpret_cast<const char*>(&chunk_header), sizeof(chunk_header));
+        output.write(reinterpret_cast<const char*>(chunks.records.data()),
+                     chunks.records.size() * sizeof(chunk_record));
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+
+        header.flags |= HEADER_FLAG_CHUNKS;
+    }
+
+    // Write the volume of every entry
+    if (!volumes.empty()) {
+        volume_section_header volume_header{};
+        volume_header.volume_count = static_cast<std::uint32_t>(volumes.size());
+        volume_header.reserved = 0;
+        volume_header.build_id = build_id;
+
+        output.write(reinterpret_cast<const char*>(&volume_header), sizeof(volume_header));
+        for (const auto& entry : directory) {
+            output.write(reinterpret_cast<const char*>(&entry.volume), sizeof(entry.volume));
+        }
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+
+        header.flags |= HEADER_FLAG_VOLUMES;
+    }
+
+    if (!seekable) {
+        archive_trailer trailer{};
+        trailer.directory_offset = header.directory_offset;
+        trailer.flags = header.flags;
+        trailer.magic = TRAILER_MAGIC;
+
+        output.write(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+        output.flush();
+        if (!output) {
+            return std::unexpected{builder_error::write_error};
+        }
+        return {};
+    }
+
     // Update header at beginning of file
     output.seekp(0);
     output.write(reinterpret_cast<const char*>(&header), sizeof(header));
@@ -0,0 +1,51 @@
+#include "datapak/async.hpp"
+#include <algorithm>
+
+namespace dp {
+
+thread_pool::thread_pool(unsigned threads) {
+    threads = std::max(threads, 1u);
+    workers_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { run(); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    workers_.clear(); // joins
+}
+
+void thread_pool::schedule(std::coroutine_handle<> handle) {
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back(handle);
+    }
+    ready_.notify_one();
+}
+
+void thread_pool::run() {
+    for (;;) {
+        std::coroutine_handle<> handle;
+        {
+            std::unique_lock lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return; // stopping and fully drained
+            }
+            handle = queue_.front();
+            queue_.pop_front();
+        }
+        handle.resume();
+    }
+}
+
+async_engine::async_engine(unsigned io_threads, unsigned decode_threads)
+    : io_(io_threads),
+      decode_(decode_threads != 0 ? decode_threads : std::max(std::thread::hardware_concurrency(), 1u)) {}
+
+} // namespace dp
@@ -0,0 +1,81 @@
+#include "datapak/bloom_filter.hpp"
+#include <algorithm>
+
+namespace dp {
+
+namespace {
+
+// Finalizer from MurmurHash3; spreads weakly mixed input hashes over all 64 bits
+constexpr std::uint64_t mix(std::uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+} // namespace
+
+bloom_filter::bloom_filter(std::uint32_t probe_count, std::vector<std::uint64_t> words)
+    : probe_count_(probe_count), words_(std::move(words)) {
+    // Drop any trailing partial block so probes never run past the end
+    words_.resize(words_.size() - words_.size() % words_per_block);
+}
+
+bloom_filter bloom_filter::build(std::span<const std::uint64_t> hashes, std::uint32_t bits_per_key) {
+    bits_per_key = std::max<std::uint32_t>(bits_per_key, 1);
+
+    const std::size_t total_bits = std::max<std::size_t>(hashes.size() * bits_per_key, 1);
+    const std::size_t blocks = (total_bits + 511) / 512;
+
+    // k = ln(2) * bits_per_key minimizes the false positive rate
+    const auto probes = std::clamp<std::uint32_t>(bits_per_key * 69 / 100, 1, 16);
+
+    bloom_filter filter(probes, std::vector<std::uint64_t>(blocks * words_per_block, 0));
+    for (const auto hash : hashes) {
+        filter.insert(hash);
+    }
+    return filter;
+}
+
+std::size_t bloom_filter::block_offset(std::uint64_t hash) const noexcept {
+    // Map the upper 32 bits onto [0, block_count) without a division
+    const auto block = ((hash >> 32) * block_count()) >> 32;
+    return static_cast<std::size_t>(block) * words_per_block;
+}
+
+void bloom_filter::insert(std::uint64_t hash) noexcept {
+    hash = mix(hash);
+    std::uint64_t* block = words_.data() + block_offset(hash);
+
+    auto h = static_cast<std::uint32_t>(hash);
+    const std::uint32_t delta = (h >> 17) | (h << 15);
+    for (std::uint32_t i = 0; i < probe_count_; ++i) {
+        const std::uint32_t bit = h & 511;
+        block[bit >> 6] |= std::uint64_t{1} << (bit & 63);
+        h += delta;
+    }
+}
+
+bool bloom_filter::may_contain(std::uint64_t hash) const noexcept {
+    if (words_.empty()) {
+        return true;
+    }
+
+    hash = mix(hash);
+    const std::uint64_t* block = words_.data() + block_offset(hash);
+
+    auto h = static_cast<std::uint32_t>(hash);
+    const std::uint32_t delta = (h >> 17) | (h << 15);
+    for (std::uint32_t i = 0; i < probe_count_; ++i) {
+        const std::uint32_t bit = h & 511;
+        if ((block[bit >> 6] & (std::uint64_t{1} << (bit & 63))) == 0) {
+            return false;
+        }
+        h += delta;
+    }
+    return true;
+}
+
+} // namespace dp
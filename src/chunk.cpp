@@ -0,0 +1,112 @@
+#include "datapak/chunk.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace dp {
+
+namespace {
+
+/**
+ * @brief Gear table of 256 pseudo-random words, fixed so chunking is reproducible
+ */
+constexpr std::array<std::uint64_t, 256> make_gear_table() noexcept {
+    std::array<std::uint64_t, 256> table{};
+    std::uint64_t state = 0x6A09E667F3BCC908ULL;
+    for (auto& value : table) {
+        // splitmix64
+        state += 0x9E3779B97F4A7C15ULL;
+        std::uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        value = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr auto gear = make_gear_table();
+
+/**
+ * @brief Mask selecting the top bits of the gear hash, which depend on the most recent bytes
+ */
+constexpr std::uint64_t top_bits(int count) noexcept {
+    count = std::clamp(count, 1, 63);
+    return ~std::uint64_t{0} << (64 - count);
+}
+
+} // namespace
+
+std::size_t next_chunk_boundary(std::span<const std::byte> data, const chunk_params& params) noexcept {
+    const std::size_t min_size = params.min_size;
+    const std::size_t max_size = std::max<std::size_t>(params.max_size, min_size + 1);
+    if (data.size() <= min_size) {
+        return data.size();
+    }
+
+    const std::size_t end = std::min(data.size(), max_size);
+    const std::size_t normal = std::clamp<std::size_t>(params.average_size, min_size, end);
+
+    const int bits = std::bit_width(std::max<std::uint32_t>(params.average_size, 2)) - 1;
+    const std::uint64_t mask_small = top_bits(bits + 2);
+    const std::uint64_t mask_large = top_bits(bits - 2);
+
+    std::uint64_t hash = 0;
+    std::size_t i = min_size;
+    for (; i < normal; ++i) {
+        hash = (hash << 1) + gear[static_cast<std::uint8_t>(data[i])];
+        if ((hash & mask_small) == 0) {
+            return i + 1;
+        }
+    }
+    for (; i < end; ++i) {
+        hash = (hash << 1) + gear[static_cast<std::uint8_t>(data[i])];
+        if ((hash & mask_large) == 0) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+chunk_cache::chunk_data chunk_cache::find(std::uint32_t index) {
+    std::lock_guard lock(mutex_);
+    const auto it = index_.find(index);
+    if (it == index_.end()) {
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+void chunk_cache::insert(std::uint32_t index, chunk_data data) {
+    std::lock_guard lock(mutex_);
+    if (!data || data->size() > capacity_ || index_.contains(index)) {
+        return;
+    }
+
+    size_ += data->size();
+    lru_.emplace_front(index, std::move(data));
+    index_[index] = lru_.begin();
+    evict();
+}
+
+void chunk_cache::set_capacity(std::size_t capacity) {
+    std::lock_guard lock(mutex_);
+    capacity_ = capacity;
+    evict();
+}
+
+std::size_t chunk_cache::size() const {
+    std::lock_guard lock(mutex_);
+    return size_;
+}
+
+void chunk_cache::evict() {
+    while (size_ > capacity_ && !lru_.empty()) {
+        size_ -= lru_.back().second->size();
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+} // namespace dp
@@ -1,17 +1,136 @@
 #include "datapak/compression.hpp"
 #include <zlib.h>
 #include <cstring>
+#include <algorithm>
 #include <array>
+#include <limits>
 
 namespace dp {
 
+namespace {
+
+/**
+ * @brief Inflate DEFLATE-compressed data into an empty byte vector of any allocator
+ * @return True on success
+ */
+template <typename Buffer>
+bool deflate_decompress(std::span<const std::byte> compressed_data, std::size_t uncompressed_size,
+                        Buffer& decompressed) {
+    z_stream stream{};
+
+    if (inflateInit(&stream) != Z_OK) {
+        return false;
+    }
+
+    const auto cleanup = [&stream]() { inflateEnd(&stream); };
+
+    stream.avail_in = static_cast<uInt>(compressed_data.size());
+    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(compressed_data.data()));
+
+    decompressed.reserve(uncompressed_size);
+
+    constexpr std::size_t chunk_size = 16384;
+    std::array<std::byte, chunk_size> buffer;
+
+    int result;
+    do {
+        stream.avail_out = chunk_size;
+        stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+
+        result = inflate(&stream, Z_NO_FLUSH);
+
+        if (result == Z_STREAM_ERROR || result == Z_DATA_ERROR || result == Z_MEM_ERROR) {
+            cleanup();
+            return false;
+        }
+
+        const auto bytes_written = chunk_size - stream.avail_out;
+        decompressed.insert(decompressed.end(), buffer.begin(), buffer.begin() + bytes_written);
+
+    } while (stream.avail_out == 0 && result != Z_STREAM_END);
+
+    cleanup();
+
+    return result == Z_STREAM_END || stream.avail_in == 0;
+}
+
+/**
+ * @brief Inflate DEFLATE-compressed data into a fixed buffer
+ */
+std::expected<std::size_t, compression_error>
+deflate_decompress_into(std::span<const std::byte> compressed_data, std::span<std::byte> out) {
+    z_stream stream{};
+
+    if (inflateInit(&stream) != Z_OK) {
+        return std::unexpected{compression_error::decompression_failed};
+    }
+
+    const auto cleanup = [&stream]() { inflateEnd(&stream); };
+
+    stream.avail_in = static_cast<uInt>(compressed_data.size());
+    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(compressed_data.data()));
+
+    // zlib counts in uInt, so hand out the destination in windows. It also
+    // rejects a null next_out, which an empty span may have
+    std::size_t produced = 0;
+    std::byte spare;
+    for (;;) {
+        const auto window = static_cast<uInt>(
+            std::min<std::size_t>(out.size() - produced, std::numeric_limits<uInt>::max()));
+        stream.next_out = reinterpret_cast<Bytef*>(window > 0 ? out.data() + produced : &spare);
+        stream.avail_out = window;
+
+        const int result = inflate(&stream, Z_NO_FLUSH);
+        produced += window - stream.avail_out;
+
+        if (result == Z_STREAM_END) {
+            break;
+        }
+        if (result == Z_OK) {
+            continue;
+        }
+
+        if (result != Z_BUF_ERROR) {
+            cleanup();
+            return std::unexpected{compression_error::decompression_failed};
+        }
+
+        // No progress. With out full, offer one spare byte to tell a stream
+        // that has only its trailer left from one with more output pending
+        if (produced == out.size()) {
+            stream.next_out = reinterpret_cast<Bytef*>(&spare);
+            stream.avail_out = 1;
+            const int probe = inflate(&stream, Z_NO_FLUSH);
+            if (stream.avail_out == 0) {
+                cleanup();
+                return std::unexpected{compression_error::buffer_too_small};
+            }
+            if (probe == Z_STREAM_END) {
+                break;
+            }
+        }
+
+        // Input ran out before the end of the stream
+        cleanup();
+        if (stream.avail_in == 0) {
+            return produced;
+        }
+        return std::unexpected{compression_error::decompression_failed};
+    }
+
+    cleanup();
+    return produced;
+}
+
+} // namespace
+
 std::expected<std::vector<std::byte>, compression_error>
-compression_engine::compress(const std::vector<std::byte>& data, compression_method method) {
+compression_engine::compress(const std::vector<std::byte>& data, compression_method method, int level) {
     switch (method) {
     case compression_method::none:
         return data;
     case compression_method::deflate:
-        return deflate_compress(data);
+        return deflate_compress(data, level);
     default:
         return std::unexpected{compression_error::invalid_method};
     }
@@ -24,18 +143,65 @@ compression_engine::decompress(const std::vector<std::byte>& compressed_data,
     switch (method) {
     case compression_method::none:
         return compressed_data;
+    case compression_method::deflate: {
+        std::vector<std::byte> decompressed;
+        if (!deflate_decompress(compressed_data, uncompressed_size, decompressed)) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+        return decompressed;
+    }
+    default:
+        return std::unexpected{compression_error::invalid_method};
+    }
+}
+
+std::expected<std::pmr::vector<std::byte>, compression_error>
+compression_engine::decompress(std::span<const std::byte> compressed_data,
+                               compression_method method,
+                               std::size_t uncompressed_size,
+                               std::pmr::memory_resource* resource) {
+    std::pmr::vector<std::byte> decompressed(resource);
+    switch (method) {
+    case compression_method::none:
+        decompressed.assign(compressed_data.begin(), compressed_data.end());
+        return decompressed;
     case compression_method::deflate:
-        return deflate_decompress(compressed_data, uncompressed_size);
+        if (!deflate_decompress(compressed_data, uncompressed_size, decompressed)) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+        return decompressed;
+    default:
+        return std::unexpected{compression_error::invalid_method};
+    }
+}
+
+std::expected<std::size_t, compression_error>
+compression_engine::decompress_into(std::span<const std::byte> compressed_data,
+                                    compression_method method,
+                                    std::span<std::byte> out) {
+    switch (method) {
+    case compression_method::none:
+        if (compressed_data.size() > out.size()) {
+            return std::unexpected{compression_error::buffer_too_small};
+        }
+        std::ranges::copy(compressed_data, out.begin());
+        return compressed_data.size();
+    case compression_method::deflate:
+        return deflate_decompress_into(compressed_data, out);
     default:
         return std::unexpected{compression_error::invalid_method};
     }
 }
 
 std::expected<std::vector<std::byte>, compression_error>
-compression_engine::deflate_compress(const std::vector<std::byte>& data) {
+compression_engine::deflate_compress(const std::vector<std::byte>& data, int level) {
     z_stream stream{};
 
-    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+    if (level != default_level && (level < Z_NO_COMPRESSION || level > Z_BEST_COMPRESSION)) {
+        return std::unexpected{compression_error::invalid_method};
+    }
+
+    if (deflateInit(&stream, level == default_level ? Z_DEFAULT_COMPRESSION : level) != Z_OK) {
         return std::unexpected{compression_error::compression_failed};
     }
 
@@ -76,50 +242,43 @@ compression_engine::deflate_compress(const std::vector<std::byte>& data) {
     return compressed;
 }
 
-std::expected<std::vector<std::byte>, compression_error>
-compression_engine::deflate_decompress(const std::vector<std::byte>& compressed_data,
-                                       std::size_t uncompressed_size) {
-    z_stream stream{};
+inflate_stream::inflate_stream() : stream_(std::make_unique<z_stream>()) {
+    initialized_ = inflateInit(stream_.get()) == Z_OK;
+}
 
-    if (inflateInit(&stream) != Z_OK) {
-        return std::unexpected{compression_error::decompression_failed};
+inflate_stream::~inflate_stream() {
+    if (initialized_) {
+        inflateEnd(stream_.get());
     }
+}
 
-    const auto cleanup = [&stream]() { inflateEnd(&stream); };
-
-    stream.avail_in = static_cast<uInt>(compressed_data.size());
-    stream.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(compressed_data.data()));
-
-    std::vector<std::byte> decompressed;
-    decompressed.reserve(uncompressed_size);
-
-    constexpr std::size_t chunk_size = 16384;
-    std::array<std::byte, chunk_size> buffer;
-
-    int result;
-    do {
-        stream.avail_out = chunk_size;
-        stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
-
-        result = inflate(&stream, Z_NO_FLUSH);
-
-        if (result == Z_STREAM_ERROR || result == Z_DATA_ERROR || result == Z_MEM_ERROR) {
-            cleanup();
-            return std::unexpected{compression_error::decompression_failed};
-        }
-
-        const auto bytes_written = chunk_size - stream.avail_out;
-        decompressed.insert(decompressed.end(), buffer.begin(), buffer.begin() + bytes_written);
+std::expected<std::size_t, compression_error>
+inflate_stream::decompress(std::span<const std::byte>& input, std::span<std::byte> out) {
+    if (!initialized_) {
+        return std::unexpected{compression_error::decompression_failed};
+    }
+    if (finished_ || out.empty()) {
+        return 0;
+    }
 
-    } while (stream.avail_out == 0 && result != Z_STREAM_END);
+    // zlib counts in uInt; larger spans are simply consumed over several calls
+    const auto avail_in = static_cast<uInt>(std::min<std::size_t>(input.size(), std::numeric_limits<uInt>::max()));
+    const auto avail_out = static_cast<uInt>(std::min<std::size_t>(out.size(), std::numeric_limits<uInt>::max()));
+    stream_->next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.data()));
+    stream_->avail_in = avail_in;
+    stream_->next_out = reinterpret_cast<Bytef*>(out.data());
+    stream_->avail_out = avail_out;
 
-    cleanup();
+    const int result = inflate(stream_.get(), Z_NO_FLUSH);
+    input = input.subspan(avail_in - stream_->avail_in);
 
-    if (result != Z_STREAM_END && stream.avail_in > 0) {
+    if (result == Z_STREAM_END) {
+        finished_ = true;
+    } else if (result != Z_OK && result != Z_BUF_ERROR) {
         return std::unexpected{compression_error::decompression_failed};
     }
 
-    return decompressed;
+    return avail_out - stream_->avail_out;
 }
 
-} // namespace dp
\ No newline at end of file
+} // namespace dp
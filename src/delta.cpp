@@ -0,0 +1,210 @@
+#include "datapak/delta.hpp"
+#include <bit>
+#include <cstring>
+#include <unordered_map>
+
+namespace dp {
+
+namespace {
+
+/** @brief Granularity of the base index; also the minimum match length */
+constexpr std::size_t block_size = 16;
+
+std::uint64_t block_hash(const std::byte* p) noexcept {
+    std::uint64_t a;
+    std::uint64_t b;
+    std::memcpy(&a, p, sizeof(a));
+    std::memcpy(&b, p + 8, sizeof(b));
+    return (a * 0x9E3779B97F4A7C15ULL) ^ std::rotl(b * 0xC2B2AE3D27D4EB4FULL, 29);
+}
+
+void put_varint(std::vector<std::byte>& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::byte>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::byte>(value));
+}
+
+bool get_varint(std::span<const std::byte>& in, std::uint64_t& value) noexcept {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (in.empty()) {
+            return false;
+        }
+        const auto byte = static_cast<std::uint8_t>(in.front());
+        in = in.subspan(1);
+        value |= std::uint64_t{byte & 0x7fu} << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Split a delta blob into header, base path and compressed instructions
+ */
+bool split_blob(std::span<const std::byte> blob, delta_header& header,
+                std::span<const std::byte>& path, std::span<const std::byte>& instructions) noexcept {
+    if (blob.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, blob.data(), sizeof(header));
+    if (header.magic != DELTA_MAGIC || header.base_path_length >= MAX_PATH_LENGTH ||
+        blob.size() - sizeof(header) < header.base_path_length) {
+        return false;
+    }
+
+    path = blob.subspan(sizeof(header), header.base_path_length);
+    instructions = blob.subspan(sizeof(header) + header.base_path_length);
+    return true;
+}
+
+} // namespace
+
+std::expected<std::vector<std::byte>, compression_error>
+make_delta(std::span<const std::byte> base, std::span<const std::byte> target,
+           const delta_reference& reference) {
+    // Index every aligned base block; later duplicates keep the first offset
+    std::unordered_map<std::uint64_t, std::uint64_t> index;
+    index.reserve(base.size() / block_size);
+    for (std::size_t pos = 0; pos + block_size <= base.size(); pos += block_size) {
+        index.try_emplace(block_hash(base.data() + pos), pos);
+    }
+
+    std::vector<std::byte> instructions;
+    std::size_t literal_start = 0;
+    std::size_t i = 0;
+
+    const auto emit = [&](std::size_t literal_end, std::uint64_t copy_offset, std::uint64_t copy_length) {
+        put_varint(instructions, literal_end - literal_start);
+        instructions.insert(instructions.end(), target.begin() + literal_start, target.begin() + literal_end);
+        put_varint(instructions, copy_length);
+        if (copy_length != 0) {
+            put_varint(instructions, copy_offset);
+        }
+    };
+
+    while (!index.empty() && i + block_size <= target.size()) {
+        const auto it = index.find(block_hash(target.data() + i));
+        if (it == index.end() || std::memcmp(base.data() + it->second, target.data() + i, block_size) != 0) {
+            ++i;
+            continue;
+        }
+
+        // Grow the match backwards into pending literals, then forwards
+        std::size_t start = i;
+        std::size_t base_pos = it->second;
+        while (start > literal_start && base_pos > 0 && target[start - 1] == base[base_pos - 1]) {
+            --start;
+            --base_pos;
+        }
+
+        std::size_t length = i - start + block_size;
+        while (start + length < target.size() && base_pos + length < base.size() &&
+               target[start + length] == base[base_pos + length]) {
+            ++length;
+        }
+
+        emit(start, base_pos, length);
+        i = start + length;
+        literal_start = i;
+    }
+
+    if (literal_start < target.size() || target.empty()) {
+        emit(target.size(), 0, 0);
+    }
+
+    delta_header header{};
+    header.magic = DELTA_MAGIC;
+    header.base_path_length = static_cast<std::uint32_t>(reference.base_path.size());
+    header.base_size = reference.base_size;
+    header.base_checksum = reference.base_checksum;
+    header.instructions_size = instructions.size();
+
+    auto compressed = compression_engine::compress(instructions, compression_method::deflate);
+    if (!compressed) {
+        return std::unexpected{compressed.error()};
+    }
+
+    std::vector<std::byte> blob(sizeof(header) + reference.base_path.size());
+    std::memcpy(blob.data(), &header, sizeof(header));
+    std::memcpy(blob.data() + sizeof(header), reference.base_path.data(), reference.base_path.size());
+    blob.insert(blob.end(), compressed->begin(), compressed->end());
+    return blob;
+}
+
+std::optional<delta_reference> read_delta_reference(std::span<const std::byte> blob) {
+    delta_header header{};
+    std::span<const std::byte> path;
+    std::span<const std::byte> instructions;
+    if (!split_blob(blob, header, path, instructions)) {
+        return std::nullopt;
+    }
+
+    return delta_reference{std::string(reinterpret_cast<const char*>(path.data()), path.size()),
+                           header.base_size, header.base_checksum};
+}
+
+bool delta_base_matches(const delta_reference& reference, std::uint64_t size,
+                        const std::optional<entry_metadata>& metadata) noexcept {
+    return size == reference.base_size && (!metadata || metadata->checksum == reference.base_checksum);
+}
+
+std::expected<std::vector<std::byte>, compression_error>
+apply_delta(std::span<const std::byte> blob, std::istream& base, std::uint64_t target_size) {
+    delta_header header{};
+    std::span<const std::byte> path;
+    std::span<const std::byte> compressed;
+    if (!split_blob(blob, header, path, compressed)) {
+        return std::unexpected{compression_error::decompression_failed};
+    }
+
+    const auto decoded = compression_engine::decompress(
+        std::vector<std::byte>(compressed.begin(), compressed.end()), compression_method::deflate,
+        header.instructions_size);
+    if (!decoded) {
+        return std::unexpected{decoded.error()};
+    }
+
+    std::vector<std::byte> target(target_size);
+    std::span<const std::byte> in = *decoded;
+    std::uint64_t pos = 0;
+
+    while (pos < target_size) {
+        std::uint64_t literal_length = 0;
+        if (!get_varint(in, literal_length) || literal_length > target_size - pos || literal_length > in.size()) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+        std::memcpy(target.data() + pos, in.data(), literal_length);
+        in = in.subspan(literal_length);
+        pos += literal_length;
+
+        std::uint64_t copy_length = 0;
+        if (!get_varint(in, copy_length) || copy_length > target_size - pos) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+        if (copy_length == 0) {
+            continue;
+        }
+
+        std::uint64_t copy_offset = 0;
+        if (!get_varint(in, copy_offset) || copy_offset > header.base_size ||
+            copy_length > header.base_size - copy_offset) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+
+        base.clear();
+        base.seekg(static_cast<std::streamoff>(copy_offset));
+        base.read(reinterpret_cast<char*>(target.data() + pos), static_cast<std::streamsize>(copy_length));
+        if (static_cast<std::uint64_t>(base.gcount()) != copy_length) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+        pos += copy_length;
+    }
+
+    return target;
+}
+
+} // namespace dp
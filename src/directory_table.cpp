@@ -0,0 +1,92 @@
+#include "datapak/directory_table.hpp"
+#include <bit>
+#include <limits>
+
+namespace dp {
+
+void directory_table::clear() {
+    // Swap with empty containers on the same resource to release the memory
+    decltype(records_)(records_.get_allocator()).swap(records_);
+    decltype(names_)(names_.get_allocator()).swap(names_);
+    decltype(slots_)(slots_.get_allocator()).swap(slots_);
+}
+
+void directory_table::reserve(std::size_t count, std::size_t name_bytes) {
+    records_.reserve(count);
+    names_.reserve(name_bytes);
+}
+
+bool directory_table::push_back(std::string_view name, directory_record record) {
+    if (name.size() > std::numeric_limits<std::uint16_t>::max() ||
+        names_.size() + name.size() > std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+
+    record.name_offset = static_cast<std::uint32_t>(names_.size());
+    record.name_length = static_cast<std::uint16_t>(name.size());
+    record.reserved = 0;
+    names_.append(name);
+    records_.push_back(record);
+    return true;
+}
+
+void directory_table::build_index() {
+    // Appending is done; drop the slack left by reserve()
+    records_.shrink_to_fit();
+    names_.shrink_to_fit();
+
+    slots_.clear();
+    if (records_.empty()) {
+        slots_.shrink_to_fit();
+        return;
+    }
+
+    // Load factor stays between 3/8 and 3/4, so probe sequences stay short
+    slots_.assign(std::bit_ceil(records_.size() + records_.size() / 3 + 1), 0);
+    const std::size_t mask = slots_.size() - 1;
+
+    for (std::uint32_t i = 0; i < records_.size(); ++i) {
+        const auto path = name(i);
+        if (path.empty()) {
+            continue;
+        }
+
+        const auto hash = path_hash(path);
+        const auto tag = hash & 0xffffffff00000000ULL;
+        for (auto position = static_cast<std::size_t>(hash) & mask;; position = (position + 1) & mask) {
+            auto& slot = slots_[position];
+            if (slot == 0 ||
+                ((slot & 0xffffffff00000000ULL) == tag && name(static_cast<std::uint32_t>(slot) - 1) == path)) {
+                slot = tag | (std::uint64_t{i} + 1);
+                break;
+            }
+        }
+    }
+}
+
+std::optional<std::uint32_t> directory_table::find(const path_key& key) const noexcept {
+    if (slots_.empty()) {
+        return std::nullopt;
+    }
+
+    const std::size_t mask = slots_.size() - 1;
+    const auto tag = key.hash & 0xffffffff00000000ULL;
+    for (auto position = static_cast<std::size_t>(key.hash) & mask;; position = (position + 1) & mask) {
+        const auto slot = slots_[position];
+        if (slot == 0) {
+            return std::nullopt;
+        }
+
+        const auto index = static_cast<std::uint32_t>(slot) - 1;
+        if ((slot & 0xffffffff00000000ULL) == tag && name(index) == key.path) {
+            return index;
+        }
+    }
+}
+
+std::size_t directory_table::memory_usage() const noexcept {
+    return records_.capacity() * sizeof(directory_record) + names_.capacity() +
+           slots_.capacity() * sizeof(std::uint64_t);
+}
+
+} // namespace dp
@@ -0,0 +1,424 @@
+#include "datapak/file_handle.hpp"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dp {
+
+namespace {
+
+/** @brief Buffer size for copies the kernel cannot do on its own */
+constexpr std::size_t copy_buffer_size = std::size_t{1} << 20;
+
+/**
+ * @brief Copy a file range through a bounded user-space buffer
+ * @return True if the whole range was copied
+ */
+bool copy_through_buffer(const file_handle& source, std::uint64_t source_offset, std::uint64_t length,
+                         const file_writer& destination, std::uint64_t offset) noexcept {
+    const std::unique_ptr<std::byte[]> buffer(
+        new (std::nothrow) std::byte[static_cast<std::size_t>(std::min<std::uint64_t>(length, copy_buffer_size))]);
+    if (!buffer && length != 0) {
+        return false;
+    }
+
+    while (length != 0) {
+        const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(length, copy_buffer_size));
+        const std::span<std::byte> chunk(buffer.get(), count);
+        if (!source.read_at(source_offset, chunk) || !destination.write_at(offset, chunk)) {
+            return false;
+        }
+        source_offset += count;
+        offset += count;
+        length -= count;
+    }
+    return true;
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+file_handle::file_handle(const std::filesystem::path& path) : path_(path) {
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return;
+    }
+
+    handle_ = handle;
+    size_ = static_cast<std::uint64_t>(size.QuadPart);
+}
+
+bool file_handle::is_open() const noexcept {
+    return handle_ != nullptr;
+}
+
+void file_handle::close() noexcept {
+    if (handle_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = nullptr;
+    }
+}
+
+bool file_handle::read_at(std::uint64_t offset, std::span<std::byte> out) const noexcept {
+    while (!out.empty()) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        const auto chunk = static_cast<DWORD>(std::min<std::size_t>(out.size(), 1u << 30));
+        DWORD bytes_read = 0;
+        if (!ReadFile(static_cast<HANDLE>(handle_), out.data(), chunk, &bytes_read, &overlapped) ||
+            bytes_read == 0) {
+            return false;
+        }
+
+        offset += bytes_read;
+        out = out.subspan(bytes_read);
+    }
+    return true;
+}
+
+bool file_handle::read_at_direct(std::uint64_t offset, std::span<std::byte> out) const noexcept {
+    // Unbuffered handles need sector-aligned buffers for every read; keep
+    // the buffered path until that is worth a second handle here
+    return read_at(offset, out);
+}
+
+file_handle::file_handle(file_handle&& other) noexcept
+    : handle_(std::exchange(other.handle_, nullptr)),
+      path_(std::move(other.path_)),
+      size_(std::exchange(other.size_, 0)) {}
+
+file_handle& file_handle::operator=(file_handle&& other) noexcept {
+    if (this != &other) {
+        close();
+        handle_ = std::exchange(other.handle_, nullptr);
+        path_ = std::move(other.path_);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+file_writer::file_writer(const std::filesystem::path& path) {
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle != INVALID_HANDLE_VALUE) {
+        handle_ = handle;
+    }
+}
+
+file_writer::~file_writer() {
+    if (handle_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+    }
+}
+
+bool file_writer::is_open() const noexcept {
+    return handle_ != nullptr;
+}
+
+bool file_writer::write_at(std::uint64_t offset, std::span<const std::byte> data) const noexcept {
+    while (!data.empty()) {
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        const auto chunk = static_cast<DWORD>(std::min<std::size_t>(data.size(), 1u << 30));
+        DWORD bytes_written = 0;
+        if (!WriteFile(static_cast<HANDLE>(handle_), data.data(), chunk, &bytes_written, &overlapped) ||
+            bytes_written == 0) {
+            return false;
+        }
+
+        offset += bytes_written;
+        data = data.subspan(bytes_written);
+    }
+    return true;
+}
+
+bool file_writer::copy_from(const file_handle& source, std::uint64_t source_offset, std::uint64_t length,
+                            std::uint64_t offset) const noexcept {
+    return copy_through_buffer(source, source_offset, length, *this, offset);
+}
+
+#else
+
+file_handle::file_handle(const std::filesystem::path& path) : path_(path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return;
+    }
+
+    fd_ = fd;
+    size_ = static_cast<std::uint64_t>(info.st_size);
+}
+
+bool file_handle::is_open() const noexcept {
+    return fd_ >= 0;
+}
+
+void file_handle::close() noexcept {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    const int direct_fd = direct_fd_.exchange(-2);
+    if (direct_fd >= 0) {
+        ::close(direct_fd);
+    }
+}
+
+bool file_handle::read_at(std::uint64_t offset, std::span<std::byte> out) const noexcept {
+    while (!out.empty()) {
+        const auto bytes_read = ::pread(fd_, out.data(), out.size(), static_cast<off_t>(offset));
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            return false;
+        }
+
+        offset += static_cast<std::uint64_t>(bytes_read);
+        out = out.subspan(static_cast<std::size_t>(bytes_read));
+    }
+    return true;
+}
+
+namespace {
+
+/**
+ * @brief Open a second descriptor that bypasses the page cache
+ * @return Descriptor, or -1 if direct I/O is unavailable
+ */
+int open_direct(const std::filesystem::path& path) noexcept {
+#ifdef O_DIRECT
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+    return fd >= 0 ? fd : -1;
+#else
+    (void)path;
+    return -1;
+#endif
+}
+
+/** @brief Upper bound on the bounce buffer of a direct read */
+constexpr std::size_t direct_buffer_limit = std::size_t{4} << 20;
+
+/**
+ * @brief Aligned bounce buffer for direct reads, kept per thread
+ *
+ * Grows to the largest request seen on the thread, up to
+ * direct_buffer_limit, so small reads stay small and repeated reads do not
+ * allocate.
+ */
+class direct_buffer {
+public:
+    direct_buffer() = default;
+    ~direct_buffer() { release(); }
+
+    direct_buffer(const direct_buffer&) = delete;
+    direct_buffer& operator=(const direct_buffer&) = delete;
+
+    /**
+     * @brief Ensure the buffer holds at least size bytes
+     * @return True if the buffer is large enough
+     */
+    bool reserve(std::size_t size) noexcept {
+        if (size <= capacity_) {
+            return true;
+        }
+        release();
+        const std::size_t grown = std::min(std::max(size, capacity_ * 2), direct_buffer_limit);
+        data_ = static_cast<std::byte*>(
+            ::operator new(grown, std::align_val_t{file_handle::direct_io_alignment}, std::nothrow));
+        capacity_ = data_ != nullptr ? grown : 0;
+        return data_ != nullptr;
+    }
+
+    std::byte* data() const noexcept { return data_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+
+private:
+    void release() noexcept {
+        ::operator delete(data_, std::align_val_t{file_handle::direct_io_alignment}, std::nothrow);
+        data_ = nullptr;
+    }
+
+    std::byte* data_ = nullptr;   /**< Aligned storage, or nullptr */
+    std::size_t capacity_ = 0;    /**< Size of data_ in bytes */
+};
+
+} // namespace
+
+bool file_handle::read_at_direct(std::uint64_t offset, std::span<std::byte> out) const noexcept {
+    const std::uint64_t start = offset;
+    const std::size_t length = out.size();
+
+    int direct_fd = direct_fd_.load(std::memory_order_acquire);
+    if (direct_fd == -2) {
+        int opened = open_direct(path_);
+        if (!direct_fd_.compare_exchange_strong(direct_fd, opened, std::memory_order_acq_rel)) {
+            if (opened >= 0) {
+                ::close(opened); // another thread won the race
+            }
+        } else {
+            direct_fd = opened;
+        }
+    }
+
+    constexpr std::size_t alignment = direct_io_alignment;
+    const auto round_up = [](std::size_t size) { return (size + alignment - 1) & ~(alignment - 1); };
+
+    if (direct_fd >= 0 && !out.empty()) {
+        // Size the bounce buffer to the widened request, not the upper bound
+        thread_local direct_buffer bounce;
+        const auto first_skip = static_cast<std::size_t>(offset & (alignment - 1));
+        const bool ready = bounce.reserve(std::min(direct_buffer_limit, round_up(first_skip + out.size())));
+
+        while (ready && !out.empty()) {
+            // Widen the request to aligned boundaries and copy out the middle
+            const std::uint64_t aligned_offset = offset & ~std::uint64_t{alignment - 1};
+            const auto skip = static_cast<std::size_t>(offset - aligned_offset);
+            const std::size_t wanted = std::min(bounce.capacity(), round_up(skip + out.size()));
+
+            ssize_t bytes_read = 0;
+            do {
+                bytes_read = ::pread(direct_fd, bounce.data(), wanted, static_cast<off_t>(aligned_offset));
+            } while (bytes_read < 0 && errno == EINTR);
+
+            if (bytes_read <= static_cast<ssize_t>(skip)) {
+                break; // rejected by the file system, or end of file
+            }
+
+            const std::size_t usable = std::min(static_cast<std::size_t>(bytes_read) - skip, out.size());
+            std::memcpy(out.data(), bounce.data() + skip, usable);
+            offset += usable;
+            out = out.subspan(usable);
+        }
+    }
+
+    if (out.empty()) {
+        return true;
+    }
+
+    // Buffered fallback: read the remainder, then ask the kernel to drop it
+    const bool ok = read_at(offset, out);
+#ifdef POSIX_FADV_DONTNEED
+    ::posix_fadvise(fd_, static_cast<off_t>(start), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+#else
+    (void)start;
+    (void)length;
+#endif
+    return ok;
+}
+
+file_handle::file_handle(file_handle&& other) noexcept
+    : fd_(std::exchange(other.fd_, -1)),
+      direct_fd_(other.direct_fd_.exchange(-2)),
+      path_(std::move(other.path_)),
+      size_(std::exchange(other.size_, 0)) {}
+
+file_handle& file_handle::operator=(file_handle&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd_ = std::exchange(other.fd_, -1);
+        direct_fd_.store(other.direct_fd_.exchange(-2));
+        path_ = std::move(other.path_);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+file_writer::file_writer(const std::filesystem::path& path) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        fd_ = fd;
+    }
+}
+
+file_writer::~file_writer() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool file_writer::is_open() const noexcept {
+    return fd_ >= 0;
+}
+
+bool file_writer::write_at(std::uint64_t offset, std::span<const std::byte> data) const noexcept {
+    while (!data.empty()) {
+        const auto bytes_written = ::pwrite(fd_, data.data(), data.size(), static_cast<off_t>(offset));
+        if (bytes_written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_written <= 0) {
+            return false;
+        }
+
+        offset += static_cast<std::uint64_t>(bytes_written);
+        data = data.subspan(static_cast<std::size_t>(bytes_written));
+    }
+    return true;
+}
+
+bool file_writer::copy_from(const file_handle& source, std::uint64_t source_offset, std::uint64_t length,
+                            std::uint64_t offset) const noexcept {
+#ifdef __linux__
+    while (length != 0) {
+        auto in = static_cast<off_t>(source_offset);
+        auto out = static_cast<off_t>(offset);
+        const auto copied = ::copy_file_range(source.fd_, &in, fd_, &out, static_cast<std::size_t>(length), 0);
+        if (copied < 0 && errno == EINTR) {
+            continue;
+        }
+        if (copied < 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+            break; // not supported for this pair of files; copy the rest by hand
+        }
+        if (copied <= 0) {
+            return false;
+        }
+
+        source_offset += static_cast<std::uint64_t>(copied);
+        offset += static_cast<std::uint64_t>(copied);
+        length -= static_cast<std::uint64_t>(copied);
+    }
+#endif
+    return copy_through_buffer(source, source_offset, length, *this, offset);
+}
+
+#endif
+
+file_handle::~file_handle() {
+    close();
+}
+
+} // namespace dp
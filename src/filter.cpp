@@ -0,0 +1,333 @@
+#include "datapak/filter.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DATAPAK_FILTER_SSE2 1
+#endif
+
+namespace dp {
+
+namespace {
+
+std::uint32_t byte_at(const std::byte* p) noexcept {
+    return std::to_integer<std::uint32_t>(*p);
+}
+
+void shuffle(const std::byte* in, std::byte* out, std::size_t size, std::size_t element_size) noexcept {
+    const std::size_t count = size / element_size;
+    for (std::size_t i = 0; i < count; ++i) {
+        for (std::size_t k = 0; k < element_size; ++k) {
+            out[k * count + i] = in[i * element_size + k];
+        }
+    }
+    std::copy(in + count * element_size, in + size, out + count * element_size);
+}
+
+void delta_encode(const std::byte* in, std::byte* out, std::size_t size, std::size_t distance) noexcept {
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto previous = i >= distance ? byte_at(in + i - distance) : 0u;
+        out[i] = static_cast<std::byte>(byte_at(in + i) - previous);
+    }
+}
+
+/**
+ * @brief Find the next E8/E9 opcode with a full operand after it
+ * @return Position of the opcode, or end if there is none before end
+ */
+std::size_t find_branch(const std::byte* data, std::size_t position, std::size_t end) noexcept {
+#ifdef DATAPAK_FILTER_SSE2
+    const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFE));
+    const __m128i opcode = _mm_set1_epi8(static_cast<char>(0xE8));
+    for (; position + 16 <= end; position += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        const int hits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, mask), opcode));
+        if (hits != 0) {
+            return position + static_cast<std::size_t>(std::countr_zero(static_cast<unsigned>(hits)));
+        }
+    }
+#endif
+    for (; position < end; ++position) {
+        if ((byte_at(data + position) & 0xFE) == 0xE8) {
+            return position;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief Convert CALL/JMP rel32 operands between relative and absolute form in place
+ *
+ * Only operands within +-16 MiB (top byte 0x00 or 0xFF) are converted, as
+ * 25-bit values, so the converted operand has the same property and the
+ * decoder makes the same decisions as the encoder. Operand bytes are never
+ * inspected as opcodes, whether converted or not.
+ */
+template <bool Encode>
+void convert_x86_branches(std::span<std::byte> data) noexcept {
+    if (data.size() < 5) {
+        return;
+    }
+
+    const std::size_t end = data.size() - 4;
+    for (auto i = find_branch(data.data(), 0, end); i < end; i = find_branch(data.data(), i + 5, end)) {
+        std::byte* operand = data.data() + i + 1;
+        const auto top = byte_at(operand + 3);
+        if (top != 0x00 && top != 0xFF) {
+            continue;
+        }
+
+        std::uint32_t value = byte_at(operand) | byte_at(operand + 1) << 8 | byte_at(operand + 2) << 16 |
+                              (top & 1u) << 24;
+        const auto position = static_cast<std::uint32_t>(i + 5);
+        value = (Encode ? value + position : value - position) & 0x1FFFFFF;
+
+        operand[0] = static_cast<std::byte>(value);
+        operand[1] = static_cast<std::byte>(value >> 8);
+        operand[2] = static_cast<std::byte>(value >> 16);
+        operand[3] = (value >> 24) ? std::byte{0xFF} : std::byte{0x00};
+    }
+}
+
+#ifdef DATAPAK_FILTER_SSE2
+/**
+ * @brief Interleave 2, 4 or 8 byte planes sixteen elements at a time
+ * @return Number of elements written
+ */
+std::size_t unshuffle_sse2(const std::byte* in, std::byte* out, std::size_t count, std::size_t element_size) noexcept {
+    const auto load = [&](std::size_t plane, std::size_t i) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + plane * count + i));
+    };
+    const auto store = [&](std::size_t offset, __m128i value) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + offset), value);
+    };
+
+    std::size_t i = 0;
+    switch (element_size) {
+    case 2:
+        for (; i + 16 <= count; i += 16) {
+            const __m128i a = load(0, i);
+            const __m128i b = load(1, i);
+            store(i * 2, _mm_unpacklo_epi8(a, b));
+            store(i * 2 + 16, _mm_unpackhi_epi8(a, b));
+        }
+        break;
+    case 4:
+        for (; i + 16 <= count; i += 16) {
+            const __m128i a = load(0, i), b = load(1, i), c = load(2, i), d = load(3, i);
+            const __m128i ab_lo = _mm_unpacklo_epi8(a, b), ab_hi = _mm_unpackhi_epi8(a, b);
+            const __m128i cd_lo = _mm_unpacklo_epi8(c, d), cd_hi = _mm_unpackhi_epi8(c, d);
+            store(i * 4, _mm_unpacklo_epi16(ab_lo, cd_lo));
+            store(i * 4 + 16, _mm_unpackhi_epi16(ab_lo, cd_lo));
+            store(i * 4 + 32, _mm_unpacklo_epi16(ab_hi, cd_hi));
+            store(i * 4 + 48, _mm_unpackhi_epi16(ab_hi, cd_hi));
+        }
+        break;
+    case 8:
+        for (; i + 16 <= count; i += 16) {
+            __m128i lo[4], hi[4];
+            for (std::size_t pair = 0; pair < 4; ++pair) {
+                const __m128i a = load(pair * 2, i), b = load(pair * 2 + 1, i);
+                lo[pair] = _mm_unpacklo_epi8(a, b);
+                hi[pair] = _mm_unpackhi_epi8(a, b);
+            }
+
+            // Bytes 0-3 (low) and 4-7 (high) of elements 0-3, 4-7, 8-11 and 12-15
+            const __m128i low[4] = {_mm_unpacklo_epi16(lo[0], lo[1]), _mm_unpackhi_epi16(lo[0], lo[1]),
+                                    _mm_unpacklo_epi16(hi[0], hi[1]), _mm_unpackhi_epi16(hi[0], hi[1])};
+            const __m128i high[4] = {_mm_unpacklo_epi16(lo[2], lo[3]), _mm_unpackhi_epi16(lo[2], lo[3]),
+                                     _mm_unpacklo_epi16(hi[2], hi[3]), _mm_unpackhi_epi16(hi[2], hi[3])};
+            for (std::size_t quad = 0; quad < 4; ++quad) {
+                store(i * 8 + quad * 32, _mm_unpacklo_epi32(low[quad], high[quad]));
+                store(i * 8 + quad * 32 + 16, _mm_unpackhi_epi32(low[quad], high[quad]));
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    return i;
+}
+
+/**
+ * @brief Undo delta coding with a prefix sum over 16-byte blocks
+ * @return Number of bytes written
+ */
+template <int Distance>
+std::size_t delta_decode_sse2(const std::byte* in, std::byte* out, std::size_t size) noexcept {
+    __m128i carry = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        if constexpr (Distance <= 1) {
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+        }
+        if constexpr (Distance <= 2) {
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+        }
+        if constexpr (Distance <= 4) {
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+        }
+        x = _mm_add_epi8(_mm_add_epi8(x, _mm_slli_si128(x, 8)), carry);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+
+        // Repeat the last Distance output bytes across the register for the next block
+        if constexpr (Distance == 1) {
+            carry = _mm_shuffle_epi32(_mm_shufflehi_epi16(_mm_unpackhi_epi8(x, x), 0xFF), 0xFF);
+        } else if constexpr (Distance == 2) {
+            carry = _mm_shuffle_epi32(_mm_shufflehi_epi16(x, 0xFF), 0xFF);
+        } else if constexpr (Distance == 4) {
+            carry = _mm_shuffle_epi32(x, 0xFF);
+        } else {
+            carry = _mm_unpackhi_epi64(x, x);
+        }
+    }
+    return i;
+}
+#endif
+
+} // namespace
+
+bool valid_filter(filter_type filter, std::size_t element_size) noexcept {
+    switch (filter) {
+    case filter_type::none:
+    case filter_type::bcj_x86:
+        return true;
+    case filter_type::shuffle:
+    case filter_type::delta:
+        return element_size >= 1 && element_size <= MAX_FILTER_ELEMENT_SIZE;
+    }
+    return false;
+}
+
+std::vector<std::byte> apply_filter(std::span<const std::byte> data, filter_type filter, std::size_t element_size) {
+    std::vector<std::byte> out(data.size());
+    switch (filter) {
+    case filter_type::shuffle:
+        shuffle(data.data(), out.data(), data.size(), std::max<std::size_t>(element_size, 1));
+        break;
+    case filter_type::delta:
+        delta_encode(data.data(), out.data(), data.size(), std::max<std::size_t>(element_size, 1));
+        break;
+    case filter_type::bcj_x86:
+        std::ranges::copy(data, out.begin());
+        convert_x86_branches<true>(out);
+        break;
+    default:
+        std::ranges::copy(data, out.begin());
+        break;
+    }
+    return out;
+}
+
+bool reverse_filter(std::span<const std::byte> filtered, filter_type filter, std::size_t element_size,
+                    std::span<std::byte> out) {
+    if (out.size() != filtered.size() || !valid_filter(filter, element_size)) {
+        return false;
+    }
+
+    const std::byte* in = filtered.data();
+    const std::size_t size = filtered.size();
+    switch (filter) {
+    case filter_type::shuffle: {
+        const std::size_t count = size / element_size;
+        std::size_t done = 0;
+#ifdef DATAPAK_FILTER_SSE2
+        done = unshuffle_sse2(in, out.data(), count, element_size);
+#endif
+        for (std::size_t i = done; i < count; ++i) {
+            for (std::size_t k = 0; k < element_size; ++k) {
+                out[i * element_size + k] = in[k * count + i];
+            }
+        }
+        std::copy(in + count * element_size, in + size, out.begin() + static_cast<std::ptrdiff_t>(count * element_size));
+        return true;
+    }
+    case filter_type::delta: {
+        std::size_t done = 0;
+#ifdef DATAPAK_FILTER_SSE2
+        switch (element_size) {
+        case 1: done = delta_decode_sse2<1>(in, out.data(), size); break;
+        case 2: done = delta_decode_sse2<2>(in, out.data(), size); break;
+        case 4: done = delta_decode_sse2<4>(in, out.data(), size); break;
+        case 8: done = delta_decode_sse2<8>(in, out.data(), size); break;
+        default: break;
+        }
+#endif
+        for (std::size_t i = done; i < size; ++i) {
+            const auto previous = i >= element_size ? byte_at(out.data() + i - element_size) : 0u;
+            out[i] = static_cast<std::byte>(byte_at(in + i) + previous);
+        }
+        return true;
+    }
+    case filter_type::bcj_x86:
+        std::ranges::copy(filtered, out.begin());
+        convert_x86_branches<false>(out);
+        return true;
+    case filter_type::none:
+        std::ranges::copy(filtered, out.begin());
+        return true;
+    }
+    return false;
+}
+
+std::expected<std::vector<std::byte>, compression_error>
+make_filtered(std::span<const std::byte> data, filter_type filter, std::size_t element_size,
+              compression_method method, int level) {
+    if (!valid_filter(filter, element_size) ||
+        (method != compression_method::none && method != compression_method::deflate)) {
+        return std::unexpected{compression_error::invalid_method};
+    }
+
+    const bool sized = filter == filter_type::shuffle || filter == filter_type::delta;
+    const filter_header header{filter, static_cast<std::uint8_t>(sized ? element_size : 1), method, 0};
+
+    auto compressed = compression_engine::compress(apply_filter(data, filter, element_size), method, level);
+    if (!compressed) {
+        return std::unexpected{compressed.error()};
+    }
+
+    std::vector<std::byte> blob(sizeof(header) + compressed->size());
+    std::memcpy(blob.data(), &header, sizeof(header));
+    std::ranges::copy(*compressed, blob.begin() + sizeof(header));
+    return blob;
+}
+
+std::expected<void, compression_error> decode_filtered(std::span<const std::byte> blob, std::span<std::byte> out) {
+    filter_header header{};
+    if (blob.size() < sizeof(header)) {
+        return std::unexpected{compression_error::decompression_failed};
+    }
+    std::memcpy(&header, blob.data(), sizeof(header));
+
+    if (!valid_filter(header.filter, header.element_size) ||
+        (header.compression != compression_method::none && header.compression != compression_method::deflate)) {
+        return std::unexpected{compression_error::decompression_failed};
+    }
+
+    const auto payload = blob.subspan(sizeof(header));
+
+    // The branch filter is undone in place, so it decompresses straight into out
+    if (header.filter == filter_type::none || header.filter == filter_type::bcj_x86) {
+        const auto written = compression_engine::decompress_into(payload, header.compression, out);
+        if (!written || *written != out.size()) {
+            return std::unexpected{compression_error::decompression_failed};
+        }
+        if (header.filter == filter_type::bcj_x86) {
+            convert_x86_branches<false>(out);
+        }
+        return {};
+    }
+
+    std::vector<std::byte> filtered(out.size());
+    const auto written = compression_engine::decompress_into(payload, header.compression, filtered);
+    if (!written || *written != out.size() ||
+        !reverse_filter(filtered, header.filter, header.element_size, out)) {
+        return std::unexpected{compression_error::decompression_failed};
+    }
+    return {};
+}
+
+} // namespace dp
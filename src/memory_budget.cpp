@@ -0,0 +1,58 @@
+#include "datapak/memory_budget.hpp"
+#include <algorithm>
+
+namespace dp {
+
+void memory_budget::reservation::reset() noexcept {
+    if (budget_) {
+        std::exchange(budget_, nullptr)->release(bytes_);
+    }
+}
+
+void memory_budget::reservation::shrink_to(std::uint64_t bytes) noexcept {
+    if (budget_ && bytes < bytes_) {
+        budget_->release(bytes_ - bytes);
+        bytes_ = bytes;
+    }
+}
+
+std::optional<memory_budget::reservation>
+memory_budget::acquire(std::uint64_t bytes, std::optional<std::chrono::steady_clock::time_point> deadline) {
+    // Oversized requests wait for the whole budget instead of forever
+    bytes = std::min(bytes, capacity_);
+
+    std::unique_lock lock(mutex_);
+    const auto ticket = next_ticket_++;
+    queue_.push_back(ticket);
+
+    const auto admitted = [&] { return queue_.front() == ticket && in_use_ + bytes <= capacity_; };
+    if (deadline) {
+        if (!changed_.wait_until(lock, *deadline, admitted)) {
+            queue_.erase(std::ranges::find(queue_, ticket));
+            changed_.notify_all(); // the caller behind us may now be at the front
+            return std::nullopt;
+        }
+    } else {
+        changed_.wait(lock, admitted);
+    }
+
+    queue_.pop_front();
+    in_use_ += bytes;
+    changed_.notify_all(); // the next caller may fit as well
+    return reservation(this, bytes);
+}
+
+std::uint64_t memory_budget::in_use() const {
+    std::lock_guard lock(mutex_);
+    return in_use_;
+}
+
+void memory_budget::release(std::uint64_t bytes) noexcept {
+    {
+        std::lock_guard lock(mutex_);
+        in_use_ -= bytes;
+    }
+    changed_.notify_all();
+}
+
+} // namespace dp
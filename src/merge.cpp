@@ -0,0 +1,210 @@
+#include "datapak/merge.hpp"
+#include "datapak/delta.hpp"
+#include "datapak/hash.hpp"
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dp {
+
+namespace {
+
+/**
+ * @brief An entry of one of the inputs
+ */
+struct source_entry {
+    std::size_t input;   /**< Index into the inputs */
+    std::uint32_t entry; /**< Entry index within that input */
+};
+
+/**
+ * @brief Find a path in the inputs ranked below a given input, honouring tombstones
+ */
+std::optional<source_entry> find_below(std::span<const std::shared_ptr<const archive>> inputs,
+                                       std::size_t above, std::string_view path) {
+    for (std::size_t k = above; k-- > 0;) {
+        if (const auto entry = inputs[k]->find(path)) {
+            return source_entry{k, *entry};
+        }
+        if (inputs[k]->has_tombstone(path)) {
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Decode an entry, resolving delta bases in lower-precedence inputs
+ */
+std::expected<std::vector<std::byte>, builder_error>
+read_contents(std::span<const std::shared_ptr<const archive>> inputs, source_entry source) {
+    const auto& input = *inputs[source.input];
+    const auto info = input.stat_entry(source.entry);
+    auto raw = input.read_raw_entry(source.entry, io_mode::buffered);
+    if (!info || !raw) {
+        return std::unexpected{builder_error::file_not_found};
+    }
+
+    if (info->compression != compression_method::delta) {
+        auto data = input.decode_entry(source.entry, std::move(*raw));
+        if (!data) {
+            return std::unexpected{builder_error::compression_error};
+        }
+        return std::move(*data);
+    }
+
+    const auto reference = read_delta_reference(*raw);
+    const auto base = reference ? find_below(inputs, source.input, reference->base_path) : std::nullopt;
+    if (!base) {
+        return std::unexpected{builder_error::file_not_found};
+    }
+
+    const auto base_info = inputs[base->input]->stat_entry(base->entry);
+    if (!base_info || !delta_base_matches(*reference, base_info->size, base_info->metadata)) {
+        return std::unexpected{builder_error::compression_error};
+    }
+
+    auto base_data = read_contents(inputs, *base);
+    if (!base_data) {
+        return std::unexpected{base_data.error()};
+    }
+
+    // Without stored metadata only the size was compared above
+    if (!base_info->metadata && content_hash(*base_data) != reference->base_checksum) {
+        return std::unexpected{builder_error::compression_error};
+    }
+
+    vfstream base_stream(std::move(*base_data));
+    auto target = apply_delta(*raw, base_stream, info->size);
+    if (!target) {
+        return std::unexpected{builder_error::compression_error};
+    }
+    return std::move(*target);
+}
+
+/**
+ * @brief Read the base reference of a delta entry from the start of its blob
+ */
+std::optional<delta_reference> peek_delta_reference(const archive& input, std::uint32_t entry) {
+    const auto info = input.stat_entry(entry);
+    if (!info) {
+        return std::nullopt;
+    }
+
+    // The header and base path come first; the instructions are not needed
+    std::vector<std::byte> prefix(
+        static_cast<std::size_t>(std::min<std::uint64_t>(info->compressed_size, sizeof(delta_header) + MAX_PATH_LENGTH)));
+    if (!input.read_raw_range(entry, 0, prefix)) {
+        return std::nullopt;
+    }
+    return read_delta_reference(prefix);
+}
+
+} // namespace
+
+std::expected<merge_stats, builder_error>
+merge(std::span<const std::shared_ptr<const archive>> inputs, const std::filesystem::path& output_path) {
+    for (const auto& input : inputs) {
+        std::error_code ec;
+        if (std::filesystem::equivalent(output_path, input->path(), ec)) {
+            return std::unexpected{builder_error::invalid_path};
+        }
+    }
+
+    // Resolve every path to its highest-precedence source, in first-seen order
+    struct slot {
+        std::string path;
+        std::optional<source_entry> source; /**< Empty once deleted by a tombstone */
+    };
+    std::vector<slot> slots;
+    std::unordered_map<std::string, std::size_t> live;
+    merge_stats stats;
+
+    for (std::size_t k = 0; k < inputs.size(); ++k) {
+        for (const auto& tombstone : inputs[k]->tombstones()) {
+            if (const auto it = live.find(tombstone); it != live.end()) {
+                slots[it->second].source.reset();
+                live.erase(it);
+                ++stats.shadowed;
+            }
+        }
+
+        const auto files = inputs[k]->list_files();
+        for (std::uint32_t j = 0; j < files.size(); ++j) {
+            const source_entry source{k, j};
+            if (const auto it = live.find(files[j]); it != live.end()) {
+                slots[it->second].source = source;
+                ++stats.shadowed;
+            } else {
+                live.emplace(files[j], slots.size());
+                slots.push_back({files[j], source});
+            }
+        }
+    }
+
+    archive_builder builder;
+    bool all_checksums = true;
+
+    for (const auto& entry : slots) {
+        if (!entry.source) {
+            continue;
+        }
+
+        const auto source = *entry.source;
+        const auto info = inputs[source.input]->stat_entry(source.entry);
+        if (!info) {
+            return std::unexpected{builder_error::file_not_found};
+        }
+
+        // Deltas against a base outside the inputs stay valid as they are
+        bool materialize = info->compression == compression_method::chunked;
+        if (info->compression == compression_method::delta) {
+            const auto reference = peek_delta_reference(*inputs[source.input], source.entry);
+            materialize = reference && find_below(inputs, source.input, reference->base_path);
+        }
+
+        if (materialize) {
+            ++stats.materialized;
+            builder.add_encoded(entry.path, compression_method::deflate, [inputs, source]()
+                -> std::expected<encoded_blob, builder_error> {
+                auto data = read_contents(inputs, source);
+                if (!data) {
+                    return std::unexpected{data.error()};
+                }
+                auto encoded = compression_engine::compress(*data, compression_method::deflate);
+                if (!encoded) {
+                    return std::unexpected{builder_error::compression_error};
+                }
+                return encoded_blob{std::move(*encoded), data->size(), content_hash(*data)};
+            });
+            continue;
+        }
+
+        ++stats.copied;
+        all_checksums = all_checksums && info->metadata.has_value();
+        builder.add_copy(entry.path, inputs[source.input], source.entry);
+    }
+
+    // Metadata is all or nothing, so drop it if any copied entry lacks a checksum
+    builder.set_entry_metadata(all_checksums);
+
+    std::unordered_set<std::string> tombstones;
+    for (const auto& input : inputs) {
+        for (const auto& tombstone : input->tombstones()) {
+            if (!live.contains(tombstone) && tombstones.insert(tombstone).second) {
+                builder.add_tombstone(tombstone);
+            }
+        }
+    }
+
+    if (auto built = builder.build(output_path); !built) {
+        return std::unexpected{built.error()};
+    }
+
+    return stats;
+}
+
+} // namespace dp
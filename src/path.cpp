@@ -0,0 +1,80 @@
+#include "datapak/path.hpp"
+#include <algorithm>
+
+namespace dp {
+
+std::optional<std::string_view>
+normalize_path(std::string_view path, std::span<char> buffer, bool fold_case) noexcept {
+    std::size_t length = 0;
+    std::size_t pos = 0;
+
+    while (pos < path.size()) {
+        const auto separator = path.find_first_of("/\\", pos);
+        const auto end = separator == std::string_view::npos ? path.size() : separator;
+        const auto segment = path.substr(pos, end - pos);
+        pos = end + 1;
+
+        if (segment.empty() || segment == ".") {
+            continue;
+        }
+
+        if (segment == "..") {
+            if (length == 0) {
+                return std::nullopt;
+            }
+            const auto parent = std::string_view(buffer.data(), length).rfind('/');
+            length = parent == std::string_view::npos ? 0 : parent;
+            continue;
+        }
+
+        const std::size_t needed = segment.size() + (length > 0 ? 1 : 0);
+        if (buffer.size() - length < needed) {
+            return std::nullopt;
+        }
+
+        if (length > 0) {
+            buffer[length++] = '/';
+        }
+
+        if (fold_case) {
+            std::ranges::transform(segment, buffer.data() + length, [](char c) {
+                return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+            });
+        } else {
+            std::ranges::copy(segment, buffer.data() + length);
+        }
+        length += segment.size();
+    }
+
+    return std::string_view(buffer.data(), length);
+}
+
+bool match_glob(std::string_view pattern, std::string_view path) noexcept {
+    // Greedy matching that backtracks only to the most recent '*'
+    std::size_t p = 0;
+    std::size_t s = 0;
+    std::size_t star = std::string_view::npos;
+    std::size_t star_match = 0;
+
+    while (s < path.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == path[s])) {
+            ++p;
+            ++s;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_match = s;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            s = ++star_match;
+        } else {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+} // namespace dp
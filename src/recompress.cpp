@@ -0,0 +1,173 @@
+#include "datapak/recompress.hpp"
+#include "datapak/hash.hpp"
+#include "datapak/path.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace dp {
+
+namespace {
+
+/**
+ * @brief Runs jobs on worker threads and hands the results out in index order
+ *
+ * Workers stay at most window results ahead of the consumer, which bounds
+ * the memory held by finished but not yet written blobs.
+ */
+class ordered_pipeline {
+public:
+    using result = std::expected<encoded_blob, builder_error>;
+    using job = std::function<result(std::uint32_t)>;
+
+    ordered_pipeline(std::uint32_t count, unsigned threads, job work)
+        : count_(count), window_(std::size_t{threads} * 4), work_(std::move(work)) {
+        for (unsigned i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { run(); });
+        }
+    }
+
+    ~ordered_pipeline() {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+        }
+        space_.notify_all();
+    }
+
+    ordered_pipeline(const ordered_pipeline&) = delete;
+    ordered_pipeline& operator=(const ordered_pipeline&) = delete;
+
+    /**
+     * @brief Wait for the result of a job; must be called in index order
+     */
+    result take(std::uint32_t index) {
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [&] { return done_.contains(index); });
+
+        auto node = done_.extract(index);
+        taken_ = index + 1;
+        space_.notify_all();
+        return std::move(node.mapped());
+    }
+
+private:
+    void run() {
+        while (true) {
+            std::uint32_t index = 0;
+            {
+                std::unique_lock lock(mutex_);
+                space_.wait(lock, [&] { return stopping_ || next_ >= count_ || next_ < taken_ + window_; });
+                if (stopping_ || next_ >= count_) {
+                    return;
+                }
+                index = next_++;
+            }
+
+            auto output = work_(index);
+
+            {
+                std::lock_guard lock(mutex_);
+                done_.emplace(index, std::move(output));
+            }
+            ready_.notify_all();
+        }
+    }
+
+    std::uint32_t count_;
+    std::size_t window_;
+    job work_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::condition_variable space_;
+    std::uint32_t next_ = 0;
+    std::size_t taken_ = 0;
+    bool stopping_ = false;
+    std::map<std::uint32_t, result> done_;
+    std::vector<std::jthread> workers_; // last, so workers stop before the state they use
+};
+
+} // namespace
+
+std::expected<recompress_stats, builder_error>
+recompress(const archive& input, const std::filesystem::path& output_path,
+           const recompress_options& options) {
+    std::error_code ec;
+    if (std::filesystem::equivalent(output_path, input.path(), ec)) {
+        return std::unexpected{builder_error::invalid_path};
+    }
+
+    const auto files = input.list_files();
+    const auto count = static_cast<std::uint32_t>(files.size());
+
+    std::vector<file_stat> stats;
+    std::vector<bool> selected(count);
+    stats.reserve(count);
+    recompress_stats result;
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const auto info = input.stat_entry(i);
+        if (!info) {
+            return std::unexpected{builder_error::file_not_found};
+        }
+        stats.push_back(*info);
+
+        const bool matches = options.filters.empty() ||
+            std::ranges::any_of(options.filters, [&](const std::string& filter) {
+                return match_glob(filter, files[i]);
+            });
+        selected[i] = info->compression == compression_method::chunked ||
+                      (matches && info->compression != compression_method::delta);
+        ++(selected[i] ? result.recompressed : result.copied);
+    }
+
+    const auto work = [&](std::uint32_t i) -> ordered_pipeline::result {
+        auto raw = input.read_raw_entry(i, io_mode::buffered);
+        if (!raw) {
+            return std::unexpected{builder_error::file_not_found};
+        }
+
+        const auto& info = stats[i];
+        const std::uint64_t checksum = info.metadata ? info.metadata->checksum : 0;
+        if (!selected[i]) {
+            return encoded_blob{std::move(*raw), info.size, checksum};
+        }
+
+        auto data = input.decode_entry(i, std::move(*raw));
+        if (!data) {
+            return std::unexpected{builder_error::compression_error};
+        }
+
+        auto encoded = compression_engine::compress(*data, options.compression, options.level);
+        if (!encoded) {
+            return std::unexpected{builder_error::compression_error};
+        }
+        return encoded_blob{std::move(*encoded), data->size(), content_hash(*data)};
+    };
+
+    const unsigned threads = options.threads != 0 ? options.threads
+                                                  : std::max(1u, std::thread::hardware_concurrency());
+    ordered_pipeline pipeline(count, threads, work);
+
+    archive_builder builder(options.compression);
+    builder.set_entry_metadata(count > 0 && stats.front().metadata.has_value());
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const auto method = selected[i] ? options.compression : stats[i].compression;
+        builder.add_encoded(files[i], method, [&pipeline, i] { return pipeline.take(i); });
+    }
+    for (const auto& tombstone : input.tombstones()) {
+        builder.add_tombstone(tombstone);
+    }
+
+    if (auto built = builder.build(output_path); !built) {
+        return std::unexpected{built.error()};
+    }
+
+    return result;
+}
+
+} // namespace dp
@@ -1,120 +1,498 @@
 #include "datapak/vfs.hpp"
+#include "datapak/delta.hpp"
 #include <algorithm>
+#include <optional>
+#include <unordered_set>
 
 namespace dp {
 
 std::expected<void, vfs_error>
 vfs::mount(const std::filesystem::path& archive_path, access_mode mode) {
     try {
-        auto arch = std::make_unique<archive>(archive_path, mode);
-        archives_.push_back(std::move(arch));
+        auto arch = std::make_shared<archive>(archive_path, mode, resource_);
+        arch->set_lookup_mode(lookup_mode_);
+        arch->set_direct_io_threshold(direct_io_threshold_);
+        archives_.push_back({next_mount_id_++, std::move(arch)});
+        cache_.clear(); // the new archive may shadow cached files
         return {};
     } catch (const std::exception&) {
         return std::unexpected{vfs_error::archive_error};
     }
 }
 
+bool vfs::unmount(const std::filesystem::path& archive_path) {
+    const auto it = std::ranges::find_if(archives_, [&](const mounted_archive& mounted) {
+        return mounted.arch->path() == archive_path;
+    });
+
+    if (it == archives_.end()) {
+        return false;
+    }
+
+    archives_.erase(it);
+    cache_.clear();
+    return true;
+}
+
+std::expected<file_id, vfs_error> vfs::resolve(std::string_view filename) const {
+    // Hash once instead of once per mounted archive
+    return resolve(path_key{filename});
+}
+
+std::expected<file_id, vfs_error> vfs::resolve(const path_key& key) const {
+    return resolve_below(key, nullptr);
+}
+
+std::expected<file_id, vfs_error>
+vfs::resolve_below(const path_key& key, const mounted_archive* above) const {
+    // Rank archives by precedence: reverse order searches from the most
+    // recently mounted to the first, mount order the other way around
+    const bool reverse = search_order_ == search_order::reverse_mount_order;
+    const std::size_t count = archives_.size();
+
+    std::size_t rank = 0;
+    if (above != nullptr) {
+        const auto position = static_cast<std::size_t>(above - archives_.data());
+        rank = reverse ? count - position : position + 1;
+    }
+
+    for (; rank < count; ++rank) {
+        const auto& mounted = archives_[reverse ? count - 1 - rank : rank];
+        if (const auto entry = mounted.arch->find(key)) {
+            return file_id{mounted.id, *entry};
+        }
+
+        // A tombstone hides the path in every archive of lower precedence
+        if (mounted.arch->has_tombstone(key.path)) {
+            break;
+        }
+    }
+
+    return std::unexpected{vfs_error::file_not_found};
+}
+
+const vfs::mounted_archive* vfs::find_mount(file_id id) const {
+    // Mount identifiers increase monotonically, so archives_ is sorted by id
+    const auto it = std::ranges::lower_bound(archives_, id.mount, {}, &mounted_archive::id);
+    if (it == archives_.end() || it->id != id.mount) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::shared_ptr<const archive> vfs::get_archive(file_id id) const {
+    const auto* mounted = find_mount(id);
+    return mounted ? mounted->arch : nullptr;
+}
+
 std::expected<std::unique_ptr<vfstream>, vfs_error>
 vfs::open(std::string_view filename) {
-    const std::string filename_str{filename};
-
     if (cache_enabled_) {
-        const auto cache_it = cache_.find(filename_str);
+        const auto cache_it = cache_.find(filename);
         if (cache_it != cache_.end()) {
-            return std::make_unique<vfstream>(cache_it->second);
+            return std::make_unique<vfstream>(std::pmr::vector<std::byte>(cache_it->second, resource_));
         }
     }
 
-    // Search archives in the specified order
-    if (search_order_ == search_order::reverse_mount_order) {
-        // Search from most recently mounted to first mounted
-        for (auto it = archives_.rbegin(); it != archives_.rend(); ++it) {
-            const auto& arch = *it;
-            if (arch->contains(filename)) {
-                auto result = arch->open(filename);
-                if (result) {
-                    if (cache_enabled_) {
-                        auto stream = result.value().get();
-                        std::vector<std::byte> data;
-
-                        stream->seekg(0, std::ios::end);
-                        const auto size = stream->tellg();
-                        stream->seekg(0, std::ios::beg);
-
-                        data.resize(size);
-                        stream->read(reinterpret_cast<char*>(data.data()), size);
-
-                        cache_[filename_str] = data;
-                        stream->seekg(0, std::ios::beg);
-                    }
-                    return std::move(*result);
-                }
-            }
+    const auto id = resolve(filename);
+    if (!id) {
+        return std::unexpected{id.error()};
+    }
+
+    auto result = open(*id);
+    if (!result) {
+        return std::unexpected{result.error()};
+    }
+
+    // A cached copy would outlive any reservation, so budgeted opens skip the cache
+    if (cache_enabled_ && !decompression_budget_) {
+        auto stream = result.value().get();
+        std::pmr::vector<std::byte> data(resource_);
+
+        stream->seekg(0, std::ios::end);
+        const auto size = stream->tellg();
+        stream->seekg(0, std::ios::beg);
+
+        data.resize(size);
+        stream->read(reinterpret_cast<char*>(data.data()), size);
+
+        cache_.insert_or_assign(std::pmr::string(filename, resource_), std::move(data));
+        stream->seekg(0, std::ios::beg);
+    }
+
+    return std::move(*result);
+}
+
+std::expected<std::unique_ptr<vfstream>, vfs_error>
+vfs::open(file_id id) const {
+    const auto* mounted = find_mount(id);
+    if (!mounted) {
+        return std::unexpected{vfs_error::invalid_handle};
+    }
+
+    const auto info = mounted->arch->stat_entry(id.entry);
+    if (info && info->compression == compression_method::delta) {
+        auto data = read(id);
+        if (!data) {
+            return std::unexpected{data.error()};
+        }
+
+        // Charged only once the base is released, so nested opens cannot deadlock
+        auto reservation = reserve_bytes(info->size);
+        if (!reservation) {
+            return std::unexpected{reservation.error()};
+        }
+
+        auto stream = std::make_unique<vfstream>(std::pmr::vector<std::byte>(data->begin(), data->end(), resource_));
+        retain_reservation(*stream, std::move(*reservation));
+        return stream;
+    }
+
+    if (!info) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    auto reservation = reserve_decompression(*info, false);
+    if (!reservation) {
+        return std::unexpected{reservation.error()};
+    }
+
+    auto result = mounted->arch->open_entry(id.entry);
+    if (!result) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    // The compressed input is gone; the decoded buffer counts until the stream is destroyed
+    if (*reservation) {
+        (*reservation)->shrink_to(info->size);
+        retain_reservation(**result, std::move(*reservation));
+    }
+    return std::move(*result);
+}
+
+std::expected<std::unique_ptr<vfstream>, vfs_error>
+vfs::open_sequential(std::string_view filename, std::size_t window_size) const {
+    const auto id = resolve(filename);
+    if (!id) {
+        return std::unexpected{id.error()};
+    }
+
+    return open_sequential(*id, window_size);
+}
+
+std::expected<std::unique_ptr<vfstream>, vfs_error>
+vfs::open_sequential(file_id id, std::size_t window_size) const {
+    const auto* mounted = find_mount(id);
+    if (!mounted) {
+        return std::unexpected{vfs_error::invalid_handle};
+    }
+
+    // Deltas need the vfs to find their base; chunked entries are assembled up front
+    const auto info = mounted->arch->stat_entry(id.entry);
+    if (info && info->compression != compression_method::none && info->compression != compression_method::deflate) {
+        return open(id);
+    }
+
+    auto result = mounted->arch->open_sequential_entry(id.entry, window_size);
+    if (!result) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    return std::move(*result);
+}
+
+std::expected<std::vector<std::byte>, vfs_error> vfs::read(file_id id) const {
+    const auto* mounted = find_mount(id);
+    if (!mounted) {
+        return std::unexpected{vfs_error::invalid_handle};
+    }
+
+    const auto info = mounted->arch->stat_entry(id.entry);
+    if (!info) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    const auto reservation = reserve_decompression(*info, false);
+    if (!reservation) {
+        return std::unexpected{reservation.error()};
+    }
+
+    auto raw = mounted->arch->read_raw_entry(id.entry);
+    if (!raw) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    if (info->compression != compression_method::delta) {
+        auto data = mounted->arch->decode_entry(id.entry, std::move(*raw));
+        if (!data) {
+            return std::unexpected{vfs_error::archive_error};
+        }
+        return std::move(*data);
+    }
+
+    // The base may itself be a delta further down; open() recurses through read()
+    const auto reference = read_delta_reference(*raw);
+    if (!reference) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    const auto base_id = resolve_below(path_key{reference->base_path}, mounted);
+    if (!base_id) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    const auto base_info = stat(*base_id);
+    if (!base_info || !delta_base_matches(*reference, base_info->size, base_info->metadata)) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    std::unique_ptr<vfstream> base;
+    if (base_info->metadata) {
+        auto opened = open(*base_id);
+        if (!opened) {
+            return std::unexpected{opened.error()};
         }
+        base = std::move(*opened);
     } else {
-        // Search from first mounted to most recently mounted
-        for (const auto& arch : archives_) {
-            if (arch->contains(filename)) {
-                auto result = arch->open(filename);
-                if (result) {
-                    if (cache_enabled_) {
-                        auto stream = result.value().get();
-                        std::vector<std::byte> data;
-
-                        stream->seekg(0, std::ios::end);
-                        const auto size = stream->tellg();
-                        stream->seekg(0, std::ios::beg);
-
-                        data.resize(size);
-                        stream->read(reinterpret_cast<char*>(data.data()), size);
-
-                        cache_[filename_str] = data;
-                        stream->seekg(0, std::ios::beg);
-                    }
-                    return std::move(*result);
-                }
-            }
+        // Without stored metadata only the size was compared, so the
+        // decoded base is hashed before the delta is applied to it
+        auto base_data = read(*base_id);
+        if (!base_data) {
+            return std::unexpected{base_data.error()};
         }
+        if (content_hash(*base_data) != reference->base_checksum) {
+            return std::unexpected{vfs_error::archive_error};
+        }
+        base = std::make_unique<vfstream>(std::move(*base_data));
     }
 
-    return std::unexpected{vfs_error::file_not_found};
+    auto target = apply_delta(*raw, *base, info->size);
+    if (!target) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+    return std::move(*target);
 }
 
-bool vfs::contains(std::string_view filename) const {
-    if (cache_enabled_ && cache_.contains(std::string{filename})) {
-        return true;
+std::vector<std::expected<std::vector<std::byte>, vfs_error>> vfs::read(std::span<const file_id> ids) const {
+    std::vector<std::expected<std::vector<std::byte>, vfs_error>> results(
+        ids.size(), std::unexpected{vfs_error::invalid_handle});
+
+    // Positions in ids read in bulk, per mounted archive
+    std::vector<std::vector<std::size_t>> batches(archives_.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        const auto* mounted = find_mount(ids[i]);
+        if (!mounted) {
+            continue;
+        }
+
+        // Deltas resolve their base through the vfs; budgets are charged per entry
+        const auto info = mounted->arch->stat_entry(ids[i].entry);
+        if (!info || info->compression == compression_method::delta || decompression_budget_) {
+            results[i] = read(ids[i]);
+            continue;
+        }
+        batches[static_cast<std::size_t>(mounted - archives_.data())].push_back(i);
     }
 
-    // Check archives in the specified search order
-    if (search_order_ == search_order::reverse_mount_order) {
-        for (auto it = archives_.rbegin(); it != archives_.rend(); ++it) {
-            if ((*it)->contains(filename)) {
-                return true;
+    for (std::size_t m = 0; m < archives_.size(); ++m) {
+        if (batches[m].empty()) {
+            continue;
+        }
+
+        std::vector<std::uint32_t> indices;
+        indices.reserve(batches[m].size());
+        for (const auto i : batches[m]) {
+            indices.push_back(ids[i].entry);
+        }
+
+        auto raw = archives_[m].arch->read_raw_entries(indices);
+        for (std::size_t k = 0; k < indices.size(); ++k) {
+            auto data = raw[k] ? archives_[m].arch->decode_entry(indices[k], std::move(*raw[k]))
+                               : std::unexpected{raw[k].error()};
+            if (data) {
+                results[batches[m][k]] = std::move(*data);
+            } else {
+                results[batches[m][k]] = std::unexpected{vfs_error::archive_error};
             }
         }
-    } else {
-        for (const auto& arch : archives_) {
-            if (arch->contains(filename)) {
-                return true;
+    }
+
+    return results;
+}
+
+std::expected<std::size_t, vfs_error> vfs::read(std::string_view filename, std::span<std::byte> out) const {
+    if (cache_enabled_) {
+        const auto cache_it = cache_.find(filename);
+        if (cache_it != cache_.end()) {
+            if (cache_it->second.size() > out.size()) {
+                return std::unexpected{vfs_error::buffer_too_small};
             }
+            std::ranges::copy(cache_it->second, out.begin());
+            return cache_it->second.size();
         }
     }
 
-    return false;
+    const auto id = resolve(filename);
+    if (!id) {
+        return std::unexpected{id.error()};
+    }
+
+    return read(*id, out);
+}
+
+std::expected<std::size_t, vfs_error> vfs::read(file_id id, std::span<std::byte> out) const {
+    const auto* mounted = find_mount(id);
+    if (!mounted) {
+        return std::unexpected{vfs_error::invalid_handle};
+    }
+
+    const auto info = mounted->arch->stat_entry(id.entry);
+    if (!info) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+    if (info->size > out.size()) {
+        return std::unexpected{vfs_error::buffer_too_small};
+    }
+
+    // Deltas resolve their base through the vfs, so they go through read(id)
+    if (info->compression == compression_method::delta) {
+        auto data = read(id);
+        if (!data) {
+            return std::unexpected{data.error()};
+        }
+        if (data->size() > out.size()) {
+            return std::unexpected{vfs_error::buffer_too_small};
+        }
+        std::ranges::copy(*data, out.begin());
+        return data->size();
+    }
+
+    const auto reservation = reserve_decompression(*info, true);
+    if (!reservation) {
+        return std::unexpected{reservation.error()};
+    }
+
+    const auto written = mounted->arch->read_entry(id.entry, out);
+    if (!written) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+    return *written;
+}
+
+std::expected<file_stat, vfs_error> vfs::stat(std::string_view filename) const {
+    const auto id = resolve(filename);
+    if (!id) {
+        return std::unexpected{id.error()};
+    }
+
+    return stat(*id);
+}
+
+std::expected<file_stat, vfs_error> vfs::stat(file_id id) const {
+    const auto* mounted = find_mount(id);
+    if (!mounted) {
+        return std::unexpected{vfs_error::invalid_handle};
+    }
+
+    auto result = mounted->arch->stat_entry(id.entry);
+    if (!result) {
+        return std::unexpected{vfs_error::archive_error};
+    }
+
+    return *result;
+}
+
+bool vfs::contains(std::string_view filename) const {
+    if (cache_enabled_ && cache_.contains(filename)) {
+        return true;
+    }
+
+    return resolve(filename).has_value();
+}
+
+void vfs::set_lookup_mode(lookup_mode mode) {
+    lookup_mode_ = mode;
+    for (const auto& mounted : archives_) {
+        mounted.arch->set_lookup_mode(mode);
+    }
+    cache_.clear(); // cached request paths may resolve differently now
+}
+
+void vfs::set_direct_io_threshold(std::uint64_t bytes) {
+    direct_io_threshold_ = bytes;
+    for (const auto& mounted : archives_) {
+        mounted.arch->set_direct_io_threshold(bytes);
+    }
+}
+
+void vfs::set_decompression_budget(std::uint64_t bytes) {
+    decompression_budget_ = bytes ? std::make_shared<memory_budget>(bytes) : nullptr;
+}
+
+std::expected<std::optional<memory_budget::reservation>, vfs_error>
+vfs::reserve_decompression(const file_stat& info, bool into_caller_buffer) const {
+    // Stored entries are streamed or copied, and deltas reserve through their base
+    if (info.compression == compression_method::none || info.compression == compression_method::delta) {
+        return std::nullopt;
+    }
+
+    return reserve_bytes(info.compressed_size + (into_caller_buffer ? 0 : info.size));
+}
+
+std::expected<std::optional<memory_budget::reservation>, vfs_error>
+vfs::reserve_bytes(std::uint64_t bytes) const {
+    if (!decompression_budget_) {
+        return std::nullopt;
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if (decompression_timeout_) {
+        deadline = std::chrono::steady_clock::now() + *decompression_timeout_;
+    }
+
+    auto reservation = decompression_budget_->acquire(bytes, deadline);
+    if (!reservation) {
+        return std::unexpected{vfs_error::budget_exhausted};
+    }
+    return reservation;
+}
+
+void vfs::retain_reservation(vfstream& stream, std::optional<memory_budget::reservation> reservation) const {
+    if (!reservation) {
+        return;
+    }
+
+    // The stream keeps the budget alive too, so it may outlive the vfs or a budget change
+    struct held_reservation {
+        std::shared_ptr<memory_budget> budget;
+        memory_budget::reservation reservation;
+    };
+    stream.retain(std::make_shared<held_reservation>(decompression_budget_, std::move(*reservation)));
 }
 
 std::vector<std::string> vfs::list_files() const {
     std::vector<std::string> all_files;
+    std::unordered_set<std::string> hidden;
 
-    for (const auto& arch : archives_) {
-        const auto arch_files = arch->list_files();
-        all_files.insert(all_files.end(), arch_files.begin(), arch_files.end());
+    // Walk in precedence order so tombstones hide only lower-precedence files
+    const auto collect = [&](const mounted_archive& mounted) {
+        for (auto& file : mounted.arch->list_files()) {
+            if (hidden.insert(file).second) {
+                all_files.push_back(std::move(file));
+            }
+        }
+        hidden.insert(mounted.arch->tombstones().begin(), mounted.arch->tombstones().end());
+    };
+
+    if (search_order_ == search_order::reverse_mount_order) {
+        std::for_each(archives_.rbegin(), archives_.rend(), collect);
+    } else {
+        std::ranges::for_each(archives_, collect);
     }
 
     std::ranges::sort(all_files);
-    all_files.erase(std::ranges::unique(all_files).begin(), all_files.end());
 
     return all_files;
 }
 
-} // namespace dp
\ No newline at end of file
+} // namespace dp
@@ -1,5 +1,8 @@
 #include "datapak/vfstream.hpp"
+#include "datapak/file_handle.hpp"
 #include <algorithm>
+#include <cstring>
+#include <span>
 
 namespace dp {
 
@@ -10,6 +13,13 @@ vfstreambuf::vfstreambuf(std::vector<std::byte> data)
     setg(begin, begin, end);
 }
 
+vfstreambuf::vfstreambuf(std::pmr::vector<std::byte> data)
+    : pmr_data_(std::move(data)), position_(0) {
+    char* begin = reinterpret_cast<char*>(pmr_data_.data());
+    char* end = begin + pmr_data_.size();
+    setg(begin, begin, end);
+}
+
 std::streambuf::int_type vfstreambuf::underflow() {
     if (gptr() < egptr()) {
         return traits_type::to_int_type(*gptr());
@@ -44,13 +54,13 @@ std::streambuf::pos_type vfstreambuf::seekoff(off_type off, std::ios_base::seekd
         new_pos = (gptr() - eback()) + off;
         break;
     case std::ios_base::end:
-        new_pos = static_cast<off_type>(data_.size()) + off;
+        new_pos = static_cast<off_type>(egptr() - eback()) + off;
         break;
     default:
         return pos_type(off_type(-1));
     }
 
-    if (new_pos < 0 || new_pos > static_cast<off_type>(data_.size())) {
+    if (new_pos < 0 || new_pos > static_cast<off_type>(egptr() - eback())) {
         return pos_type(off_type(-1));
     }
 
@@ -64,9 +74,254 @@ std::streambuf::pos_type vfstreambuf::seekpos(pos_type sp, std::ios_base::openmo
     return seekoff(off_type(sp), std::ios_base::beg, which);
 }
 
+range_streambuf::range_streambuf(std::shared_ptr<const file_handle> file, std::uint64_t offset,
+                                 std::uint64_t size, bool direct, std::size_t buffer_size)
+    : file_(std::move(file)), offset_(offset), size_(size), direct_(direct) {
+    // Never allocate more than the range can fill
+    buffer_.resize(static_cast<std::size_t>(std::min<std::uint64_t>(std::max<std::size_t>(buffer_size, 1), size)));
+    setg(buffer_.data(), buffer_.data(), buffer_.data());
+}
+
+std::uint64_t range_streambuf::position() const {
+    return buffer_start_ + static_cast<std::uint64_t>(gptr() - eback());
+}
+
+bool range_streambuf::read(std::uint64_t position, char* out, std::size_t count) const {
+    const std::span<std::byte> target(reinterpret_cast<std::byte*>(out), count);
+    return direct_ ? file_->read_at_direct(offset_ + position, target)
+                   : file_->read_at(offset_ + position, target);
+}
+
+std::streambuf::int_type range_streambuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    const std::uint64_t pos = position();
+    if (pos >= size_) {
+        return traits_type::eof();
+    }
+
+    const auto count = static_cast<std::size_t>(std::min<std::uint64_t>(buffer_.size(), size_ - pos));
+    if (!read(pos, buffer_.data(), count)) {
+        return traits_type::eof();
+    }
+
+    buffer_start_ = pos;
+    setg(buffer_.data(), buffer_.data(), buffer_.data() + count);
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize range_streambuf::xsgetn(char_type* s, std::streamsize count) {
+    std::streamsize copied = 0;
+
+    // Drain whatever is already buffered
+    const std::streamsize buffered = std::min<std::streamsize>(count, egptr() - gptr());
+    if (buffered > 0) {
+        std::copy_n(gptr(), buffered, s);
+        gbump(static_cast<int>(buffered));
+        copied = buffered;
+    }
+
+    const std::uint64_t pos = position();
+    const auto wanted = std::min<std::uint64_t>(static_cast<std::uint64_t>(count - copied), size_ - pos);
+    if (wanted == 0) {
+        return copied;
+    }
+
+    // Large remainders skip the buffer and land directly in the caller's memory
+    if (wanted >= buffer_.size()) {
+        if (!read(pos, s + copied, static_cast<std::size_t>(wanted))) {
+            return copied;
+        }
+        buffer_start_ = pos + wanted;
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+        return copied + static_cast<std::streamsize>(wanted);
+    }
+
+    if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+        return copied;
+    }
+
+    const auto tail = static_cast<std::streamsize>(wanted);
+    std::copy_n(gptr(), tail, s + copied);
+    gbump(static_cast<int>(tail));
+    return copied + tail;
+}
+
+std::streamsize range_streambuf::showmanyc() {
+    const std::uint64_t pos = position();
+    return pos < size_ ? static_cast<std::streamsize>(size_ - pos) : -1;
+}
+
+std::streambuf::pos_type range_streambuf::seekoff(off_type off, std::ios_base::seekdir way,
+                                                  std::ios_base::openmode which) {
+    if (which != std::ios_base::in) {
+        return pos_type(off_type(-1));
+    }
+
+    off_type new_pos;
+    switch (way) {
+    case std::ios_base::beg:
+        new_pos = off;
+        break;
+    case std::ios_base::cur:
+        new_pos = static_cast<off_type>(position()) + off;
+        break;
+    case std::ios_base::end:
+        new_pos = static_cast<off_type>(size_) + off;
+        break;
+    default:
+        return pos_type(off_type(-1));
+    }
+
+    if (new_pos < 0 || new_pos > static_cast<off_type>(size_)) {
+        return pos_type(off_type(-1));
+    }
+
+    // Keep the buffer when the target is inside it; otherwise refill lazily
+    const auto target = static_cast<std::uint64_t>(new_pos);
+    const auto buffered = static_cast<std::uint64_t>(egptr() - eback());
+    if (target >= buffer_start_ && target <= buffer_start_ + buffered) {
+        setg(eback(), eback() + (target - buffer_start_), egptr());
+    } else {
+        buffer_start_ = target;
+        setg(buffer_.data(), buffer_.data(), buffer_.data());
+    }
+
+    return pos_type(new_pos);
+}
+
+std::streambuf::pos_type range_streambuf::seekpos(pos_type sp, std::ios_base::openmode which) {
+    return seekoff(off_type(sp), std::ios_base::beg, which);
+}
+
+readahead_streambuf::readahead_streambuf(source_function source, std::uint64_t size, std::size_t window_size)
+    : source_(std::move(source)), size_(size) {
+    // Never allocate more than the stream can fill
+    const auto window = std::min<std::uint64_t>(std::max<std::size_t>(window_size, 1), std::max<std::uint64_t>(size, 1));
+    for (auto& buffer : windows_) {
+        buffer.resize(static_cast<std::size_t>(window));
+    }
+    producer_ = std::jthread([this](std::stop_token stop) { produce(std::move(stop)); });
+}
+
+void readahead_streambuf::produce(std::stop_token stop) {
+    std::uint64_t produced = 0;
+    for (std::size_t index = 0; produced < size_; index ^= 1) {
+        {
+            std::unique_lock lock(mutex_);
+            if (!changed_.wait(lock, stop, [this] { return full_ < windows_.size(); })) {
+                return;
+            }
+        }
+
+        // The reader only touches the other window, so fill this one unlocked
+        const auto length = static_cast<std::size_t>(std::min<std::uint64_t>(windows_[index].size(), size_ - produced));
+        std::optional<std::size_t> count;
+        try {
+            count = source_(std::as_writable_bytes(std::span(windows_[index]).first(length)));
+        } catch (...) {
+            count = std::nullopt;
+        }
+
+        // Ending before size_ is an error too: the entry is shorter than its directory says
+        std::lock_guard lock(mutex_);
+        if (!count || *count == 0) {
+            failed_ = true;
+            break;
+        }
+        filled_[index] = std::min(*count, length);
+        produced += filled_[index];
+        ++full_;
+        changed_.notify_all();
+    }
+
+    std::lock_guard lock(mutex_);
+    finished_ = true;
+    changed_.notify_all();
+}
+
+std::uint64_t readahead_streambuf::position() const {
+    return window_start_ + static_cast<std::uint64_t>(gptr() - eback());
+}
+
+std::streambuf::int_type readahead_streambuf::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::unique_lock lock(mutex_);
+    if (holding_) {
+        window_start_ += static_cast<std::uint64_t>(egptr() - eback());
+        setg(nullptr, nullptr, nullptr);
+        holding_ = false;
+        current_ ^= 1;
+        --full_;
+        changed_.notify_all();
+    }
+
+    changed_.wait(lock, [this] { return full_ > 0 || finished_; });
+    if (full_ == 0) {
+        if (failed_) {
+            throw std::ios_base::failure("datapak: read or decode error in readahead stream");
+        }
+        return traits_type::eof();
+    }
+
+    holding_ = true;
+    auto& window = windows_[current_];
+    setg(window.data(), window.data(), window.data() + filled_[current_]);
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize readahead_streambuf::showmanyc() {
+    const std::uint64_t pos = position();
+    return pos < size_ ? static_cast<std::streamsize>(size_ - pos) : -1;
+}
+
+std::streambuf::pos_type readahead_streambuf::seekoff(off_type off, std::ios_base::seekdir way,
+                                                      std::ios_base::openmode which) {
+    if (which != std::ios_base::in) {
+        return pos_type(off_type(-1));
+    }
+
+    const auto pos = static_cast<off_type>(position());
+    off_type target;
+    switch (way) {
+    case std::ios_base::beg:
+        target = off;
+        break;
+    case std::ios_base::cur:
+        target = pos + off;
+        break;
+    case std::ios_base::end:
+        target = static_cast<off_type>(size_) + off;
+        break;
+    default:
+        return pos_type(off_type(-1));
+    }
+
+    return target == pos ? pos_type(pos) : pos_type(off_type(-1));
+}
+
+std::streambuf::pos_type readahead_streambuf::seekpos(pos_type sp, std::ios_base::openmode which) {
+    return seekoff(off_type(sp), std::ios_base::beg, which);
+}
+
 vfstream::vfstream(std::vector<std::byte> data)
     : std::istream(nullptr), buffer_(std::make_unique<vfstreambuf>(std::move(data))) {
     rdbuf(buffer_.get());
 }
 
+vfstream::vfstream(std::pmr::vector<std::byte> data)
+    : std::istream(nullptr), buffer_(std::make_unique<vfstreambuf>(std::move(data))) {
+    rdbuf(buffer_.get());
+}
+
+vfstream::vfstream(std::unique_ptr<std::streambuf> buffer)
+    : std::istream(nullptr), buffer_(std::move(buffer)) {
+    rdbuf(buffer_.get());
+}
+
 } // namespace dp
\ No newline at end of file
@@ -1,8 +1,16 @@
 #include <gtest/gtest.h>
 #include <datapak/archive.hpp>
 #include <datapak/archive_builder.hpp>
+#include <datapak/file_handle.hpp>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <sstream>
+#include <thread>
+#include <atomic>
 
 class ArchiveTest : public ::testing::Test {
 protected:
@@ -246,4 +254,940 @@ TEST_F(ArchiveTest, CompressionMethods) {
     std::filesystem::remove(large_compressed_path);
     std::filesystem::remove(large_uncompressed_path);
     std::filesystem::remove_all(large_test_dir);
-}
\ No newline at end of file
+}
+
+TEST_F(ArchiveTest, BloomFilterRejectsMissingFiles) {
+    dp::archive_builder builder;
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        dp::archive archive(archive_path, mode);
+
+        EXPECT_TRUE(archive.contains("test.txt"));
+        EXPECT_TRUE(archive.contains("subdir/nested.txt"));
+        EXPECT_FALSE(archive.contains("missing.txt"));
+
+        auto missing = archive.open("missing.txt");
+        ASSERT_FALSE(missing.has_value());
+        EXPECT_EQ(missing.error(), dp::archive_error::entry_not_found);
+    }
+}
+
+TEST_F(ArchiveTest, ArchiveWithoutBloomFilter) {
+    dp::archive_builder builder;
+    builder.set_bloom_filter(false);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    dp::archive archive(archive_path);
+    EXPECT_TRUE(archive.contains("test.txt"));
+    EXPECT_FALSE(archive.contains("missing.txt"));
+    EXPECT_EQ(archive.list_files().size(), 3);
+}
+
+TEST_F(ArchiveTest, NormalizedLookup) {
+    dp::archive_builder builder;
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    dp::archive archive(archive_path);
+    EXPECT_FALSE(archive.contains("./subdir//nested.txt"));
+
+    archive.set_lookup_mode(dp::lookup_mode::normalized);
+    EXPECT_TRUE(archive.contains("./subdir//nested.txt"));
+    EXPECT_TRUE(archive.contains("subdir\\nested.txt"));
+    EXPECT_TRUE(archive.contains("other/../subdir/nested.txt"));
+    EXPECT_FALSE(archive.contains("SubDir/Nested.txt"));
+
+    auto stream = archive.open("./subdir//nested.txt");
+    ASSERT_TRUE(stream.has_value());
+
+    std::string content;
+    std::getline(**stream, content);
+    EXPECT_EQ(content, "This is a nested file with more content for compression testing");
+}
+
+TEST_F(ArchiveTest, CaseInsensitiveLookup) {
+    // Without stored folded hashes the reader computes them at load time
+    for (const bool stored_hashes : {true, false}) {
+        dp::archive_builder builder;
+        builder.set_folded_hashes(stored_hashes);
+        builder.add_directory(test_dir);
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+
+        dp::archive archive(archive_path);
+        archive.set_lookup_mode(dp::lookup_mode::case_insensitive);
+
+        EXPECT_TRUE(archive.contains("SubDir/Nested.TXT"));
+        EXPECT_TRUE(archive.contains(".\\TEST.txt"));
+        EXPECT_FALSE(archive.contains("missing.txt"));
+
+        auto stream = archive.open("BINARY.DAT");
+        ASSERT_TRUE(stream.has_value());
+    }
+}
+
+TEST_F(ArchiveTest, PreHashedPathKeys) {
+    using namespace dp::literals;
+
+    dp::archive_builder builder;
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    dp::archive archive(archive_path);
+    EXPECT_EQ(archive.path_hash_id(), dp::PATH_HASH_ID);
+
+    constexpr auto key = "subdir/nested.txt"_dp;
+    static_assert(key.hash == dp::static_path_hash("subdir/nested.txt"));
+    EXPECT_EQ(key.hash, dp::path_hash("subdir/nested.txt"));
+
+    EXPECT_TRUE(archive.contains(key));
+    EXPECT_FALSE(archive.contains("missing.txt"_dp));
+    EXPECT_TRUE(archive.contains(dp::path_key{"test.txt"}));
+
+    auto stream = archive.open(key);
+    ASSERT_TRUE(stream.has_value());
+
+    std::string content;
+    std::getline(**stream, content);
+    EXPECT_EQ(content, "This is a nested file with more content for compression testing");
+
+    // Non-exact modes fall back to normalizing the key's path
+    archive.set_lookup_mode(dp::lookup_mode::case_insensitive);
+    EXPECT_TRUE(archive.contains("SUBDIR/nested.txt"_dp));
+}
+
+TEST_F(ArchiveTest, PathHashIdWithoutPersistedHashes) {
+    dp::archive_builder builder;
+    builder.set_bloom_filter(false);
+    builder.set_folded_hashes(false);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    using namespace dp::literals;
+    dp::archive archive(archive_path);
+    EXPECT_EQ(archive.path_hash_id(), 0u);
+    EXPECT_TRUE(archive.contains("test.txt"_dp));
+}
+
+TEST_F(ArchiveTest, StreamsUseMemoryResource) {
+    dp::archive_builder builder(dp::compression_method::deflate);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    std::pmr::monotonic_buffer_resource pool;
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        dp::archive archive(archive_path, mode, &pool);
+        EXPECT_EQ(archive.memory_resource(), &pool);
+
+        auto stream = archive.open("subdir/nested.txt");
+        ASSERT_TRUE(stream.has_value());
+        std::string content;
+        std::getline(**stream, content);
+        EXPECT_EQ(content, "This is a nested file with more content for compression testing");
+
+        auto binary = archive.open("binary.dat");
+        ASSERT_TRUE(binary.has_value());
+        const std::vector<char> bytes(std::istreambuf_iterator<char>(**binary), {});
+        ASSERT_EQ(bytes.size(), 256u);
+        EXPECT_EQ(static_cast<unsigned char>(bytes[255]), 255);
+    }
+}
+
+TEST_F(ArchiveTest, ConcurrentOpensWithSynchronizedResource) {
+    dp::archive_builder builder(dp::compression_method::deflate);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::synchronized_pool_resource pool(&arena);
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        const dp::archive archive(archive_path, mode, &pool);
+
+        // Streams are also destroyed on the threads that opened them
+        std::atomic<int> mismatches{0};
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 200; ++i) {
+                    auto stream = archive.open("subdir/nested.txt");
+                    std::string content;
+                    if (!stream || !std::getline(**stream, content) ||
+                        content != "This is a nested file with more content for compression testing") {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        threads.clear();
+        EXPECT_EQ(mismatches.load(), 0);
+    }
+}
+
+TEST_F(ArchiveTest, DirectIoReads) {
+    // Large enough to span several direct I/O blocks, with an unaligned tail
+    std::vector<char> large(3 * 4096 + 123);
+    for (std::size_t i = 0; i < large.size(); ++i) {
+        large[i] = static_cast<char>((i * 7) & 0xff);
+    }
+    {
+        std::ofstream file(test_dir / "large.bin", std::ios::binary);
+        file.write(large.data(), static_cast<std::streamsize>(large.size()));
+    }
+
+    for (const std::uint32_t alignment : {1u, 4096u}) {
+        dp::archive_builder builder(dp::compression_method::none);
+        builder.set_alignment(alignment);
+        builder.add_directory(test_dir);
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+
+        dp::archive archive(archive_path);
+        archive.set_direct_io_threshold(4096);
+        EXPECT_EQ(archive.get_direct_io_threshold(), 4096u);
+
+        for (const auto io : {dp::io_mode::automatic, dp::io_mode::direct, dp::io_mode::buffered}) {
+            auto stream = archive.open("large.bin", io);
+            ASSERT_TRUE(stream.has_value());
+
+            std::vector<char> data(large.size());
+            (*stream)->read(data.data(), static_cast<std::streamsize>(data.size()));
+            EXPECT_EQ((*stream)->gcount(), static_cast<std::streamsize>(large.size()));
+            EXPECT_EQ(data, large);
+        }
+
+        // Small files go through the same path when forced
+        auto small = archive.open("test.txt", dp::io_mode::direct);
+        ASSERT_TRUE(small.has_value());
+        std::string content;
+        std::getline(**small, content);
+        EXPECT_EQ(content, "This is a test file");
+    }
+}
+
+TEST_F(ArchiveTest, DirectReadsOfGrowingSize) {
+    // Larger than the 4 MiB bounce buffer limit, so the last read takes several passes
+    std::vector<std::byte> contents((std::size_t{5} << 20) + 321);
+    for (std::size_t i = 0; i < contents.size(); ++i) {
+        contents[i] = static_cast<std::byte>((i * 13) ^ (i >> 12));
+    }
+    {
+        std::ofstream file(archive_path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    }
+
+    // The per-thread bounce buffer starts small and grows with the requests
+    const dp::file_handle handle(archive_path);
+    ASSERT_TRUE(handle.is_open());
+    const std::pair<std::uint64_t, std::size_t> reads[] = {
+        {7, 1}, {4095, 2}, {100, 5000}, {0, 64 * 1024}, {12345, contents.size() - 12345}, {3, 10}};
+    for (const auto& [offset, size] : reads) {
+        std::vector<std::byte> data(size);
+        ASSERT_TRUE(handle.read_at_direct(offset, data)) << offset;
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), contents.begin() + static_cast<std::ptrdiff_t>(offset)))
+            << offset;
+    }
+
+    // Reads past the end still fail
+    std::vector<std::byte> past(16);
+    EXPECT_FALSE(handle.read_at_direct(contents.size() - 8, past));
+}
+
+TEST_F(ArchiveTest, AlignedBlobLayout) {
+    dp::archive_builder builder(dp::compression_method::none);
+    builder.set_alignment(4096);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    // Three blobs, each starting on its own 4 KiB boundary
+    EXPECT_GT(std::filesystem::file_size(archive_path), 3u * 4096u);
+
+    dp::archive archive(archive_path, dp::access_mode::memory);
+    auto stream = archive.open("binary.dat");
+    ASSERT_TRUE(stream.has_value());
+
+    std::vector<char> data(256);
+    (*stream)->read(data.data(), 256);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(static_cast<unsigned char>(data[i]), i);
+    }
+}
+
+TEST_F(ArchiveTest, StoredEntriesStreamLazily) {
+    dp::archive_builder builder(dp::compression_method::none);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    std::unique_ptr<dp::vfstream> stream;
+    {
+        dp::archive archive(archive_path);
+        auto result = archive.open("binary.dat");
+        ASSERT_TRUE(result.has_value());
+        stream = std::move(*result);
+    }
+
+    // The stream keeps the file open after the archive is gone
+    stream->seekg(200);
+    EXPECT_EQ(stream->get(), 200);
+
+    stream->seekg(0, std::ios::end);
+    EXPECT_EQ(stream->tellg(), 256);
+
+    stream->seekg(0);
+    std::vector<char> data(300);
+    stream->read(data.data(), 300);
+    EXPECT_EQ(stream->gcount(), 256);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(static_cast<unsigned char>(data[i]), i);
+    }
+}
+
+TEST_F(ArchiveTest, BlobOrderPolicies) {
+    const auto list = [this](dp::archive_builder& builder) {
+        EXPECT_TRUE(builder.build(archive_path).has_value());
+        return dp::archive(archive_path).list_files();
+    };
+
+    const auto add_shuffled = [this](dp::archive_builder& builder) {
+        builder.add_file(test_dir / "test.txt", "test.txt");
+        builder.add_file(test_dir / "subdir" / "nested.txt", "subdir/nested.txt");
+        builder.add_file(test_dir / "binary.dat", "binary.dat");
+    };
+
+    {
+        dp::archive_builder builder(dp::compression_method::none);
+        add_shuffled(builder);
+        EXPECT_EQ(list(builder), (std::vector<std::string>{"test.txt", "subdir/nested.txt", "binary.dat"}));
+    }
+    {
+        dp::archive_builder builder(dp::compression_method::none);
+        add_shuffled(builder);
+        builder.set_blob_order(dp::blob_order::path);
+        EXPECT_EQ(list(builder), (std::vector<std::string>{"binary.dat", "subdir/nested.txt", "test.txt"}));
+    }
+    {
+        dp::archive_builder builder(dp::compression_method::none);
+        add_shuffled(builder);
+        builder.set_blob_order(dp::blob_order::extension);
+        EXPECT_EQ(list(builder), (std::vector<std::string>{"binary.dat", "subdir/nested.txt", "test.txt"}));
+    }
+    {
+        dp::archive_builder builder(dp::compression_method::none);
+        add_shuffled(builder);
+        builder.set_blob_order(dp::blob_order::size);
+        EXPECT_EQ(list(builder), (std::vector<std::string>{"test.txt", "subdir/nested.txt", "binary.dat"}));
+    }
+    {
+        dp::archive_builder builder(dp::compression_method::none);
+        add_shuffled(builder);
+        builder.set_blob_order(dp::blob_order::manifest);
+        builder.set_manifest({"subdir/nested.txt", "missing.txt"});
+        EXPECT_EQ(list(builder), (std::vector<std::string>{"subdir/nested.txt", "binary.dat", "test.txt"}));
+    }
+}
+
+TEST_F(ArchiveTest, ReproducibleBuilds) {
+    const auto read_bytes = [](const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+    };
+
+    dp::archive_builder from_directory;
+    from_directory.add_directory(test_dir);
+    ASSERT_TRUE(from_directory.build(archive_path).has_value());
+    const auto first = read_bytes(archive_path);
+
+    // Same files added in a different order, laid out by path
+    dp::archive_builder by_path;
+    by_path.add_file(test_dir / "test.txt", "test.txt");
+    by_path.add_file(test_dir / "binary.dat", "binary.dat");
+    by_path.add_file(test_dir / "subdir" / "nested.txt", "subdir/nested.txt");
+    by_path.set_blob_order(dp::blob_order::path);
+    ASSERT_TRUE(by_path.build(archive_path).has_value());
+
+    EXPECT_EQ(read_bytes(archive_path), first);
+}
+
+TEST_F(ArchiveTest, InMemorySources) {
+    const std::string text = "Generated in memory";
+    std::vector<std::byte> bytes(text.size());
+    std::memcpy(bytes.data(), text.data(), text.size());
+
+    int generated = 0;
+    dp::archive_builder builder(dp::compression_method::deflate);
+    builder.add_buffer("copied.txt", std::span<const std::byte>(bytes));
+    builder.add_buffer("moved.txt", std::vector<std::byte>(bytes), dp::compression_method::none);
+    builder.add_generator("generated.txt", [&]() -> std::expected<std::vector<std::byte>, dp::builder_error> {
+        ++generated;
+        return bytes;
+    });
+    builder.add_file(test_dir / "test.txt", "test.txt");
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+    EXPECT_EQ(generated, 1);
+
+    dp::archive archive(archive_path);
+    for (const auto* name : {"copied.txt", "moved.txt", "generated.txt"}) {
+        auto stream = archive.open(name);
+        ASSERT_TRUE(stream.has_value()) << name;
+        std::string content;
+        std::getline(**stream, content);
+        EXPECT_EQ(content, text);
+    }
+
+    EXPECT_EQ(archive.stat("copied.txt")->compression, dp::compression_method::deflate);
+    EXPECT_EQ(archive.stat("moved.txt")->compression, dp::compression_method::deflate);
+
+    // Generator failures abort the build
+    dp::archive_builder failing;
+    failing.add_generator("broken.bin", []() -> std::expected<std::vector<std::byte>, dp::builder_error> {
+        return std::unexpected{dp::builder_error::file_not_found};
+    });
+    auto result = failing.build(archive_path);
+    ASSERT_FALSE(result.has_value());
+    EXPECT_EQ(result.error(), dp::builder_error::file_not_found);
+}
+
+TEST_F(ArchiveTest, StreamedBuildWithTrailer) {
+    // Append-only sink: std::streambuf's default seekoff/seekpos always fail
+    struct append_only_buf : std::streambuf {
+        std::string bytes;
+        int_type overflow(int_type c) override {
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                bytes.push_back(traits_type::to_char_type(c));
+            }
+            return traits_type::not_eof(c);
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            bytes.append(s, static_cast<std::size_t>(n));
+            return n;
+        }
+    } sink;
+    std::ostream output(&sink);
+
+    dp::archive_builder builder(dp::compression_method::deflate);
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(output).has_value());
+
+    {
+        std::ofstream file(archive_path, std::ios::binary);
+        file.write(sink.bytes.data(), static_cast<std::streamsize>(sink.bytes.size()));
+    }
+
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        dp::archive archive(archive_path, mode);
+        EXPECT_EQ(archive.list_files().size(), 3u);
+        EXPECT_FALSE(archive.contains("missing.txt"));
+        EXPECT_EQ(archive.path_hash_id(), dp::PATH_HASH_ID);
+
+        auto stream = archive.open("subdir/nested.txt");
+        ASSERT_TRUE(stream.has_value());
+        std::string content;
+        std::getline(**stream, content);
+        EXPECT_EQ(content, "This is a nested file with more content for compression testing");
+    }
+
+    // A corrupted trailer is rejected
+    sink.bytes.back() ^= 0x5a;
+    {
+        std::ofstream file(archive_path, std::ios::binary);
+        file.write(sink.bytes.data(), static_cast<std::streamsize>(sink.bytes.size()));
+    }
+    EXPECT_THROW(dp::archive{archive_path}, std::runtime_error);
+}
+
+TEST_F(ArchiveTest, IncrementalRebuildReusesUnchangedBlobs) {
+    const auto previous_path = std::filesystem::temp_directory_path() / "test_archive_previous.pak";
+
+    dp::archive_builder first(dp::compression_method::deflate);
+    first.set_source_mtimes(true);
+    first.add_directory(test_dir);
+    ASSERT_TRUE(first.build(previous_path).has_value());
+    EXPECT_EQ(first.reused_count(), 0u);
+
+    {
+        dp::archive previous(previous_path);
+        const auto info = previous.stat("test.txt");
+        ASSERT_TRUE(info.has_value());
+        ASSERT_TRUE(info->metadata.has_value());
+        EXPECT_NE(info->metadata->mtime, 0);
+    }
+
+    // Same contents with a new mtime, and one file that really changed
+    const auto nested = test_dir / "subdir" / "nested.txt";
+    std::filesystem::last_write_time(nested, std::filesystem::last_write_time(nested) + std::chrono::seconds(5));
+    {
+        std::ofstream file(test_dir / "test.txt");
+        file << "This is an edited test file";
+    }
+
+    dp::archive_builder second(dp::compression_method::deflate);
+    second.set_source_mtimes(true);
+    second.add_directory(test_dir);
+    ASSERT_TRUE(second.set_reference(previous_path).has_value());
+    ASSERT_TRUE(second.build(archive_path).has_value());
+    EXPECT_EQ(second.reused_count(), 2u); // binary.dat by mtime, nested.txt by content
+
+    dp::archive rebuilt(archive_path);
+    for (const auto& [name, expected] : {std::pair{"test.txt", "This is an edited test file"},
+                                         std::pair{"subdir/nested.txt",
+                                                   "This is a nested file with more content for compression testing"}}) {
+        auto stream = rebuilt.open(name);
+        ASSERT_TRUE(stream.has_value());
+        std::string content;
+        std::getline(**stream, content);
+        EXPECT_EQ(content, expected);
+    }
+
+    auto binary = rebuilt.open("binary.dat");
+    ASSERT_TRUE(binary.has_value());
+    std::vector<char> data(256);
+    (*binary)->read(data.data(), 256);
+    for (int i = 0; i < 256; ++i) {
+        EXPECT_EQ(static_cast<unsigned char>(data[i]), i);
+    }
+
+    // Metadata of reused entries carries over; the new mtime is recorded
+    EXPECT_EQ(rebuilt.stat("subdir/nested.txt")->metadata->checksum,
+              dp::archive(previous_path).stat("subdir/nested.txt")->metadata->checksum);
+
+    // A changed compression method forces recompression
+    dp::archive_builder third(dp::compression_method::none);
+    third.add_directory(test_dir);
+    ASSERT_TRUE(third.set_reference(previous_path).has_value());
+    ASSERT_TRUE(third.build(archive_path).has_value());
+    EXPECT_EQ(third.reused_count(), 0u);
+
+    // Building over the reference itself is refused
+    EXPECT_EQ(third.build(previous_path).error(), dp::builder_error::invalid_path);
+    EXPECT_EQ(second.set_reference(test_dir / "missing.pak").error(), dp::builder_error::file_not_found);
+
+    std::filesystem::remove(previous_path);
+}
+
+TEST_F(ArchiveTest, DefaultBuildsAreReproducible) {
+    const auto read_bytes = [](const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(file), {});
+    };
+
+    dp::archive_builder builder;
+    builder.add_directory(test_dir);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+    const auto first = read_bytes(archive_path);
+    {
+        dp::archive built(archive_path);
+        ASSERT_TRUE(built.stat("test.txt")->metadata.has_value());
+        EXPECT_EQ(built.stat("test.txt")->metadata->mtime, 0);
+    }
+
+    // Touching the sources must not change the output
+    const auto source = test_dir / "test.txt";
+    std::filesystem::last_write_time(source, std::filesystem::last_write_time(source) + std::chrono::seconds(5));
+    dp::archive_builder rebuild;
+    rebuild.add_directory(test_dir);
+    ASSERT_TRUE(rebuild.build(archive_path).has_value());
+    EXPECT_EQ(read_bytes(archive_path), first);
+}
+
+TEST_F(ArchiveTest, CopiedEntriesKeepStoredBytes) {
+    const auto source_path = std::filesystem::temp_directory_path() / "test_archive_copy_source.pak";
+    dp::archive_builder source_builder(dp::compression_method::deflate);
+    source_builder.add_directory(test_dir);
+    ASSERT_TRUE(source_builder.build(source_path).has_value());
+
+    const auto check = [&](const dp::archive& copy) {
+        EXPECT_TRUE(copy.verify().empty());
+        auto stream = copy.open("subdir/nested.txt");
+        ASSERT_TRUE(stream.has_value());
+        std::string content;
+        std::getline(**stream, content);
+        EXPECT_EQ(content, "This is a nested file with more content for compression testing");
+        EXPECT_EQ(copy.stat("test.txt")->compression, dp::compression_method::deflate);
+        EXPECT_TRUE(copy.stat("test.txt")->metadata.has_value());
+    };
+
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        const auto source = std::make_shared<const dp::archive>(source_path, mode);
+        dp::archive_builder builder;
+        builder.set_alignment(4096);
+        for (const auto& path : source->list_files()) {
+            builder.add_copy(path, source, *source->find(path));
+        }
+        builder.add_buffer("extra.txt", std::vector<std::byte>(100, std::byte{'e'}));
+
+        // File to file into one file, then into volumes
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+        check(dp::archive(archive_path));
+
+        builder.set_volume_count(2);
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+        check(dp::archive(archive_path));
+        builder.set_volume_count(1);
+
+        // Streams fall back to reading the blob
+        std::ostringstream sink;
+        ASSERT_TRUE(builder.build(sink).has_value());
+        {
+            std::ofstream file(archive_path, std::ios::binary | std::ios::trunc);
+            file << sink.str();
+        }
+        check(dp::archive(archive_path));
+    }
+
+    for (std::uint32_t i = 0; i < 2; ++i) {
+        std::filesystem::remove(dp::volume_path(archive_path, i));
+    }
+    std::filesystem::remove(source_path);
+}
+
+TEST_F(ArchiveTest, ChunkDedupSharesNearDuplicates) {
+    // Two incompressible variants that differ in a few bytes near the start
+    std::vector<std::byte> level(512 * 1024);
+    std::uint32_t state = 7;
+    for (auto& byte : level) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::byte>(state >> 24);
+    }
+    auto variant = level;
+    std::memcpy(variant.data() + 3000, "variant", 7);
+
+    dp::archive_builder plain;
+    plain.add_buffer("level_a.bin", level);
+    plain.add_buffer("level_b.bin", variant);
+    ASSERT_TRUE(plain.build(archive_path).has_value());
+    const auto plain_size = std::filesystem::file_size(archive_path);
+
+    dp::archive_builder builder;
+    builder.set_chunk_dedup(true);
+    builder.add_buffer("level_a.bin", level);
+    builder.add_buffer("level_b.bin", variant);
+    builder.add_buffer("empty.bin", std::vector<std::byte>{});
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    // The second variant costs little more than its differing chunk
+    const auto deduped_size = std::filesystem::file_size(archive_path);
+    EXPECT_LT(deduped_size, plain_size * 6 / 10);
+
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        dp::archive arch(archive_path, mode);
+        EXPECT_GT(arch.chunk_count(), 0u);
+
+        auto info = arch.stat("level_b.bin");
+        ASSERT_TRUE(info.has_value());
+        EXPECT_EQ(info->compression, dp::compression_method::chunked);
+        EXPECT_EQ(info->size, variant.size());
+
+        const auto read = [&](std::string_view name) {
+            auto stream = arch.open(name);
+            EXPECT_TRUE(stream.has_value());
+            std::string content{std::istreambuf_iterator<char>(**stream), {}};
+            return std::vector<std::byte>(reinterpret_cast<const std::byte*>(content.data()),
+                                          reinterpret_cast<const std::byte*>(content.data()) + content.size());
+        };
+
+        EXPECT_EQ(read("level_a.bin"), level);
+        EXPECT_EQ(read("level_b.bin"), variant);
+        EXPECT_TRUE(read("empty.bin").empty());
+
+        // Reassembly does not depend on cached chunks
+        arch.set_chunk_cache_capacity(0);
+        EXPECT_EQ(read("level_b.bin"), variant);
+
+        std::vector<std::byte> out(variant.size());
+        EXPECT_EQ(arch.read("level_b.bin", out), variant.size());
+        EXPECT_EQ(out, variant);
+    }
+}
+
+TEST_F(ArchiveTest, ReadIntoCallerBuffer) {
+    std::vector<std::byte> table(64 * 1024);
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        table[i] = static_cast<std::byte>(i % 251);
+    }
+
+    for (const auto method : {dp::compression_method::none, dp::compression_method::deflate}) {
+        dp::archive_builder builder(method);
+        builder.add_buffer("table.bin", table);
+        builder.add_buffer("empty.bin", std::vector<std::byte>{});
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+
+        for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+            dp::archive archive(archive_path, mode);
+
+            // A larger buffer is fine; only the file's bytes are written
+            std::vector<std::byte> out(table.size() + 16, std::byte{0xee});
+            const auto written = archive.read("table.bin", out);
+            ASSERT_TRUE(written.has_value());
+            EXPECT_EQ(*written, table.size());
+            EXPECT_TRUE(std::equal(table.begin(), table.end(), out.begin()));
+            EXPECT_EQ(out.back(), std::byte{0xee});
+
+            EXPECT_EQ(archive.read("empty.bin", std::span<std::byte>{}), 0u);
+
+            std::vector<std::byte> small(table.size() - 1);
+            EXPECT_EQ(archive.read("table.bin", small).error(), dp::archive_error::buffer_too_small);
+            EXPECT_EQ(archive.read("missing.bin", out).error(), dp::archive_error::entry_not_found);
+        }
+    }
+}
+
+TEST_F(ArchiveTest, SequentialReadahead) {
+    std::vector<std::byte> table(300 * 1024);
+    std::uint32_t state = 7;
+    for (std::size_t i = 0; i < table.size(); ++i) {
+        // Half noise, half runs, so deflate spans many input refills and windows
+        state = state * 1664525u + 1013904223u;
+        table[i] = (i / 4096) % 2 ? static_cast<std::byte>(state >> 24) : static_cast<std::byte>(i / 4096);
+    }
+    const std::string expected(reinterpret_cast<const char*>(table.data()), table.size());
+
+    for (const auto method : {dp::compression_method::none, dp::compression_method::deflate}) {
+        dp::archive_builder builder(method);
+        builder.add_buffer("table.bin", table);
+        builder.add_buffer("empty.bin", std::vector<std::byte>{});
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+
+        for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+            dp::archive archive(archive_path, mode);
+
+            for (const std::size_t window : {std::size_t{1000}, dp::readahead_streambuf::default_window_size}) {
+                auto stream = archive.open_sequential("table.bin", window);
+                ASSERT_TRUE(stream.has_value());
+                const std::string contents{std::istreambuf_iterator<char>(**stream), {}};
+                EXPECT_EQ(contents, expected);
+            }
+
+            // Reads straddling window boundaries, and the position as they advance
+            auto stream = archive.open_sequential("table.bin", 4096);
+            ASSERT_TRUE(stream.has_value());
+            std::string part(5000, '\0');
+            (*stream)->read(part.data(), part.size());
+            EXPECT_EQ(part, expected.substr(0, part.size()));
+            EXPECT_EQ((*stream)->tellg(), 5000);
+
+            auto empty = archive.open_sequential("empty.bin");
+            ASSERT_TRUE(empty.has_value());
+            EXPECT_EQ((*empty)->get(), std::char_traits<char>::eof());
+
+            // Dropping a stream part way through stops its producer
+            auto abandoned = archive.open_sequential("table.bin", 1000);
+            ASSERT_TRUE(abandoned.has_value());
+            EXPECT_EQ((*abandoned)->get(), static_cast<int>(table[0]));
+
+            EXPECT_EQ(archive.open_sequential("missing.bin").error(), dp::archive_error::entry_not_found);
+        }
+
+        if (method != dp::compression_method::deflate) {
+            continue;
+        }
+
+        // Corrupt the middle of the compressed blob: the stream must fail, not end early
+        const auto index = dp::archive(archive_path).find("table.bin");
+        ASSERT_TRUE(index.has_value());
+        const auto raw = dp::archive(archive_path).read_raw_entry(*index);
+        ASSERT_TRUE(raw.has_value());
+        {
+            std::vector<char> bytes(std::filesystem::file_size(archive_path));
+            std::ifstream(archive_path, std::ios::binary).read(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            const auto blob = std::search(bytes.begin(), bytes.end(), reinterpret_cast<const char*>(raw->data()),
+                                          reinterpret_cast<const char*>(raw->data() + raw->size()));
+            ASSERT_NE(blob, bytes.end());
+            std::fill_n(blob + static_cast<std::ptrdiff_t>(raw->size() / 2), 64, '\x5a');
+            std::ofstream(archive_path, std::ios::binary).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+
+        dp::archive corrupt(archive_path);
+        auto stream = corrupt.open_sequential("table.bin", 4096);
+        ASSERT_TRUE(stream.has_value());
+        std::string contents(table.size(), '\0');
+        (*stream)->read(contents.data(), static_cast<std::streamsize>(contents.size()));
+        EXPECT_TRUE((*stream)->bad());
+        EXPECT_NE(contents, expected);
+    }
+}
+
+TEST_F(ArchiveTest, FilteredEntries) {
+    std::vector<std::byte> samples(40000);
+    for (std::size_t i = 0; i < samples.size(); i += 2) {
+        const auto sample = static_cast<std::int16_t>(i * 3);
+        std::memcpy(samples.data() + i, &sample, sizeof(sample));
+    }
+
+    dp::archive_builder builder;
+    builder.add_buffer("audio.raw", samples);
+    builder.add_buffer("plain.raw", samples);
+    builder.set_filter("audio.raw", dp::filter_type::delta, 2);
+    builder.set_filter("plain.raw", dp::filter_type::shuffle, 2);
+    builder.set_filter("plain.raw", dp::filter_type::none);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        dp::archive archive(archive_path, mode);
+        const auto filtered = archive.stat("audio.raw");
+        const auto plain = archive.stat("plain.raw");
+        ASSERT_TRUE(filtered.has_value());
+        ASSERT_TRUE(plain.has_value());
+        EXPECT_EQ(filtered->compression, dp::compression_method::filtered);
+        EXPECT_EQ(plain->compression, dp::compression_method::deflate);
+        EXPECT_LT(filtered->compressed_size, plain->compressed_size);
+
+        auto stream = archive.open("audio.raw");
+        ASSERT_TRUE(stream.has_value());
+        const std::string contents{std::istreambuf_iterator<char>(**stream), {}};
+        EXPECT_EQ(contents, std::string(reinterpret_cast<const char*>(samples.data()), samples.size()));
+
+        std::vector<std::byte> out(samples.size());
+        EXPECT_EQ(archive.read("audio.raw", out), samples.size());
+        EXPECT_EQ(out, samples);
+    }
+    EXPECT_TRUE(dp::archive(archive_path).verify().empty());
+
+    dp::archive_builder invalid;
+    invalid.add_buffer("audio.raw", samples);
+    invalid.set_filter("audio.raw", dp::filter_type::shuffle, 0);
+    EXPECT_EQ(invalid.build(archive_path).error(), dp::builder_error::compression_error);
+}
+
+TEST_F(ArchiveTest, MultiVolumeArchive) {
+    dp::archive_builder builder(dp::compression_method::none);
+    builder.set_volume_count(3);
+    for (int i = 0; i < 12; ++i) {
+        builder.add_buffer("file" + std::to_string(i) + ".txt",
+                           std::vector<std::byte>(1000 + i * 100, static_cast<std::byte>('a' + i)));
+    }
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    // Blobs are spread over the volumes; the archive file holds the directory
+    std::uintmax_t volume_bytes = 0;
+    for (std::uint32_t i = 0; i < 3; ++i) {
+        const auto volume = dp::volume_path(archive_path, i);
+        ASSERT_TRUE(std::filesystem::exists(volume)) << volume;
+        EXPECT_GT(std::filesystem::file_size(volume), sizeof(dp::volume_header));
+        volume_bytes += std::filesystem::file_size(volume);
+    }
+    EXPECT_FALSE(std::filesystem::exists(dp::volume_path(archive_path, 3)));
+    EXPECT_LT(std::filesystem::file_size(archive_path), volume_bytes);
+    EXPECT_EQ(dp::volume_path("assets.pak", 7), std::filesystem::path("assets.pak.007"));
+
+    for (const auto mode : {dp::access_mode::disk, dp::access_mode::memory}) {
+        dp::archive arch(archive_path, mode);
+        EXPECT_EQ(arch.volume_count(), 3u);
+
+        std::vector<std::uint32_t> indices;
+        for (int i = 0; i < 12; ++i) {
+            const auto name = "file" + std::to_string(i) + ".txt";
+            auto stream = arch.open(name);
+            ASSERT_TRUE(stream.has_value()) << name;
+            const std::string content{std::istreambuf_iterator<char>(**stream), {}};
+            EXPECT_EQ(content, std::string(1000 + i * 100, static_cast<char>('a' + i)));
+            indices.push_back(*arch.find(name));
+        }
+
+        // Bulk reads return the same bytes as single reads, in request order
+        indices.push_back(1000);
+        const auto results = arch.read_raw_entries(indices);
+        ASSERT_EQ(results.size(), indices.size());
+        for (std::size_t i = 0; i + 1 < indices.size(); ++i) {
+            ASSERT_TRUE(results[i].has_value());
+            EXPECT_EQ(*results[i], *arch.read_raw_entry(indices[i]));
+        }
+        EXPECT_EQ(results.back().error(), dp::archive_error::entry_not_found);
+    }
+
+    // Volumes have no paths of their own when streaming
+    std::ostringstream sink;
+    EXPECT_EQ(builder.build(sink).error(), dp::builder_error::invalid_path);
+
+    // A volume from an earlier build with the same layout is rejected
+    const auto stale = archive_path.string() + ".stale";
+    std::filesystem::copy_file(dp::volume_path(archive_path, 1), stale,
+                               std::filesystem::copy_options::overwrite_existing);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+    EXPECT_NO_THROW(dp::archive{archive_path});
+    std::filesystem::rename(stale, dp::volume_path(archive_path, 1));
+    EXPECT_THROW(dp::archive{archive_path}, std::runtime_error);
+
+    // A missing volume makes the archive unreadable
+    std::filesystem::remove(dp::volume_path(archive_path, 1));
+    EXPECT_THROW(dp::archive{archive_path}, std::runtime_error);
+
+    for (std::uint32_t i = 0; i < 3; ++i) {
+        std::filesystem::remove(dp::volume_path(archive_path, i));
+    }
+}
+
+TEST_F(ArchiveTest, MultiVolumeChunkedEntries) {
+    std::vector<std::byte> level(256 * 1024);
+    std::uint32_t state = 11;
+    for (auto& byte : level) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::byte>(state >> 24);
+    }
+
+    dp::archive_builder builder;
+    builder.set_volume_count(2);
+    builder.set_chunk_dedup(true);
+    builder.add_buffer("level.bin", level);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    dp::archive arch(archive_path);
+    auto stream = arch.open("level.bin");
+    ASSERT_TRUE(stream.has_value());
+    const std::string content{std::istreambuf_iterator<char>(**stream), {}};
+    ASSERT_EQ(content.size(), level.size());
+    EXPECT_EQ(std::memcmp(content.data(), level.data(), level.size()), 0);
+
+    for (std::uint32_t i = 0; i < 2; ++i) {
+        EXPECT_GT(std::filesystem::file_size(dp::volume_path(archive_path, i)), 64u * 1024);
+        std::filesystem::remove(dp::volume_path(archive_path, i));
+    }
+}
+
+TEST_F(ArchiveTest, VerifyCapsThreadCount) {
+    // An absurd request must not start one thread per entry
+    dp::archive_builder builder(dp::compression_method::none);
+    for (int i = 0; i < 2000; ++i) {
+        builder.add_buffer("file" + std::to_string(i) + ".txt", std::vector<std::byte>(16, std::byte{'v'}));
+    }
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    dp::archive arch(archive_path);
+    EXPECT_TRUE(arch.verify(~0u).empty());
+}
+
+TEST_F(ArchiveTest, VerifyDetectsCorruption) {
+    dp::archive_builder builder(dp::compression_method::none);
+    builder.add_directory(test_dir);
+    builder.add_buffer("packed.txt", std::vector<std::byte>(4096, std::byte{'p'}), dp::compression_method::deflate);
+    ASSERT_TRUE(builder.build(archive_path).has_value());
+
+    {
+        dp::archive arch(archive_path);
+        EXPECT_TRUE(arch.verify().empty());
+        EXPECT_TRUE(arch.verify(1).empty());
+        for (std::uint32_t i = 0; i < arch.entry_count(); ++i) {
+            EXPECT_TRUE(arch.verify_entry(i).has_value());
+        }
+        EXPECT_EQ(arch.verify_entry(100).error(), dp::archive_error::entry_not_found);
+    }
+
+    // Flip a byte of the stored test.txt blob
+    std::string bytes;
+    {
+        std::ifstream input(archive_path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(input), {});
+    }
+    const auto position = bytes.find("This is a test file");
+    ASSERT_NE(position, std::string::npos);
+    bytes[position] = 't';
+    {
+        std::ofstream output(archive_path, std::ios::binary);
+        output.write(bytes.data(), bytes.size());
+    }
+
+    dp::archive arch(archive_path);
+    const auto failures = arch.verify();
+    ASSERT_EQ(failures.size(), 1u);
+    EXPECT_EQ(arch.list_files()[failures[0].entry], "test.txt");
+    EXPECT_EQ(failures[0].error, dp::archive_error::checksum_mismatch);
+}
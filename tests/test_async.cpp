@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <datapak/async.hpp>
+#include <datapak/archive_builder.hpp>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <latch>
+
+class AsyncTest : public ::testing::Test {
+protected:
+    std::filesystem::path test_dir;
+    std::filesystem::path archive_path;
+
+    void SetUp() override {
+        test_dir = std::filesystem::temp_directory_path() / "datapak_async_test";
+        archive_path = std::filesystem::temp_directory_path() / "async_archive.pak";
+
+        std::filesystem::remove_all(test_dir);
+        std::filesystem::remove(archive_path);
+        std::filesystem::create_directories(test_dir);
+
+        for (int i = 0; i < 16; ++i) {
+            std::ofstream file(test_dir / ("file" + std::to_string(i) + ".txt"));
+            for (int j = 0; j < 50; ++j) {
+                file << "Line " << j << " of file " << i << "\n";
+            }
+        }
+
+        dp::archive_builder builder;
+        builder.add_directory(test_dir);
+        ASSERT_TRUE(builder.build(archive_path).has_value());
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(test_dir);
+        std::filesystem::remove(archive_path);
+    }
+
+    static std::string to_string(const std::vector<std::byte>& data) {
+        return std::string(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+};
+
+namespace {
+
+dp::detail::detached_task read_one(const dp::vfs& fs, std::string path, dp::async_engine& engine,
+                                   dp::thread_pool& executor, std::atomic<int>& successes,
+                                   std::latch& done) {
+    auto data = co_await dp::co_read(fs, std::move(path), engine, executor);
+    if (data && !data->empty()) {
+        successes.fetch_add(1);
+    }
+    done.count_down();
+}
+
+} // namespace
+
+TEST_F(AsyncTest, ReadMatchesBlockingOpen) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive_path).has_value());
+
+    dp::async_engine engine(1, 1);
+    dp::thread_pool executor(1);
+
+    auto data = dp::sync_wait(dp::co_read(filesystem, "file3.txt", engine, executor));
+    ASSERT_TRUE(data.has_value());
+
+    auto stream = filesystem.open("file3.txt");
+    ASSERT_TRUE(stream.has_value());
+    std::string expected((std::istreambuf_iterator<char>(**stream)), std::istreambuf_iterator<char>());
+
+    EXPECT_EQ(to_string(*data), expected);
+}
+
+TEST_F(AsyncTest, OpenReturnsStream) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive_path, dp::access_mode::memory).has_value());
+
+    dp::async_engine engine;
+    dp::thread_pool executor(1);
+
+    auto stream = dp::sync_wait(dp::co_open(filesystem, "file0.txt", engine, executor));
+    ASSERT_TRUE(stream.has_value());
+
+    std::string line;
+    std::getline(**stream, line);
+    EXPECT_EQ(line, "Line 0 of file 0");
+}
+
+TEST_F(AsyncTest, MissingFile) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive_path).has_value());
+
+    dp::async_engine engine(1, 1);
+    dp::thread_pool executor(1);
+
+    auto data = dp::sync_wait(dp::co_read(filesystem, "missing.txt", engine, executor));
+    ASSERT_FALSE(data.has_value());
+    EXPECT_EQ(data.error(), dp::vfs_error::file_not_found);
+}
+
+TEST_F(AsyncTest, ManyConcurrentReads) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive_path).has_value());
+
+    dp::async_engine engine(2, 2);
+    dp::thread_pool executor(2);
+
+    constexpr int operations = 512;
+    std::atomic<int> successes{0};
+    std::latch done(operations);
+
+    for (int i = 0; i < operations; ++i) {
+        read_one(filesystem, "file" + std::to_string(i % 16) + ".txt", engine, executor, successes, done);
+    }
+
+    done.wait();
+    EXPECT_EQ(successes.load(), operations);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <datapak/bloom_filter.hpp>
+#include <datapak/hash.hpp>
+#include <string>
+#include <vector>
+
+TEST(BloomFilterTest, EmptyFilterAcceptsEverything) {
+    dp::bloom_filter filter;
+    EXPECT_TRUE(filter.empty());
+    EXPECT_TRUE(filter.may_contain(dp::path_hash("anything.txt")));
+}
+
+TEST(BloomFilterTest, NoFalseNegatives) {
+    std::vector<std::uint64_t> hashes;
+    for (int i = 0; i < 1000; ++i) {
+        hashes.push_back(dp::path_hash("textures/file" + std::to_string(i) + ".png"));
+    }
+
+    const auto filter = dp::bloom_filter::build(hashes);
+    EXPECT_FALSE(filter.empty());
+
+    for (const auto hash : hashes) {
+        EXPECT_TRUE(filter.may_contain(hash));
+    }
+}
+
+TEST(BloomFilterTest, LowFalsePositiveRate) {
+    std::vector<std::uint64_t> hashes;
+    for (int i = 0; i < 1000; ++i) {
+        hashes.push_back(dp::path_hash("base/file" + std::to_string(i) + ".dat"));
+    }
+
+    const auto filter = dp::bloom_filter::build(hashes);
+
+    int false_positives = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (filter.may_contain(dp::path_hash("patch/missing" + std::to_string(i) + ".dat"))) {
+            ++false_positives;
+        }
+    }
+
+    // 10 bits per key gives roughly 1%; allow generous headroom
+    EXPECT_LT(false_positives, 500);
+}
+
+TEST(BloomFilterTest, RoundTripThroughWords) {
+    std::vector<std::uint64_t> hashes = {dp::path_hash("a.txt"), dp::path_hash("b/c.txt")};
+    const auto filter = dp::bloom_filter::build(hashes);
+
+    dp::bloom_filter restored(filter.probe_count(),
+                              std::vector<std::uint64_t>(filter.words().begin(), filter.words().end()));
+
+    EXPECT_EQ(restored.block_count(), filter.block_count());
+    EXPECT_TRUE(restored.may_contain(dp::path_hash("a.txt")));
+    EXPECT_TRUE(restored.may_contain(dp::path_hash("b/c.txt")));
+}
+
+TEST(PathHashTest, StableValues) {
+    // Persisted in archives; a change here requires bumping PATH_HASH_ID
+    static_assert(dp::path_hash("") == 0x146a6b2ea9984c76ULL);
+    EXPECT_EQ(dp::path_hash("a"), 0x128c54d5323074bbULL);
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <datapak/chunk.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+std::vector<std::byte> make_data(std::size_t size, std::uint32_t seed) {
+    std::vector<std::byte> data(size);
+    std::uint32_t state = seed;
+    for (auto& byte : data) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::byte>(state >> 24);
+    }
+    return data;
+}
+
+std::vector<std::size_t> boundaries(std::span<const std::byte> data, const dp::chunk_params& params) {
+    std::vector<std::size_t> ends;
+    std::size_t offset = 0;
+    while (offset < data.size()) {
+        offset += dp::next_chunk_boundary(data.subspan(offset), params);
+        ends.push_back(offset);
+    }
+    return ends;
+}
+
+} // namespace
+
+TEST(ChunkTest, ChunkSizesRespectLimits) {
+    const dp::chunk_params params;
+    const auto data = make_data(1024 * 1024, 1);
+    const auto ends = boundaries(data, params);
+
+    ASSERT_FALSE(ends.empty());
+    EXPECT_EQ(ends.back(), data.size());
+
+    std::size_t previous = 0;
+    for (std::size_t i = 0; i < ends.size(); ++i) {
+        const auto size = ends[i] - previous;
+        EXPECT_LE(size, params.max_size);
+        if (i + 1 < ends.size()) {
+            EXPECT_GT(size, params.min_size);
+        }
+        previous = ends[i];
+    }
+
+    // Normalized chunking keeps the mean near the target
+    const auto mean = data.size() / ends.size();
+    EXPECT_GT(mean, params.average_size / 2);
+    EXPECT_LT(mean, params.average_size * 2);
+
+    // Short inputs form a single chunk
+    EXPECT_EQ(dp::next_chunk_boundary(std::span(data).first(100), params), 100u);
+    EXPECT_EQ(dp::next_chunk_boundary({}, params), 0u);
+}
+
+TEST(ChunkTest, BoundariesResynchronizeAfterInsertion) {
+    const dp::chunk_params params;
+    const auto data = make_data(512 * 1024, 2);
+
+    auto edited = data;
+    const auto insert = make_data(37, 3);
+    edited.insert(edited.begin() + 1000, insert.begin(), insert.end());
+
+    const auto original = boundaries(data, params);
+    const auto shifted = boundaries(edited, params);
+
+    // Boundaries past the edit reappear, shifted by the inserted length
+    std::size_t shared = 0;
+    for (const auto end : original) {
+        if (end > 1000 && std::ranges::binary_search(shifted, end + insert.size())) {
+            ++shared;
+        }
+    }
+    EXPECT_GE(shared + 3, original.size());
+}
+
+TEST(ChunkTest, CacheEvictsLeastRecentlyUsed) {
+    dp::chunk_cache cache(300);
+    const auto chunk = [](std::size_t size) {
+        return std::make_shared<const std::vector<std::byte>>(size);
+    };
+
+    cache.insert(0, chunk(100));
+    cache.insert(1, chunk(100));
+    cache.insert(2, chunk(100));
+    EXPECT_EQ(cache.size(), 300u);
+
+    // Touch 0 so that 1 is the oldest
+    EXPECT_NE(cache.find(0), nullptr);
+    cache.insert(3, chunk(100));
+    EXPECT_EQ(cache.find(1), nullptr);
+    EXPECT_NE(cache.find(0), nullptr);
+    EXPECT_NE(cache.find(3), nullptr);
+    EXPECT_EQ(cache.size(), 300u);
+
+    // Chunks larger than the whole cache are not kept
+    cache.insert(4, chunk(400));
+    EXPECT_EQ(cache.find(4), nullptr);
+
+    cache.set_capacity(0);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.find(0), nullptr);
+}
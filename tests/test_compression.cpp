@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <datapak/compression.hpp>
+#include <array>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -56,6 +58,50 @@ TEST_F(CompressionTest, RoundTripBinaryData) {
     EXPECT_EQ(decompressed.value(), binary_data);
 }
 
+TEST_F(CompressionTest, DecompressIntoMemoryResource) {
+    auto compressed = dp::compression_engine::compress(binary_data, dp::compression_method::deflate);
+    ASSERT_TRUE(compressed.has_value());
+
+    // Anything not served by the pool would hit the null upstream and throw
+    std::array<std::byte, 4096> storage;
+    std::pmr::monotonic_buffer_resource pool(storage.data(), storage.size(), std::pmr::null_memory_resource());
+
+    auto decompressed = dp::compression_engine::decompress(
+        *compressed, dp::compression_method::deflate, binary_data.size(), &pool);
+    ASSERT_TRUE(decompressed.has_value());
+    EXPECT_EQ(decompressed->get_allocator().resource(), &pool);
+    EXPECT_TRUE(std::ranges::equal(*decompressed, binary_data));
+
+    auto stored = dp::compression_engine::decompress(text_data, dp::compression_method::none, text_data.size(), &pool);
+    ASSERT_TRUE(stored.has_value());
+    EXPECT_TRUE(std::ranges::equal(*stored, text_data));
+}
+
+TEST_F(CompressionTest, DecompressIntoCallerBuffer) {
+    auto compressed = dp::compression_engine::compress(binary_data, dp::compression_method::deflate);
+    ASSERT_TRUE(compressed.has_value());
+
+    std::vector<std::byte> out(binary_data.size());
+    auto written = dp::compression_engine::decompress_into(*compressed, dp::compression_method::deflate, out);
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(*written, binary_data.size());
+    EXPECT_EQ(out, binary_data);
+
+    std::vector<std::byte> small(binary_data.size() - 1);
+    written = dp::compression_engine::decompress_into(*compressed, dp::compression_method::deflate, small);
+    EXPECT_EQ(written.error(), dp::compression_error::buffer_too_small);
+
+    written = dp::compression_engine::decompress_into(text_data, dp::compression_method::none,
+                                                      std::span(small).first(text_data.size() - 1));
+    EXPECT_EQ(written.error(), dp::compression_error::buffer_too_small);
+
+    auto empty = dp::compression_engine::compress({}, dp::compression_method::deflate);
+    ASSERT_TRUE(empty.has_value());
+    written = dp::compression_engine::decompress_into(*empty, dp::compression_method::deflate, {});
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(*written, 0u);
+}
+
 TEST_F(CompressionTest, NoCompression) {
     auto result = dp::compression_engine::compress(text_data, dp::compression_method::none);
     ASSERT_TRUE(result.has_value());
@@ -83,4 +129,36 @@ TEST_F(CompressionTest, EmptyData) {
         compressed.value(), dp::compression_method::deflate, 0);
     ASSERT_TRUE(decompressed.has_value());
     EXPECT_TRUE(decompressed.value().empty());
-}
\ No newline at end of file
+}
+
+TEST_F(CompressionTest, InflateStreamInPieces) {
+    std::vector<std::byte> data(50000);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::byte>((i * 7) % 13 + (i / 1000));
+    }
+    auto compressed = dp::compression_engine::compress(data, dp::compression_method::deflate);
+    ASSERT_TRUE(compressed.has_value());
+
+    // Feed 100 input bytes at a time into 333-byte outputs
+    dp::inflate_stream inflater;
+    std::vector<std::byte> out;
+    std::span<const std::byte> remaining(*compressed);
+    while (!inflater.finished()) {
+        std::span<const std::byte> input = remaining.first(std::min<std::size_t>(100, remaining.size()));
+        const auto before = input.size();
+        std::array<std::byte, 333> window;
+        auto written = inflater.decompress(input, window);
+        ASSERT_TRUE(written.has_value());
+        remaining = remaining.subspan(before - input.size());
+        out.insert(out.end(), window.begin(), window.begin() + static_cast<std::ptrdiff_t>(*written));
+        ASSERT_TRUE(*written > 0 || before != input.size() || inflater.finished());
+    }
+    EXPECT_EQ(out, data);
+    EXPECT_TRUE(remaining.empty());
+
+    dp::inflate_stream corrupt;
+    std::vector<std::byte> garbage(64, std::byte{0xff});
+    std::span<const std::byte> input(garbage);
+    std::array<std::byte, 64> window;
+    EXPECT_FALSE(corrupt.decompress(input, window).has_value());
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <datapak/delta.hpp>
+#include <datapak/hash.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::byte> make_data(std::size_t size, std::uint32_t seed) {
+    std::vector<std::byte> data(size);
+    std::uint32_t state = seed;
+    for (auto& byte : data) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::byte>(state >> 24);
+    }
+    return data;
+}
+
+std::istringstream as_stream(const std::vector<std::byte>& data) {
+    return std::istringstream(std::string(reinterpret_cast<const char*>(data.data()), data.size()));
+}
+
+dp::delta_reference reference_for(const std::vector<std::byte>& base) {
+    return {"assets/level.bin", base.size(), dp::content_hash(base)};
+}
+
+} // namespace
+
+TEST(DeltaTest, RoundTripSmallEdit) {
+    const auto base = make_data(64 * 1024, 1);
+    auto target = base;
+
+    // Overwrite a few bytes, insert a run and drop a run
+    target[100] ^= std::byte{0xFF};
+    const auto insert = make_data(200, 2);
+    target.insert(target.begin() + 20000, insert.begin(), insert.end());
+    target.erase(target.begin() + 40000, target.begin() + 40500);
+
+    const auto reference = reference_for(base);
+    auto delta = dp::make_delta(base, target, reference);
+    ASSERT_TRUE(delta.has_value());
+
+    // Random data does not deflate, so only the copies keep the delta small
+    EXPECT_LT(delta->size(), 1024u);
+
+    auto parsed = dp::read_delta_reference(*delta);
+    ASSERT_TRUE(parsed.has_value());
+    EXPECT_EQ(parsed->base_path, reference.base_path);
+    EXPECT_EQ(parsed->base_size, reference.base_size);
+    EXPECT_EQ(parsed->base_checksum, reference.base_checksum);
+
+    auto stream = as_stream(base);
+    auto decoded = dp::apply_delta(*delta, stream, target.size());
+    ASSERT_TRUE(decoded.has_value());
+    EXPECT_EQ(*decoded, target);
+}
+
+TEST(DeltaTest, UnrelatedAndEmptyTargets) {
+    const auto base = make_data(4096, 3);
+
+    for (const auto& target : {make_data(5000, 4), std::vector<std::byte>{}, make_data(10, 5)}) {
+        auto delta = dp::make_delta(base, target, reference_for(base));
+        ASSERT_TRUE(delta.has_value());
+
+        auto stream = as_stream(base);
+        auto decoded = dp::apply_delta(*delta, stream, target.size());
+        ASSERT_TRUE(decoded.has_value());
+        EXPECT_EQ(*decoded, target);
+    }
+}
+
+TEST(DeltaTest, BaseMatchesChecksSizeAndChecksum) {
+    const auto base = make_data(1000, 6);
+    const auto reference = reference_for(base);
+
+    EXPECT_TRUE(dp::delta_base_matches(reference, base.size(), std::nullopt));
+    EXPECT_TRUE(dp::delta_base_matches(reference, base.size(), dp::entry_metadata{reference.base_checksum, 0}));
+    EXPECT_FALSE(dp::delta_base_matches(reference, base.size() + 1, std::nullopt));
+    EXPECT_FALSE(dp::delta_base_matches(reference, base.size(), dp::entry_metadata{reference.base_checksum + 1, 0}));
+}
+
+TEST(DeltaTest, RejectsMalformedBlobs) {
+    const auto base = make_data(4096, 7);
+    auto target = base;
+    target[2000] ^= std::byte{1};
+
+    auto delta = dp::make_delta(base, target, reference_for(base));
+    ASSERT_TRUE(delta.has_value());
+
+    // Truncated header
+    const std::vector<std::byte> truncated(delta->begin(), delta->begin() + 8);
+    EXPECT_FALSE(dp::read_delta_reference(truncated).has_value());
+
+    // Wrong magic
+    auto bad_magic = *delta;
+    bad_magic[0] ^= std::byte{0xFF};
+    EXPECT_FALSE(dp::read_delta_reference(bad_magic).has_value());
+
+    // Wrong target size
+    auto stream = as_stream(base);
+    EXPECT_FALSE(dp::apply_delta(*delta, stream, target.size() + 1).has_value());
+
+    // Base shorter than the copies need
+    const std::vector<std::byte> short_base(base.begin(), base.begin() + 100);
+    auto short_stream = as_stream(short_base);
+    EXPECT_FALSE(dp::apply_delta(*delta, short_stream, target.size()).has_value());
+}
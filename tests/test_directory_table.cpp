@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <datapak/directory_table.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+
+dp::directory_record make_record(std::uint64_t offset) {
+    dp::directory_record record{};
+    record.data_offset = offset;
+    record.compressed_size = offset + 1;
+    record.uncompressed_size = offset + 2;
+    record.compression = dp::compression_method::deflate;
+    return record;
+}
+
+} // namespace
+
+TEST(DirectoryTableTest, FindsEveryEntry) {
+    std::vector<std::string> paths;
+    for (int i = 0; i < 5000; ++i) {
+        paths.push_back("assets/dir" + std::to_string(i % 37) + "/file" + std::to_string(i) + ".bin");
+    }
+
+    dp::directory_table table;
+    table.reserve(paths.size(), 0);
+    for (std::size_t i = 0; i < paths.size(); ++i) {
+        ASSERT_TRUE(table.push_back(paths[i], make_record(i * 16)));
+    }
+    table.build_index();
+
+    ASSERT_EQ(table.size(), paths.size());
+    for (std::uint32_t i = 0; i < paths.size(); ++i) {
+        const auto found = table.find(dp::path_key{paths[i]});
+        ASSERT_TRUE(found.has_value()) << paths[i];
+        EXPECT_EQ(*found, i);
+        EXPECT_EQ(table.name(i), paths[i]);
+        EXPECT_EQ(table[i].data_offset, i * 16u);
+        EXPECT_EQ(table[i].uncompressed_size, i * 16u + 2);
+        EXPECT_EQ(table[i].compression, dp::compression_method::deflate);
+    }
+
+    EXPECT_FALSE(table.find(dp::path_key{"assets/dir0/file1.bin"}).has_value());
+    EXPECT_FALSE(table.find(dp::path_key{""}).has_value());
+}
+
+TEST(DirectoryTableTest, EmptyNamesAndDuplicates) {
+    dp::directory_table table;
+    EXPECT_FALSE(table.find(dp::path_key{"a"}).has_value());
+
+    table.push_back("a", make_record(1));
+    table.push_back("", make_record(2));
+    table.push_back("a", make_record(3));
+    table.build_index();
+
+    EXPECT_EQ(table.size(), 3u);
+    EXPECT_EQ(table.find(dp::path_key{"a"}), 2u);
+    EXPECT_EQ(table.name(1), "");
+
+    table.clear();
+    EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(DirectoryTableTest, MemoryUsageIsCompact) {
+    constexpr std::size_t count = 10000;
+    std::size_t path_bytes = 0;
+
+    dp::directory_table table;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto path = "textures/environment/forest/bark_" + std::to_string(i) + ".ktx2";
+        path_bytes += path.size();
+        table.push_back(path, make_record(i));
+    }
+    table.build_index();
+
+    // 32-byte record plus at most 16 bytes of index per entry on top of the path
+    EXPECT_LE(table.memory_usage(), path_bytes + count * (sizeof(dp::directory_record) + 16));
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <datapak/filter.hpp>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+std::vector<std::byte> noise(std::size_t size, std::uint32_t seed) {
+    std::vector<std::byte> data(size);
+    for (auto& byte : data) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = static_cast<std::byte>(seed >> 24);
+    }
+    return data;
+}
+
+/**
+ * @brief Table of slowly changing floats, like vertex positions or samples
+ */
+std::vector<std::byte> float_table(std::size_t count) {
+    std::vector<std::byte> data(count * sizeof(float));
+    for (std::size_t i = 0; i < count; ++i) {
+        const float value = 100.0f * std::sin(static_cast<float>(i) * 0.001f);
+        std::memcpy(data.data() + i * sizeof(float), &value, sizeof(float));
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(FilterTest, RoundTripsEverySize) {
+    // Sizes around the 16-element SIMD blocks, with and without partial elements
+    const auto data = noise(1000, 1);
+    for (const auto filter : {dp::filter_type::none, dp::filter_type::shuffle, dp::filter_type::delta,
+                              dp::filter_type::bcj_x86}) {
+        for (const std::size_t element_size : {1, 2, 3, 4, 5, 7, 8, 9, 16, 255}) {
+            for (const std::size_t size : {0, 1, 15, 16, 17, 63, 64, 129, 255, 256, 1000}) {
+                const auto input = std::span(data).first(size);
+                const auto filtered = dp::apply_filter(input, filter, element_size);
+                ASSERT_EQ(filtered.size(), size);
+
+                std::vector<std::byte> restored(size);
+                ASSERT_TRUE(dp::reverse_filter(filtered, filter, element_size, restored));
+                EXPECT_TRUE(std::ranges::equal(restored, input))
+                    << "filter " << static_cast<int>(filter) << " element size " << element_size << " size " << size;
+            }
+        }
+    }
+}
+
+TEST(FilterTest, ShuffleAndDeltaLayout) {
+    const std::vector<std::byte> data{std::byte{1}, std::byte{2}, std::byte{3}, std::byte{4}, std::byte{5}};
+
+    // Two 2-byte elements become plane 0, plane 1; the odd byte stays last
+    EXPECT_EQ(dp::apply_filter(data, dp::filter_type::shuffle, 2),
+              (std::vector<std::byte>{std::byte{1}, std::byte{3}, std::byte{2}, std::byte{4}, std::byte{5}}));
+    EXPECT_EQ(dp::apply_filter(data, dp::filter_type::delta, 1),
+              (std::vector<std::byte>{std::byte{1}, std::byte{1}, std::byte{1}, std::byte{1}, std::byte{1}}));
+    EXPECT_EQ(dp::apply_filter(data, dp::filter_type::delta, 2),
+              (std::vector<std::byte>{std::byte{1}, std::byte{2}, std::byte{2}, std::byte{2}, std::byte{2}}));
+}
+
+TEST(FilterTest, BranchTargetsBecomeAbsolute) {
+    // Two calls to the same function from different places
+    std::vector<std::byte> code(64, std::byte{0x90});
+    const auto call = [&](std::size_t at, std::int32_t target) {
+        const std::int32_t relative = target - static_cast<std::int32_t>(at + 5);
+        code[at] = std::byte{0xE8};
+        std::memcpy(code.data() + at + 1, &relative, sizeof(relative));
+    };
+    call(3, 40);
+    call(20, 40);
+
+    const auto filtered = dp::apply_filter(code, dp::filter_type::bcj_x86, 1);
+    EXPECT_TRUE(std::equal(filtered.begin() + 3, filtered.begin() + 8, filtered.begin() + 20));
+
+    std::vector<std::byte> restored(code.size());
+    ASSERT_TRUE(dp::reverse_filter(filtered, dp::filter_type::bcj_x86, 1, restored));
+    EXPECT_EQ(restored, code);
+}
+
+TEST(FilterTest, ShuffleImprovesFloatCompression) {
+    const auto table = float_table(64 * 1024);
+
+    auto plain = dp::compression_engine::compress(table, dp::compression_method::deflate);
+    auto shuffled = dp::make_filtered(table, dp::filter_type::shuffle, 4);
+    ASSERT_TRUE(plain.has_value());
+    ASSERT_TRUE(shuffled.has_value());
+    EXPECT_LT(shuffled->size(), plain->size());
+
+    std::vector<std::byte> out(table.size());
+    ASSERT_TRUE(dp::decode_filtered(*shuffled, out).has_value());
+    EXPECT_EQ(out, table);
+}
+
+TEST(FilterTest, RejectsInvalidBlobs) {
+    const auto data = noise(100, 2);
+    EXPECT_FALSE(dp::make_filtered(data, dp::filter_type::shuffle, 0).has_value());
+    EXPECT_FALSE(dp::make_filtered(data, dp::filter_type::delta, 256).has_value());
+    EXPECT_FALSE(dp::make_filtered(data, dp::filter_type::delta, 1, dp::compression_method::chunked).has_value());
+
+    auto blob = dp::make_filtered(data, dp::filter_type::delta, 4, dp::compression_method::none);
+    ASSERT_TRUE(blob.has_value());
+    std::vector<std::byte> out(data.size());
+    ASSERT_TRUE(dp::decode_filtered(*blob, out).has_value());
+    EXPECT_EQ(out, data);
+
+    std::vector<std::byte> short_out(data.size() - 1);
+    EXPECT_FALSE(dp::decode_filtered(*blob, short_out).has_value());
+    EXPECT_FALSE(dp::decode_filtered(std::span(*blob).first(3), out).has_value());
+
+    (*blob)[0] = std::byte{0x7f}; // unknown filter
+    EXPECT_FALSE(dp::decode_filtered(*blob, out).has_value());
+}
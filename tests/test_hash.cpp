@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <datapak/hash.hpp>
+#include <array>
+#include <cstring>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::uint64_t hash_string(std::string_view text) {
+    return dp::content_hash(std::as_bytes(std::span(text.data(), text.size())));
+}
+
+} // namespace
+
+TEST(HashTest, ContentHashMatchesReferenceVectors) {
+    // Published XXH64 (seed 0) results
+    EXPECT_EQ(hash_string(""), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(hash_string("a"), 0xD24EC4F1A98C6E5BULL);
+    EXPECT_EQ(hash_string("abc"), 0x44BC2CF5AD770999ULL);
+    EXPECT_EQ(hash_string("Nobody inspects the spammish repetition"), 0xFBCEA83C8A378BF1ULL);
+}
+
+TEST(HashTest, SeededContentHashMatchesReferenceVectors) {
+    // Published XXH64 results for seed 2654435761
+    const auto seeded = [](std::string_view text) {
+        return dp::content_hash(std::as_bytes(std::span(text.data(), text.size())), 2654435761ULL);
+    };
+    EXPECT_EQ(seeded(""), 0xAC75FDA2929B17EFULL);
+    EXPECT_EQ(seeded("Nobody inspects the spammish repetition"), 0x56DB22DD5B051147ULL);
+    EXPECT_NE(seeded("abc"), hash_string("abc"));
+}
+
+TEST(HashTest, ContentHashCoversEveryByte) {
+    std::vector<std::byte> data(1000);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::byte>(i * 31);
+    }
+
+    const auto original = dp::content_hash(data);
+    for (const std::size_t position : {0u, 31u, 32u, 500u, 996u, 999u}) {
+        auto changed = data;
+        changed[position] ^= std::byte{1};
+        EXPECT_NE(dp::content_hash(changed), original) << position;
+    }
+
+    // Length is part of the hash, so trailing zeros are not ignored
+    auto longer = data;
+    longer.push_back(std::byte{0});
+    EXPECT_NE(dp::content_hash(longer), original);
+}
+
+TEST(HashTest, PathHashIsConstexpr) {
+    static_assert(dp::static_path_hash("a/b.txt") == dp::path_hash("a/b.txt"));
+    EXPECT_EQ(dp::path_key{"a/b.txt"}.hash, dp::path_hash("a/b.txt"));
+}
+
+TEST(HashTest, PathHashSameAtCompileTimeAndRuntime) {
+    // Prefix lengths cover the short, 16-byte and 48-byte code paths
+    static constexpr std::string_view text =
+        "characters/hero/animations/locomotion/run_forward_loop_v2.anim"
+        "environments/forest/textures/bark_albedo_2048.ktx2/extra/tail";
+    static constexpr auto expected = [] {
+        std::array<std::uint64_t, text.size() + 1> hashes{};
+        for (std::size_t n = 0; n <= text.size(); ++n) {
+            hashes[n] = dp::path_hash(text.substr(0, n));
+        }
+        return hashes;
+    }();
+
+    std::set<std::uint64_t> distinct;
+    for (std::size_t n = 0; n <= text.size(); ++n) {
+        // Copy so runtime loads read from a differently aligned buffer
+        const std::string copy(text.substr(0, n));
+        EXPECT_EQ(dp::path_hash(copy), expected[n]) << n;
+        distinct.insert(expected[n]);
+    }
+    EXPECT_EQ(distinct.size(), text.size() + 1);
+}
+
+TEST(HashTest, PathHashCoversEveryByte) {
+    for (const std::size_t length : {3u, 7u, 16u, 17u, 48u, 49u, 100u}) {
+        const std::string path(length, 'x');
+        const auto original = dp::path_hash(path);
+        for (std::size_t position = 0; position < length; ++position) {
+            auto changed = path;
+            changed[position] = 'y';
+            EXPECT_NE(dp::path_hash(changed), original) << length << ":" << position;
+        }
+    }
+}
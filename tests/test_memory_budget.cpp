@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <datapak/memory_budget.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+TEST(MemoryBudgetTest, ReservationsReturnBytes) {
+    dp::memory_budget budget(100);
+
+    auto first = budget.acquire(60);
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->bytes(), 60u);
+    EXPECT_EQ(budget.in_use(), 60u);
+
+    {
+        auto second = budget.acquire(40);
+        ASSERT_TRUE(second.has_value());
+        EXPECT_EQ(budget.in_use(), 100u);
+    }
+    EXPECT_EQ(budget.in_use(), 60u);
+
+    first->reset();
+    EXPECT_EQ(budget.in_use(), 0u);
+
+    // Moving transfers ownership without returning the bytes twice
+    auto moved = budget.acquire(10);
+    ASSERT_TRUE(moved.has_value());
+    auto target = std::move(*moved);
+    moved.reset();
+    EXPECT_EQ(budget.in_use(), 10u);
+    target.reset();
+    EXPECT_EQ(budget.in_use(), 0u);
+}
+
+TEST(MemoryBudgetTest, ShrinkReturnsPart) {
+    dp::memory_budget budget(100);
+    auto reservation = budget.acquire(80);
+    ASSERT_TRUE(reservation.has_value());
+
+    reservation->shrink_to(30);
+    EXPECT_EQ(reservation->bytes(), 30u);
+    EXPECT_EQ(budget.in_use(), 30u);
+
+    reservation->shrink_to(50); // never grows
+    EXPECT_EQ(budget.in_use(), 30u);
+
+    reservation.reset();
+    EXPECT_EQ(budget.in_use(), 0u);
+}
+
+TEST(MemoryBudgetTest, OversizedRequestTakesWholeBudget) {
+    dp::memory_budget budget(100);
+
+    auto big = budget.acquire(1000);
+    ASSERT_TRUE(big.has_value());
+    EXPECT_EQ(big->bytes(), 100u);
+    EXPECT_EQ(budget.in_use(), 100u);
+}
+
+TEST(MemoryBudgetTest, DeadlineFailsFast) {
+    dp::memory_budget budget(100);
+    auto held = budget.acquire(80);
+    ASSERT_TRUE(held.has_value());
+
+    EXPECT_FALSE(budget.acquire(50, std::chrono::steady_clock::now()).has_value());
+    EXPECT_FALSE(budget.acquire(50, std::chrono::steady_clock::now() + 20ms).has_value());
+    EXPECT_EQ(budget.in_use(), 80u);
+
+    // A request that fits is admitted even with an expired deadline
+    EXPECT_TRUE(budget.acquire(20, std::chrono::steady_clock::now()).has_value());
+}
+
+TEST(MemoryBudgetTest, ReleaseWakesWaiter) {
+    dp::memory_budget budget(100);
+    auto held = budget.acquire(100);
+    ASSERT_TRUE(held.has_value());
+
+    std::atomic<bool> admitted = false;
+    std::thread waiter([&] {
+        auto reservation = budget.acquire(50);
+        admitted = reservation.has_value();
+    });
+
+    std::this_thread::sleep_for(20ms);
+    EXPECT_FALSE(admitted);
+    held->reset();
+    waiter.join();
+    EXPECT_TRUE(admitted);
+    EXPECT_EQ(budget.in_use(), 0u);
+}
+
+TEST(MemoryBudgetTest, SmallRequestDoesNotOvertakeWaiter) {
+    dp::memory_budget budget(100);
+    auto held = budget.acquire(50);
+    ASSERT_TRUE(held.has_value());
+
+    std::atomic<bool> admitted = false;
+    std::thread large([&] {
+        auto reservation = budget.acquire(90);
+        admitted = reservation.has_value();
+    });
+    std::this_thread::sleep_for(20ms);
+
+    // Would fit next to the held bytes, but the large request arrived first
+    EXPECT_FALSE(budget.acquire(10, std::chrono::steady_clock::now() + 20ms).has_value());
+    EXPECT_FALSE(admitted);
+
+    held->reset();
+    large.join();
+    EXPECT_TRUE(admitted);
+    EXPECT_TRUE(budget.acquire(10, std::chrono::steady_clock::now()).has_value());
+}
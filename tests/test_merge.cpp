@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <datapak/merge.hpp>
+#include <datapak/vfs.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <string>
+
+class MergeTest : public ::testing::Test {
+protected:
+    std::filesystem::path base_path;
+    std::filesystem::path patch_path;
+    std::filesystem::path merged_path;
+    std::string level;
+
+    void SetUp() override {
+        const auto temp = std::filesystem::temp_directory_path();
+        base_path = temp / "merge_base.pak";
+        patch_path = temp / "merge_patch.pak";
+        merged_path = temp / "merge_out.pak";
+
+        // Incompressible, so the patch stores the edited level as a delta
+        level.resize(128 * 1024);
+        std::uint32_t state = 5;
+        for (auto& c : level) {
+            state = state * 1664525u + 1013904223u;
+            c = static_cast<char>(state >> 24);
+        }
+
+        dp::archive_builder base;
+        base.add_buffer("a.txt", text("unchanged"));
+        base.add_buffer("level.bin", text(level));
+        base.add_buffer("removed.txt", text("deleted by the patch"));
+        ASSERT_TRUE(base.build(base_path).has_value());
+
+        level.replace(5000, 6, "edited");
+
+        dp::archive_builder patch;
+        patch.add_buffer("a.txt", text("unchanged"));
+        patch.add_buffer("level.bin", text(level));
+        patch.add_buffer("new.txt", text("added by the patch"));
+        ASSERT_TRUE(patch.set_patch_base(base_path).has_value());
+        ASSERT_TRUE(patch.build(patch_path).has_value());
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(base_path);
+        std::filesystem::remove(patch_path);
+        std::filesystem::remove(merged_path);
+    }
+
+    static std::vector<std::byte> text(const std::string& value) {
+        const auto bytes = std::as_bytes(std::span(value.data(), value.size()));
+        return {bytes.begin(), bytes.end()};
+    }
+
+    static std::string read(const dp::archive& arch, std::string_view name) {
+        auto stream = arch.open(name);
+        if (!stream) {
+            return "<missing>";
+        }
+        return {std::istreambuf_iterator<char>(**stream), {}};
+    }
+};
+
+TEST_F(MergeTest, CollapsesPatchChain) {
+    const std::vector<std::shared_ptr<const dp::archive>> inputs{
+        std::make_shared<dp::archive>(base_path), std::make_shared<dp::archive>(patch_path)};
+    ASSERT_EQ(inputs[1]->stat("level.bin")->compression, dp::compression_method::delta);
+
+    auto stats = dp::merge(inputs, merged_path);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->copied, 2u);
+    EXPECT_EQ(stats->materialized, 1u);
+    EXPECT_EQ(stats->shadowed, 2u);
+
+    dp::archive merged(merged_path);
+    EXPECT_EQ(merged.list_files(), (std::vector<std::string>{"a.txt", "level.bin", "new.txt"}));
+    EXPECT_EQ(read(merged, "a.txt"), "unchanged");
+    EXPECT_EQ(read(merged, "level.bin"), level);
+    EXPECT_EQ(read(merged, "new.txt"), "added by the patch");
+    EXPECT_EQ(merged.stat("level.bin")->compression, dp::compression_method::deflate);
+    EXPECT_EQ(merged.tombstones(), std::vector<std::string>{"removed.txt"});
+    EXPECT_TRUE(merged.verify().empty());
+
+    EXPECT_EQ(dp::merge(inputs, patch_path).error(), dp::builder_error::invalid_path);
+}
+
+TEST_F(MergeTest, KeepsDeltasAgainstBasesOutsideTheInputs) {
+    const std::vector<std::shared_ptr<const dp::archive>> inputs{std::make_shared<dp::archive>(patch_path)};
+
+    auto stats = dp::merge(inputs, merged_path);
+    ASSERT_TRUE(stats.has_value());
+    EXPECT_EQ(stats->copied, 2u);
+    EXPECT_EQ(stats->materialized, 0u);
+
+    // The merged patch still applies on top of the base
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(base_path).has_value());
+    ASSERT_TRUE(filesystem.mount(merged_path).has_value());
+
+    auto stream = filesystem.open("level.bin");
+    ASSERT_TRUE(stream.has_value());
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(**stream), {}), level);
+    EXPECT_FALSE(filesystem.contains("removed.txt"));
+}
+
+TEST_F(MergeTest, RejectsSameSizeBaseWithoutMetadata) {
+    // A base without metadata only records sizes, so the contents are hashed
+    auto replaced = level;
+    std::ranges::reverse(replaced);
+    dp::archive_builder base;
+    base.set_entry_metadata(false);
+    base.add_buffer("level.bin", text(replaced));
+    ASSERT_TRUE(base.build(base_path).has_value());
+
+    const std::vector<std::shared_ptr<const dp::archive>> inputs{
+        std::make_shared<dp::archive>(base_path), std::make_shared<dp::archive>(patch_path)};
+    EXPECT_EQ(dp::merge(inputs, merged_path).error(), dp::builder_error::compression_error);
+}
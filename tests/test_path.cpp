@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <datapak/path.hpp>
+#include <string>
+
+namespace {
+
+std::string normalize(std::string_view path, bool fold_case = false) {
+    dp::path_buffer buffer;
+    const auto result = dp::normalize_path(path, buffer, fold_case);
+    return result ? std::string(*result) : std::string("<invalid>");
+}
+
+} // namespace
+
+TEST(PathTest, AlreadyNormalized) {
+    EXPECT_EQ(normalize("textures/ui/a.png"), "textures/ui/a.png");
+    EXPECT_EQ(normalize("a.txt"), "a.txt");
+    EXPECT_EQ(normalize(""), "");
+}
+
+TEST(PathTest, CollapsesSeparatorsAndDots) {
+    EXPECT_EQ(normalize("./Textures//UI/a.png"), "Textures/UI/a.png");
+    EXPECT_EQ(normalize("/textures/./ui/"), "textures/ui");
+    EXPECT_EQ(normalize("textures\\ui\\a.png"), "textures/ui/a.png");
+}
+
+TEST(PathTest, ResolvesParentSegments) {
+    EXPECT_EQ(normalize("textures/old/../ui/a.png"), "textures/ui/a.png");
+    EXPECT_EQ(normalize("a/b/../../c.txt"), "c.txt");
+    EXPECT_EQ(normalize("../escape.txt"), "<invalid>");
+    EXPECT_EQ(normalize("a/../../escape.txt"), "<invalid>");
+}
+
+TEST(PathTest, FoldsCase) {
+    EXPECT_EQ(normalize("./Textures//UI/A.png", true), "textures/ui/a.png");
+    EXPECT_EQ(normalize("Textures/UI/A.png", false), "Textures/UI/A.png");
+}
+
+TEST(PathTest, RejectsPathsLongerThanBuffer) {
+    std::array<char, 8> small;
+    EXPECT_FALSE(dp::normalize_path("abcdefghij", small).has_value());
+    EXPECT_TRUE(dp::normalize_path("abc/defg", small).has_value());
+}
+
+TEST(PathTest, MatchesGlobPatterns) {
+    EXPECT_TRUE(dp::match_glob("*.json", "app.json"));
+    EXPECT_TRUE(dp::match_glob("*.json", "config/deep/app.json"));
+    EXPECT_FALSE(dp::match_glob("*.json", "app.json.bak"));
+    EXPECT_TRUE(dp::match_glob("textures/*", "textures/ui/button.png"));
+    EXPECT_FALSE(dp::match_glob("textures/*", "sounds/ui.ogg"));
+    EXPECT_TRUE(dp::match_glob("level?.bin", "level3.bin"));
+    EXPECT_FALSE(dp::match_glob("level?.bin", "level10.bin"));
+    EXPECT_TRUE(dp::match_glob("*a*b*", "xxaxxbxx"));
+    EXPECT_TRUE(dp::match_glob("*", ""));
+    EXPECT_FALSE(dp::match_glob("", "a"));
+    EXPECT_TRUE(dp::match_glob("exact.txt", "exact.txt"));
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <datapak/recompress.hpp>
+#include <filesystem>
+#include <iterator>
+#include <string>
+
+class RecompressTest : public ::testing::Test {
+protected:
+    std::filesystem::path input_path;
+    std::filesystem::path output_path;
+
+    void SetUp() override {
+        input_path = std::filesystem::temp_directory_path() / "recompress_input.pak";
+        output_path = std::filesystem::temp_directory_path() / "recompress_output.pak";
+        std::filesystem::remove(input_path);
+        std::filesystem::remove(output_path);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(input_path);
+        std::filesystem::remove(output_path);
+    }
+
+    static std::vector<std::byte> text(const std::string& value) {
+        const auto bytes = std::as_bytes(std::span(value.data(), value.size()));
+        return {bytes.begin(), bytes.end()};
+    }
+
+    static std::string read(const dp::archive& arch, std::string_view name) {
+        auto stream = arch.open(name);
+        if (!stream) {
+            return "<missing>";
+        }
+        return {std::istreambuf_iterator<char>(**stream), {}};
+    }
+};
+
+TEST_F(RecompressTest, ReencodesMatchingEntriesAndCopiesTheRest) {
+    const std::string json(2000, '{');
+    const std::string image(3000, 'x');
+
+    dp::archive_builder builder(dp::compression_method::none);
+    for (int i = 0; i < 20; ++i) {
+        builder.add_buffer("config/" + std::to_string(i) + ".json", text(json));
+    }
+    builder.add_buffer("textures/ui.png", text(image));
+    builder.add_tombstone("old.json");
+    ASSERT_TRUE(builder.build(input_path).has_value());
+
+    dp::archive input(input_path);
+    dp::recompress_options options;
+    options.compression = dp::compression_method::deflate;
+    options.level = 9;
+    options.filters = {"*.json"};
+    options.threads = 3;
+
+    auto result = dp::recompress(input, output_path, options);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->recompressed, 20u);
+    EXPECT_EQ(result->copied, 1u);
+
+    dp::archive output(output_path);
+    EXPECT_EQ(output.list_files(), input.list_files());
+    EXPECT_EQ(output.tombstones(), input.tombstones());
+    EXPECT_EQ(output.stat("config/7.json")->compression, dp::compression_method::deflate);
+    EXPECT_LT(output.stat("config/7.json")->compressed_size, json.size());
+    EXPECT_EQ(output.stat("textures/ui.png")->compression, dp::compression_method::none);
+
+    for (const auto& name : input.list_files()) {
+        EXPECT_EQ(read(output, name), read(input, name)) << name;
+    }
+    EXPECT_TRUE(output.verify().empty());
+
+    // Writing over the input would destroy the blobs being copied
+    EXPECT_EQ(dp::recompress(input, input_path).error(), dp::builder_error::invalid_path);
+}
+
+TEST_F(RecompressTest, ChunkedEntriesAreStoredWhole) {
+    dp::archive_builder builder;
+    builder.set_chunk_dedup(true);
+    builder.add_buffer("a.txt", text(std::string(50000, 'a')));
+    builder.add_buffer("b.txt", text("small"));
+    ASSERT_TRUE(builder.build(input_path).has_value());
+
+    dp::archive input(input_path);
+    dp::recompress_options options;
+    options.compression = dp::compression_method::none;
+    options.filters = {"nothing-matches"};
+
+    auto result = dp::recompress(input, output_path, options);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->recompressed, 2u);
+
+    dp::archive output(output_path);
+    EXPECT_EQ(output.chunk_count(), 0u);
+    EXPECT_EQ(output.stat("a.txt")->compression, dp::compression_method::none);
+    EXPECT_EQ(read(output, "a.txt"), std::string(50000, 'a'));
+    EXPECT_EQ(read(output, "b.txt"), "small");
+}
@@ -1,8 +1,43 @@
 #include <gtest/gtest.h>
 #include <datapak/vfs.hpp>
 #include <datapak/archive_builder.hpp>
+#include <datapak/hash.hpp>
 #include <filesystem>
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <thread>
+#include <atomic>
+
+namespace {
+
+/**
+ * @brief Resource forwarding to the default resource while tracking outstanding bytes
+ */
+class counting_resource : public std::pmr::memory_resource {
+public:
+    std::size_t allocated = 0;    /**< Total bytes ever allocated */
+    std::size_t outstanding = 0;  /**< Bytes currently allocated */
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+        allocated += bytes;
+        outstanding += bytes;
+        return std::pmr::get_default_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+        outstanding -= bytes;
+        std::pmr::get_default_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+} // namespace
 
 class VFSTest : public ::testing::Test {
 protected:
@@ -244,6 +279,56 @@ TEST_F(VFSTest, DisableCaching) {
     EXPECT_EQ(filesystem.cache_size(), 0);
 }
 
+TEST_F(VFSTest, AllocatesFromMemoryResource) {
+    counting_resource resource;
+    {
+        dp::vfs filesystem(&resource);
+        ASSERT_TRUE(filesystem.mount(archive2_path, dp::access_mode::memory).has_value());
+
+        // Directory and memory-mode contents come from the resource
+        const auto after_mount = resource.allocated;
+        EXPECT_GT(after_mount, std::filesystem::file_size(archive2_path));
+
+        auto first = filesystem.open("subdir/nested.txt");
+        ASSERT_TRUE(first.has_value());
+        EXPECT_GT(resource.allocated, after_mount);
+        EXPECT_EQ(filesystem.cache_size(), 1u);
+
+        // Served from the cache, copied into another resource buffer
+        const auto after_first = resource.allocated;
+        auto second = filesystem.open("subdir/nested.txt");
+        ASSERT_TRUE(second.has_value());
+        EXPECT_GT(resource.allocated, after_first);
+
+        std::string content;
+        std::getline(**second, content);
+        EXPECT_EQ(content, "Nested file in archive 2");
+    }
+
+    EXPECT_EQ(resource.outstanding, 0u);
+}
+
+TEST_F(VFSTest, ReadIntoCallerBuffer) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(archive2_path).has_value());
+
+    std::array<std::byte, 64> out{};
+    const auto written = filesystem.read("common.txt", out);
+    ASSERT_TRUE(written.has_value());
+    EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(out.data()), *written), "Content from archive 2");
+    EXPECT_EQ(filesystem.cache_size(), 0u);
+
+    std::array<std::byte, 4> small{};
+    EXPECT_EQ(filesystem.read("common.txt", small).error(), dp::vfs_error::buffer_too_small);
+    EXPECT_EQ(filesystem.read("missing.txt", out).error(), dp::vfs_error::file_not_found);
+
+    // Cached files are served from the cache
+    ASSERT_TRUE(filesystem.open("unique1.txt").has_value());
+    EXPECT_EQ(filesystem.read("unique1.txt", out), std::string_view("Unique to archive 1").size());
+    EXPECT_EQ(filesystem.read("unique1.txt", small).error(), dp::vfs_error::buffer_too_small);
+}
+
 TEST_F(VFSTest, MemoryModeArchives) {
     dp::vfs filesystem;
 
@@ -265,4 +350,454 @@ TEST_F(VFSTest, MemoryModeArchives) {
     std::string content;
     std::getline(**stream, content);
     EXPECT_EQ(content, "Nested file in archive 2");
-}
\ No newline at end of file
+}
+TEST_F(VFSTest, LookupModeAppliesToMountedArchives) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+
+    filesystem.set_lookup_mode(dp::lookup_mode::case_insensitive);
+    ASSERT_TRUE(filesystem.mount(archive2_path).has_value());
+    EXPECT_EQ(filesystem.get_lookup_mode(), dp::lookup_mode::case_insensitive);
+
+    EXPECT_TRUE(filesystem.contains("./UNIQUE1.txt"));
+    EXPECT_TRUE(filesystem.contains("SubDir\\Nested.txt"));
+
+    auto stream = filesystem.open("Common.TXT");
+    ASSERT_TRUE(stream.has_value());
+
+    std::string content;
+    std::getline(**stream, content);
+    EXPECT_EQ(content, "Content from archive 2");
+
+    // Paths cached under the old mode must not match under the new one
+    filesystem.enable_cache();
+    ASSERT_TRUE(filesystem.open("Common.TXT").has_value());
+    EXPECT_EQ(filesystem.cache_size(), 1u);
+    filesystem.set_lookup_mode(dp::lookup_mode::exact);
+    EXPECT_EQ(filesystem.cache_size(), 0u);
+    EXPECT_FALSE(filesystem.open("Common.TXT").has_value());
+    EXPECT_FALSE(filesystem.contains("Common.TXT"));
+}
+
+TEST_F(VFSTest, ResolvedHandles) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(archive2_path).has_value());
+
+    auto id = filesystem.resolve("common.txt");
+    ASSERT_TRUE(id.has_value());
+    EXPECT_EQ(filesystem.resolve("common.txt").value(), *id);
+
+    for (int i = 0; i < 3; ++i) {
+        auto stream = filesystem.open(*id);
+        ASSERT_TRUE(stream.has_value());
+
+        std::string content;
+        std::getline(**stream, content);
+        EXPECT_EQ(content, "Content from archive 2");
+    }
+
+    auto info = filesystem.stat(*id);
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->size, std::string("Content from archive 2").size());
+
+    auto by_path = filesystem.stat("unique1.txt");
+    ASSERT_TRUE(by_path.has_value());
+    EXPECT_EQ(by_path->size, std::string("Unique to archive 1").size());
+
+    using namespace dp::literals;
+    auto literal_id = filesystem.resolve("common.txt"_dp);
+    ASSERT_TRUE(literal_id.has_value());
+    EXPECT_EQ(*literal_id, *id);
+
+    auto missing = filesystem.resolve("nonexistent.txt");
+    ASSERT_FALSE(missing.has_value());
+    EXPECT_EQ(missing.error(), dp::vfs_error::file_not_found);
+}
+
+TEST_F(VFSTest, UnmountInvalidatesHandles) {
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(archive2_path).has_value());
+
+    auto shadowing = filesystem.resolve("common.txt");
+    auto base = filesystem.resolve("unique1.txt");
+    ASSERT_TRUE(shadowing.has_value());
+    ASSERT_TRUE(base.has_value());
+
+    ASSERT_TRUE(filesystem.open("common.txt").has_value());
+    EXPECT_GT(filesystem.cache_size(), 0);
+
+    EXPECT_TRUE(filesystem.unmount(archive2_path));
+    EXPECT_FALSE(filesystem.unmount(archive2_path));
+    EXPECT_EQ(filesystem.cache_size(), 0);
+
+    auto stale = filesystem.open(*shadowing);
+    ASSERT_FALSE(stale.has_value());
+    EXPECT_EQ(stale.error(), dp::vfs_error::invalid_handle);
+    EXPECT_FALSE(filesystem.stat(*shadowing).has_value());
+
+    // Handles into archives that remain mounted keep working
+    EXPECT_TRUE(filesystem.open(*base).has_value());
+
+    // Remounting assigns a fresh identifier, so the stale handle stays invalid
+    ASSERT_TRUE(filesystem.mount(archive2_path).has_value());
+    EXPECT_FALSE(filesystem.open(*shadowing).has_value());
+
+    auto stream = filesystem.open("common.txt");
+    ASSERT_TRUE(stream.has_value());
+    std::string content;
+    std::getline(**stream, content);
+    EXPECT_EQ(content, "Content from archive 2");
+}
+
+TEST_F(VFSTest, PatchArchiveOverBase) {
+    const auto patch_path = std::filesystem::temp_directory_path() / "archive_patch.pak";
+
+    // A file present, unchanged, in both versions
+    for (const auto& dir : {test_dir1, test_dir2}) {
+        std::ofstream file(dir / "same.txt");
+        file << "Identical in both versions";
+    }
+    dp::archive_builder base_builder;
+    base_builder.add_directory(test_dir1);
+    ASSERT_TRUE(base_builder.build(archive1_path).has_value());
+
+    dp::archive_builder patch_builder;
+    patch_builder.add_directory(test_dir2);
+    ASSERT_TRUE(patch_builder.set_patch_base(archive1_path).has_value());
+    ASSERT_TRUE(patch_builder.build(patch_path).has_value());
+
+    {
+        dp::archive patch(patch_path);
+        EXPECT_EQ(patch.list_files(), (std::vector<std::string>{"common.txt", "subdir/nested.txt", "unique2.txt"}));
+        EXPECT_EQ(patch.tombstones(), std::vector<std::string>{"unique1.txt"});
+        EXPECT_TRUE(patch.has_tombstone("unique1.txt"));
+        EXPECT_FALSE(patch.has_tombstone("same.txt"));
+    }
+
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(patch_path).has_value());
+
+    EXPECT_EQ(filesystem.list_files(),
+              (std::vector<std::string>{"common.txt", "same.txt", "subdir/nested.txt", "unique2.txt"}));
+
+    const auto read = [&](std::string_view name) {
+        auto stream = filesystem.open(name);
+        std::string content;
+        if (stream) {
+            std::getline(**stream, content);
+        }
+        return content;
+    };
+
+    EXPECT_EQ(read("common.txt"), "Content from archive 2");
+    EXPECT_EQ(read("same.txt"), "Identical in both versions");
+    EXPECT_EQ(read("unique2.txt"), "Unique to archive 2");
+    EXPECT_FALSE(filesystem.contains("unique1.txt"));
+    EXPECT_EQ(filesystem.resolve("unique1.txt").error(), dp::vfs_error::file_not_found);
+
+    // Tombstones respect the lookup mode
+    filesystem.set_lookup_mode(dp::lookup_mode::case_insensitive);
+    EXPECT_FALSE(filesystem.contains("./UNIQUE1.txt"));
+    EXPECT_TRUE(filesystem.contains("./SAME.txt"));
+
+    // With the base taking precedence, the tombstone no longer applies
+    filesystem.set_lookup_mode(dp::lookup_mode::exact);
+    filesystem.set_search_order(dp::search_order::mount_order);
+    EXPECT_TRUE(filesystem.contains("unique1.txt"));
+
+    std::filesystem::remove(patch_path);
+}
+
+TEST_F(VFSTest, PatchBuildInvokesCallbacksOnce) {
+    const auto patch_path = std::filesystem::temp_directory_path() / "archive_callback_patch.pak";
+    const auto bytes = [](std::string_view text) {
+        const auto* first = reinterpret_cast<const std::byte*>(text.data());
+        return std::vector<std::byte>(first, first + text.size());
+    };
+
+    dp::archive_builder base_builder;
+    base_builder.add_buffer("changed.txt", bytes("Old generated contents"));
+    base_builder.add_buffer("same.txt", bytes("Identical in both versions"));
+    base_builder.add_buffer("encoded.txt", bytes("Old encoded contents"));
+    ASSERT_TRUE(base_builder.build(archive1_path).has_value());
+
+    int changed_calls = 0;
+    int same_calls = 0;
+    int encoded_calls = 0;
+    dp::archive_builder patch_builder;
+    patch_builder.add_generator("changed.txt", [&]() -> std::expected<std::vector<std::byte>, dp::builder_error> {
+        ++changed_calls;
+        return bytes("New generated contents!");
+    });
+    patch_builder.add_generator("same.txt", [&]() -> std::expected<std::vector<std::byte>, dp::builder_error> {
+        ++same_calls;
+        return bytes("Identical in both versions");
+    });
+    patch_builder.add_encoded("encoded.txt", dp::compression_method::none,
+                              [&]() -> std::expected<dp::encoded_blob, dp::builder_error> {
+        ++encoded_calls;
+        auto data = bytes("New encoded contents");
+        const auto checksum = dp::content_hash(data);
+        const auto size = data.size();
+        return dp::encoded_blob{std::move(data), size, checksum};
+    });
+    ASSERT_TRUE(patch_builder.set_patch_base(archive1_path).has_value());
+    ASSERT_TRUE(patch_builder.build(patch_path).has_value());
+
+    EXPECT_EQ(changed_calls, 1);
+    EXPECT_EQ(same_calls, 1);
+    EXPECT_EQ(encoded_calls, 1);
+    EXPECT_EQ(dp::archive(patch_path).list_files(), (std::vector<std::string>{"changed.txt", "encoded.txt"}));
+
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(patch_path).has_value());
+    EXPECT_EQ(*filesystem.read(*filesystem.resolve("changed.txt")), bytes("New generated contents!"));
+    EXPECT_EQ(*filesystem.read(*filesystem.resolve("encoded.txt")), bytes("New encoded contents"));
+
+    std::filesystem::remove(patch_path);
+}
+
+TEST_F(VFSTest, PatchStoresChangedFilesAsDeltas) {
+    const auto patch_path = std::filesystem::temp_directory_path() / "archive_delta_patch.pak";
+
+    // Incompressible contents, so only a delta keeps the patch entry small
+    std::vector<char> contents(256 * 1024);
+    std::uint32_t state = 42;
+    for (auto& byte : contents) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<char>(state >> 24);
+    }
+    {
+        std::ofstream file(test_dir1 / "level.bin", std::ios::binary);
+        file.write(contents.data(), contents.size());
+    }
+    std::copy_n("edited", 6, contents.begin() + 1000);
+    {
+        std::ofstream file(test_dir2 / "level.bin", std::ios::binary);
+        file.write(contents.data(), contents.size());
+    }
+
+    dp::archive_builder base_builder;
+    base_builder.add_directory(test_dir1);
+    ASSERT_TRUE(base_builder.build(archive1_path).has_value());
+
+    dp::archive_builder patch_builder;
+    patch_builder.add_directory(test_dir2);
+    ASSERT_TRUE(patch_builder.set_patch_base(archive1_path).has_value());
+    ASSERT_TRUE(patch_builder.build(patch_path).has_value());
+
+    {
+        dp::archive patch(patch_path);
+        auto info = patch.stat("level.bin");
+        ASSERT_TRUE(info.has_value());
+        EXPECT_EQ(info->compression, dp::compression_method::delta);
+        EXPECT_EQ(info->size, contents.size());
+        EXPECT_LT(info->compressed_size, 1024u);
+
+        // Without a base the entry cannot be decoded
+        EXPECT_FALSE(patch.open("level.bin").has_value());
+
+        patch.set_delta_base(std::make_shared<dp::archive>(archive1_path));
+        auto stream = patch.open("level.bin");
+        ASSERT_TRUE(stream.has_value());
+        const std::string standalone{std::istreambuf_iterator<char>(**stream), {}};
+        EXPECT_EQ(standalone, std::string(contents.data(), contents.size()));
+    }
+
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(patch_path).has_value());
+
+    auto id = filesystem.resolve("level.bin");
+    ASSERT_TRUE(id.has_value());
+    auto data = filesystem.read(*id);
+    ASSERT_TRUE(data.has_value());
+    ASSERT_EQ(data->size(), contents.size());
+    EXPECT_EQ(std::memcmp(data->data(), contents.data(), contents.size()), 0);
+
+    auto stream = filesystem.open("level.bin");
+    ASSERT_TRUE(stream.has_value());
+    const std::string mounted{std::istreambuf_iterator<char>(**stream), {}};
+    EXPECT_EQ(mounted, std::string(contents.data(), contents.size()));
+
+    // Deltas fall back to a fully decoded stream
+    auto sequential = filesystem.open_sequential("level.bin");
+    ASSERT_TRUE(sequential.has_value());
+    EXPECT_EQ(std::string(std::istreambuf_iterator<char>(**sequential), {}), std::string(contents.data(), contents.size()));
+
+    std::vector<char> out(contents.size());
+    EXPECT_EQ(filesystem.read("level.bin", std::as_writable_bytes(std::span(out))), contents.size());
+    EXPECT_EQ(out, contents);
+
+    // The base must rank below the patch; on its own the delta is unreadable
+    filesystem.set_search_order(dp::search_order::mount_order);
+    ASSERT_TRUE(filesystem.unmount(archive1_path));
+    EXPECT_FALSE(filesystem.open("level.bin").has_value());
+
+    std::filesystem::remove(patch_path);
+}
+
+TEST_F(VFSTest, DeltaRejectsSameSizeBaseWithoutMetadata) {
+    const auto patch_path = std::filesystem::temp_directory_path() / "archive_delta_wrong_base.pak";
+
+    std::vector<char> contents(64 * 1024);
+    std::uint32_t state = 7;
+    for (auto& byte : contents) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<char>(state >> 24);
+    }
+    const auto write_level = [](const std::filesystem::path& path, const std::vector<char>& bytes) {
+        std::ofstream file(path, std::ios::binary);
+        file.write(bytes.data(), bytes.size());
+    };
+    write_level(test_dir1 / "level.bin", contents);
+    auto edited = contents;
+    std::copy_n("edited", 6, edited.begin() + 1000);
+    write_level(test_dir2 / "level.bin", edited);
+
+    // Without metadata, only the base size is recorded next to each entry
+    dp::archive_builder base_builder;
+    base_builder.set_entry_metadata(false);
+    base_builder.add_directory(test_dir1);
+    ASSERT_TRUE(base_builder.build(archive1_path).has_value());
+
+    dp::archive_builder patch_builder;
+    patch_builder.add_directory(test_dir2);
+    ASSERT_TRUE(patch_builder.set_patch_base(archive1_path).has_value());
+    ASSERT_TRUE(patch_builder.build(patch_path).has_value());
+    ASSERT_EQ(dp::archive(patch_path).stat("level.bin")->compression, dp::compression_method::delta);
+
+    {
+        dp::vfs filesystem;
+        ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+        ASSERT_TRUE(filesystem.mount(patch_path).has_value());
+        auto data = filesystem.read(*filesystem.resolve("level.bin"));
+        ASSERT_TRUE(data.has_value());
+        EXPECT_EQ(std::memcmp(data->data(), edited.data(), edited.size()), 0);
+    }
+
+    // Replace the base with different contents of the same size
+    std::ranges::reverse(contents);
+    write_level(test_dir1 / "level.bin", contents);
+    ASSERT_TRUE(base_builder.build(archive1_path).has_value());
+
+    dp::archive patch(patch_path);
+    patch.set_delta_base(std::make_shared<dp::archive>(archive1_path));
+    EXPECT_FALSE(patch.open("level.bin").has_value());
+
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(patch_path).has_value());
+    EXPECT_FALSE(filesystem.read(*filesystem.resolve("level.bin")).has_value());
+    EXPECT_FALSE(filesystem.open("level.bin").has_value());
+
+    std::filesystem::remove(patch_path);
+}
+
+TEST_F(VFSTest, BatchedReadAcrossVolumes) {
+    dp::archive_builder builder;
+    builder.set_volume_count(3);
+    for (int i = 0; i < 12; ++i) {
+        builder.add_buffer("file" + std::to_string(i) + ".txt",
+                           std::vector<std::byte>(2000 + i * 100, static_cast<std::byte>('a' + i)));
+    }
+    ASSERT_TRUE(builder.build(archive2_path).has_value());
+
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    ASSERT_TRUE(filesystem.mount(archive2_path).has_value());
+
+    std::vector<dp::file_id> ids;
+    for (int i = 11; i >= 0; --i) {
+        ids.push_back(*filesystem.resolve("file" + std::to_string(i) + ".txt"));
+    }
+    ids.push_back(*filesystem.resolve("unique1.txt"));
+    ids.push_back(dp::file_id{});
+
+    const auto results = filesystem.read(std::span<const dp::file_id>(ids));
+    ASSERT_EQ(results.size(), ids.size());
+    for (std::size_t i = 0; i + 1 < ids.size(); ++i) {
+        ASSERT_TRUE(results[i].has_value()) << i;
+        EXPECT_EQ(*results[i], *filesystem.read(ids[i])) << i;
+    }
+    EXPECT_EQ(results.back().error(), dp::vfs_error::invalid_handle);
+
+    for (std::uint32_t i = 0; i < 3; ++i) {
+        std::filesystem::remove(dp::volume_path(archive2_path, i));
+    }
+}
+
+TEST_F(VFSTest, DecompressionBudget) {
+    // Compressible enough to be stored deflated
+    const std::string contents(64 * 1024, 'x');
+    {
+        std::ofstream file(test_dir1 / "large.txt", std::ios::binary);
+        file << contents;
+    }
+    dp::archive_builder builder;
+    builder.add_directory(test_dir1);
+    ASSERT_TRUE(builder.build(archive1_path).has_value());
+    EXPECT_EQ(dp::archive(archive1_path).stat("large.txt")->compression, dp::compression_method::deflate);
+
+    dp::vfs filesystem;
+    ASSERT_TRUE(filesystem.mount(archive1_path).has_value());
+    EXPECT_EQ(filesystem.get_decompression_budget(), 0u);
+
+    // Smaller than one decode: each call waits for the whole budget instead of failing
+    filesystem.set_decompression_budget(1024);
+    filesystem.set_decompression_timeout(std::chrono::milliseconds(10'000));
+    EXPECT_EQ(filesystem.get_decompression_budget(), 1024u);
+
+    auto id = filesystem.resolve("large.txt");
+    ASSERT_TRUE(id.has_value());
+
+    std::vector<std::thread> readers;
+    std::atomic<int> matches = 0;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            // The stream keeps its reservation, so it is opened last
+            std::string out(contents.size(), '\0');
+            auto written = filesystem.read(*id, std::as_writable_bytes(std::span(out)));
+            auto data = filesystem.read(*id);
+            auto stream = filesystem.open(*id);
+            if (data && stream && written && *written == contents.size() && out == contents &&
+                std::string{std::istreambuf_iterator<char>(**stream), {}} == contents) {
+                ++matches;
+            }
+        });
+    }
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(matches, 4);
+
+    // Open streams keep their decoded size reserved until destroyed
+    filesystem.set_decompression_budget(contents.size() * 3 / 2);
+    filesystem.set_decompression_timeout(std::chrono::milliseconds(0));
+    {
+        auto held = filesystem.open(*id);
+        ASSERT_TRUE(held.has_value());
+        EXPECT_EQ(filesystem.open(*id).error(), dp::vfs_error::budget_exhausted);
+    }
+    // Opens by path skip the (enabled by default) cache while a budget is set
+    filesystem.clear_cache();
+    {
+        auto by_path = filesystem.open("large.txt");
+        ASSERT_TRUE(by_path.has_value());
+        EXPECT_EQ(std::string(std::istreambuf_iterator<char>(**by_path), {}), contents);
+        EXPECT_EQ(filesystem.cache_size(), 0u);
+    }
+
+    auto outliving = filesystem.open(*id);
+    ASSERT_TRUE(outliving.has_value());
+
+    // A stream may outlive the budget it was charged to
+    filesystem.set_decompression_budget(0);
+    EXPECT_TRUE(filesystem.open("large.txt").has_value());
+    EXPECT_EQ(filesystem.cache_size(), 1u);
+    outliving->reset();
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <datapak/vfstream.hpp>
+#include <datapak/file_handle.hpp>
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <sstream>
 
@@ -110,4 +113,93 @@ TEST_F(VFStreamTest, StreamCompatibility) {
     oss << stream.rdbuf();
 
     EXPECT_EQ(oss.str(), test_string);
-}
\ No newline at end of file
+}
+
+TEST_F(VFStreamTest, RangeStreambufReadsOnDemand) {
+    const auto path = std::filesystem::temp_directory_path() / "datapak_range_test.bin";
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "HEADER";
+        file << test_string;
+        file << "TRAILER";
+    }
+
+    auto handle = std::make_shared<const dp::file_handle>(path);
+    ASSERT_TRUE(handle->is_open());
+
+    // Tiny buffer so reads cross refills and large reads bypass it
+    dp::vfstream stream(std::make_unique<dp::range_streambuf>(handle, 6, test_string.size(), false, 4));
+
+    std::string line;
+    std::getline(stream, line);
+    EXPECT_EQ(line, "Hello, World!");
+
+    std::string rest(test_string.size(), '\0');
+    stream.read(rest.data(), static_cast<std::streamsize>(rest.size()));
+    EXPECT_EQ(stream.gcount(), static_cast<std::streamsize>(test_string.size() - 14));
+    EXPECT_EQ(rest.substr(0, static_cast<std::size_t>(stream.gcount())), test_string.substr(14));
+    EXPECT_TRUE(stream.eof());
+
+    // Seeking never reads past the range
+    stream.clear();
+    stream.seekg(0, std::ios::end);
+    EXPECT_EQ(stream.tellg(), static_cast<std::streampos>(test_string.size()));
+    stream.seekg(7, std::ios::beg);
+    std::string word(5, '\0');
+    stream.read(word.data(), 5);
+    EXPECT_EQ(word, "World");
+    stream.seekg(-6, std::ios::cur);
+    EXPECT_EQ(stream.get(), ' ');
+
+    std::ostringstream oss;
+    stream.seekg(0);
+    oss << stream.rdbuf();
+    EXPECT_EQ(oss.str(), test_string);
+
+    std::filesystem::remove(path);
+}
+
+TEST_F(VFStreamTest, ReadaheadStreambufAlternatesWindows) {
+    std::size_t calls = 0;
+    std::size_t offset = 0;
+    auto source = [&](std::span<std::byte> window) -> std::optional<std::size_t> {
+        ++calls;
+        const auto count = std::min(window.size(), test_data.size() - offset);
+        std::copy_n(test_data.begin() + static_cast<std::ptrdiff_t>(offset), count, window.begin());
+        offset += count;
+        return count;
+    };
+
+    dp::vfstream stream(std::make_unique<dp::readahead_streambuf>(source, test_data.size(), 7));
+    const std::string contents{std::istreambuf_iterator<char>(stream), {}};
+    EXPECT_EQ(contents, test_string);
+    EXPECT_EQ(calls, (test_data.size() + 6) / 7);
+
+    // Only the current position can be "sought"
+    stream.clear();
+    EXPECT_EQ(stream.tellg(), static_cast<std::streamoff>(test_string.size()));
+    stream.seekg(0);
+    EXPECT_TRUE(stream.fail());
+}
+
+TEST_F(VFStreamTest, ReadaheadStreambufReportsSourceError) {
+    for (const bool short_stream : {false, true}) {
+        std::size_t calls = 0;
+        auto source = [&](std::span<std::byte> window) -> std::optional<std::size_t> {
+            if (calls++ > 0) {
+                return short_stream ? std::optional<std::size_t>{0} : std::nullopt;
+            }
+            std::fill(window.begin(), window.end(), std::byte{'x'});
+            return window.size();
+        };
+
+        // The data before the failure is delivered, then the stream goes bad instead of ending
+        dp::vfstream stream(std::make_unique<dp::readahead_streambuf>(source, 100, 10));
+        std::string contents;
+        for (int c; (c = stream.get()) != std::char_traits<char>::eof();) {
+            contents.push_back(static_cast<char>(c));
+        }
+        EXPECT_EQ(contents, std::string(10, 'x'));
+        EXPECT_TRUE(stream.bad());
+    }
+}
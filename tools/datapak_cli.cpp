@@ -6,22 +6,48 @@
 #include <algorithm>
 #include <iomanip>
 #include <filesystem>
+#include <charconv>
+#include <optional>
 
 void print_usage(const std::string& program_name) {
     std::cout << "Usage: " << program_name << " [COMMAND] [OPTIONS]\n\n";
     std::cout << "Commands:\n";
-    std::cout << "  create <archive.pak> <input_dir> [compression]  Create archive from directory\n";
+    std::cout << "  create <archive.pak> <input_dir> [compression]  Create archive from directory (- for stdout)\n";
+    std::cout << "  diff-pack <base.pak> <new_dir> <out.pak> [compression]\n";
+    std::cout << "                                                  Create patch archive with changes since base\n";
     std::cout << "  list <archive.pak>                              List files in archive\n";
     std::cout << "  extract <archive.pak> <file_path> [output]      Extract file from archive\n";
     std::cout << "  info <archive.pak>                              Show archive information\n";
+    std::cout << "  verify <archive.pak> [--base base.pak] [--threads n]\n";
+    std::cout << "                                                  Check every entry (base decodes delta entries)\n";
+    std::cout << "  recompress <in.pak> <out.pak> [--codec name[:level]] [--filter pattern]... [--threads n]\n";
+    std::cout << "                                                  Re-encode matching entries, copy the rest\n";
+    std::cout << "  merge <out.pak> <a.pak> <b.pak>...              Combine archives, later ones taking precedence\n";
     std::cout << "\n";
     std::cout << "Compression options: none, deflate (default: deflate)\n";
     std::cout << "\n";
     std::cout << "Examples:\n";
     std::cout << "  " << program_name << " create assets.pak ./data deflate\n";
+    std::cout << "  " << program_name << " diff-pack assets.pak ./data assets_patch.pak\n";
     std::cout << "  " << program_name << " list assets.pak\n";
     std::cout << "  " << program_name << " extract assets.pak config.txt output.txt\n";
     std::cout << "  " << program_name << " info assets.pak\n";
+    std::cout << "  " << program_name << " verify assets.pak\n";
+    std::cout << "  " << program_name << " recompress assets.pak assets9.pak --codec deflate:9 --filter '*.json'\n";
+    std::cout << "  " << program_name << " merge full.pak assets.pak assets_patch.pak\n";
+}
+
+const char* describe(dp::archive_error error) {
+    switch (error) {
+    case dp::archive_error::file_not_found: return "file not found";
+    case dp::archive_error::invalid_format: return "bad bounds or size";
+    case dp::archive_error::read_error: return "read error";
+    case dp::archive_error::compression_error: return "cannot decompress";
+    case dp::archive_error::entry_not_found: return "base entry not found";
+    case dp::archive_error::checksum_mismatch: return "checksum mismatch";
+    case dp::archive_error::buffer_too_small: return "buffer too small";
+    }
+    return "unknown error";
 }
 
 dp::compression_method parse_compression(const std::string& comp_str) {
@@ -34,6 +60,17 @@ dp::compression_method parse_compression(const std::string& comp_str) {
     return dp::compression_method::deflate; // default
 }
 
+// Parse a whole string as a decimal number; rejects signs, spaces and trailing text
+std::optional<unsigned> parse_unsigned(const std::string& value) {
+    unsigned result = 0;
+    const auto* end = value.data() + value.size();
+    const auto [ptr, ec] = std::from_chars(value.data(), end, result);
+    if (value.empty() || ec != std::errc{} || ptr != end) {
+        return std::nullopt;
+    }
+    return result;
+}
+
 int cmd_create(const std::vector<std::string>& args) {
     if (args.size() < 4) {
         std::cerr << "Error: create command requires archive path and input directory\n";
@@ -56,17 +93,71 @@ int cmd_create(const std::vector<std::string>& args) {
     dp::archive_builder builder(compression);
     builder.add_directory(input_dir);
 
-    std::cout << "Creating archive '" << archive_path << "' from '" << input_dir << "'...\n";
-    std::cout << "Compression: " << (compression == dp::compression_method::none ? "none" : "deflate") << "\n";
-    std::cout << "Files to archive: " << builder.file_count() << "\n";
+    // Streaming to stdout keeps progress messages off the archive bytes
+    const bool to_stdout = archive_path == "-";
+    std::ostream& log = to_stdout ? std::cerr : std::cout;
 
-    auto result = builder.build(archive_path);
+    log << "Creating archive '" << archive_path << "' from '" << input_dir << "'...\n";
+    log << "Compression: " << (compression == dp::compression_method::none ? "none" : "deflate") << "\n";
+    log << "Files to archive: " << builder.file_count() << "\n";
+
+    auto result = to_stdout ? builder.build(std::cout) : builder.build(archive_path);
     if (!result) {
         std::cerr << "Error: Failed to create archive\n";
         return 1;
     }
 
-    std::cout << "Archive created successfully!\n";
+    log << "Archive created successfully!\n";
+    return 0;
+}
+
+int cmd_diff_pack(const std::vector<std::string>& args) {
+    if (args.size() < 5) {
+        std::cerr << "Error: diff-pack command requires base archive, input directory and output archive\n";
+        return 1;
+    }
+
+    const std::string base_path = args[2];
+    const std::string input_dir = args[3];
+    const std::string archive_path = args[4];
+    dp::compression_method compression = dp::compression_method::deflate;
+
+    if (args.size() > 5) {
+        compression = parse_compression(args[5]);
+    }
+
+    if (!std::filesystem::exists(input_dir)) {
+        std::cerr << "Error: Input directory '" << input_dir << "' does not exist\n";
+        return 1;
+    }
+
+    dp::archive_builder builder(compression);
+    builder.add_directory(input_dir);
+
+    if (auto base = builder.set_patch_base(base_path); !base) {
+        std::cerr << "Error: Failed to open base archive '" << base_path << "'\n";
+        return 1;
+    }
+
+    std::cout << "Creating patch '" << archive_path << "' from '" << input_dir
+              << "' against '" << base_path << "'...\n";
+
+    auto result = builder.build(archive_path);
+    if (!result) {
+        std::cerr << "Error: Failed to create patch archive\n";
+        return 1;
+    }
+
+    try {
+        dp::archive patch(archive_path);
+        std::cout << "Changed or added files: " << patch.list_files().size() << "\n";
+        std::cout << "Deleted files: " << patch.tombstones().size() << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Failed to reopen patch archive: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "Patch created successfully!\n";
     return 0;
 }
 
@@ -88,6 +179,13 @@ int cmd_list(const std::vector<std::string>& args) {
         for (const auto& file : files) {
             std::cout << "  " << file << "\n";
         }
+
+        if (!arch.tombstones().empty()) {
+            std::cout << "\nDeleted files: " << arch.tombstones().size() << "\n\n";
+            for (const auto& file : arch.tombstones()) {
+                std::cout << "  " << file << "\n";
+            }
+        }
     } catch (const std::exception& e) {
         std::cerr << "Error: Failed to open archive: " << e.what() << "\n";
         return 1;
@@ -186,6 +284,173 @@ int cmd_info(const std::vector<std::string>& args) {
     return 0;
 }
 
+int cmd_verify(const std::vector<std::string>& args) {
+    if (args.size() < 3) {
+        std::cerr << "Error: verify command requires archive path\n";
+        return 1;
+    }
+
+    const std::string archive_path = args[2];
+    std::string base_path;
+    unsigned threads = 0;
+
+    for (std::size_t i = 3; i < args.size(); ++i) {
+        if (args[i] != "--base" && args[i] != "--threads") {
+            std::cerr << "Error: Unknown option '" << args[i] << "'\n";
+            return 1;
+        }
+        if (i + 1 >= args.size()) {
+            std::cerr << "Error: Missing value for '" << args[i] << "'\n";
+            return 1;
+        }
+
+        const std::string& value = args[++i];
+        if (args[i - 1] == "--base") {
+            base_path = value;
+        } else if (args[i - 1] == "--threads") {
+            const auto parsed = parse_unsigned(value);
+            if (!parsed) {
+                std::cerr << "Error: Invalid thread count '" << value << "'\n";
+                return 1;
+            }
+            threads = *parsed;
+        }
+    }
+
+    try {
+        // Header, directory and sections are validated while opening
+        dp::archive arch(archive_path);
+
+        if (!base_path.empty()) {
+            arch.set_delta_base(std::make_shared<dp::archive>(base_path));
+        }
+
+        std::cout << "Verifying " << arch.entry_count() << " entries in '" << archive_path << "'...\n";
+
+        const auto files = arch.list_files();
+        const auto failures = arch.verify(threads);
+        for (const auto& failure : failures) {
+            std::cout << "  FAILED " << files[failure.entry] << ": " << describe(failure.error) << "\n";
+        }
+
+        if (!failures.empty()) {
+            std::cout << failures.size() << " of " << files.size() << " entries failed verification\n";
+            return 1;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Failed to open archive: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "Archive is intact\n";
+    return 0;
+}
+
+int cmd_recompress(const std::vector<std::string>& args) {
+    if (args.size() < 4) {
+        std::cerr << "Error: recompress command requires input and output archive paths\n";
+        return 1;
+    }
+
+    const std::string input_path = args[2];
+    const std::string output_path = args[3];
+    dp::recompress_options options;
+
+    for (std::size_t i = 4; i < args.size(); ++i) {
+        if (i + 1 >= args.size()) {
+            std::cerr << "Error: Missing value for '" << args[i] << "'\n";
+            return 1;
+        }
+
+        const std::string& value = args[++i];
+        if (args[i - 1] == "--codec") {
+            // name[:level], e.g. deflate:9
+            const auto colon = value.find(':');
+            const std::string name = value.substr(0, colon);
+            if (name != "none" && name != "deflate") {
+                std::cerr << "Error: Unsupported codec '" << name << "' (available: none, deflate)\n";
+                return 1;
+            }
+            options.compression = parse_compression(name);
+            if (colon != std::string::npos) {
+                const auto level = parse_unsigned(value.substr(colon + 1));
+                if (!level || *level > 9) {
+                    std::cerr << "Error: Invalid level in '" << value << "' (expected 0-9)\n";
+                    return 1;
+                }
+                options.level = static_cast<int>(*level);
+            }
+        } else if (args[i - 1] == "--filter") {
+            options.filters.push_back(value);
+        } else if (args[i - 1] == "--threads") {
+            const auto threads = parse_unsigned(value);
+            if (!threads) {
+                std::cerr << "Error: Invalid thread count '" << value << "'\n";
+                return 1;
+            }
+            options.threads = *threads;
+        } else {
+            std::cerr << "Error: Unknown option '" << args[i - 1] << "'\n";
+            return 1;
+        }
+    }
+
+    try {
+        dp::archive input(input_path);
+
+        std::cout << "Recompressing '" << input_path << "' into '" << output_path << "'...\n";
+
+        auto result = dp::recompress(input, output_path, options);
+        if (!result) {
+            std::cerr << "Error: Failed to recompress archive\n";
+            return 1;
+        }
+
+        std::cout << "Re-encoded entries: " << result->recompressed << "\n";
+        std::cout << "Copied entries: " << result->copied << "\n";
+        std::cout << "Size: " << std::filesystem::file_size(input_path) << " -> "
+                  << std::filesystem::file_size(output_path) << " bytes\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
+int cmd_merge(const std::vector<std::string>& args) {
+    if (args.size() < 4) {
+        std::cerr << "Error: merge command requires output archive and at least one input archive\n";
+        return 1;
+    }
+
+    const std::string output_path = args[2];
+
+    try {
+        std::vector<std::shared_ptr<const dp::archive>> inputs;
+        for (std::size_t i = 3; i < args.size(); ++i) {
+            inputs.push_back(std::make_shared<dp::archive>(args[i]));
+        }
+
+        std::cout << "Merging " << inputs.size() << " archives into '" << output_path << "'...\n";
+
+        auto result = dp::merge(inputs, output_path);
+        if (!result) {
+            std::cerr << "Error: Failed to merge archives\n";
+            return 1;
+        }
+
+        std::cout << "Copied entries: " << result->copied << "\n";
+        std::cout << "Decoded delta/chunked entries: " << result->materialized << "\n";
+        std::cout << "Replaced or deleted entries: " << result->shadowed << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Failed to open archive: " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         print_usage(argv[0]);
@@ -201,12 +466,20 @@ int main(int argc, char* argv[]) {
 
     if (command == "create") {
         return cmd_create(args);
+    } else if (command == "diff-pack") {
+        return cmd_diff_pack(args);
     } else if (command == "list") {
         return cmd_list(args);
     } else if (command == "extract") {
         return cmd_extract(args);
     } else if (command == "info") {
         return cmd_info(args);
+    } else if (command == "verify") {
+        return cmd_verify(args);
+    } else if (command == "recompress") {
+        return cmd_recompress(args);
+    } else if (command == "merge") {
+        return cmd_merge(args);
     } else if (command == "help" || command == "-h" || command == "--help") {
         print_usage(args[0]);
         return 0;